@@ -0,0 +1,880 @@
+/* Renders every filter in the pack offscreen over synthetic sources and
+ * prints per-frame timings as JSON.
+ *
+ * On Linux the OpenGL renderer is forced onto Mesa's software rasterizer
+ * (llvmpipe) unless LIBGL_ALWAYS_SOFTWARE is already set, so results are
+ * comparable between machines.  libobs still creates its GLX context on an
+ * X display, so a headless machine needs a virtual one:
+ *
+ *   xvfb-run -a filter-pack-bench */
+
+#include <obs.h>
+#include <graphics/vec4.h>
+#include <util/platform.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "../filter-pack.hpp"
+#include "../uv-map-file.hpp"
+
+#ifdef __linux__
+#include <X11/Xlib.h>
+#endif
+
+#define BENCH_SOURCE_ID "filter_pack_bench_source"
+
+/* ------------------------------------------------------------------------- */
+/* Synthetic sources                                                          */
+
+enum bench_pattern {
+	PATTERN_SOLID,
+	PATTERN_TEXT,
+	PATTERN_NOISE,
+	NUM_PATTERNS,
+};
+
+static const char *const pattern_names[NUM_PATTERNS] = {
+	"solid",
+	"text",
+	"noise",
+};
+
+struct bench_source {
+	gs_texture_t *tex;
+	uint32_t cx, cy;
+};
+
+static inline uint32_t next_random(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/* Mostly transparent, with glyph-sized clusters of opaque strokes laid out
+ * in lines, so that alpha edges dominate the way they do for text. */
+static void fill_text(uint32_t *pixels, uint32_t cx, uint32_t cy)
+{
+	const uint32_t glyph_cx = 16, glyph_cy = 24, line_cy = 32;
+	uint32_t state = 0x2545f491;
+
+	for (uint32_t gy = 0; gy + glyph_cy <= cy; gy += line_cy) {
+		for (uint32_t gx = 0; gx + glyph_cx <= cx; gx += glyph_cx) {
+			if (next_random(&state) % 8 == 0)
+				continue; /* word gap */
+
+			uint32_t strokes = 2 + next_random(&state) % 3;
+
+			for (uint32_t s = 0; s < strokes; s++) {
+				bool vertical = next_random(&state) & 1;
+				uint32_t x = gx + 2 + next_random(&state) % 10;
+				uint32_t y = gy + 2 + next_random(&state) % 18;
+				uint32_t w = vertical ? 2 : 10;
+				uint32_t h = vertical ? 18 : 2;
+
+				for (uint32_t py = y; py < y + h && py < cy;
+				     py++) {
+					for (uint32_t px = x;
+					     px < x + w && px < cx; px++)
+						pixels[py * cx + px] =
+							0xFFFFFFFF;
+				}
+			}
+		}
+	}
+}
+
+static void *bench_source_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct bench_source *context =
+		(struct bench_source *)bzalloc(sizeof(struct bench_source));
+
+	context->cx = (uint32_t)obs_data_get_int(settings, "width");
+	context->cy = (uint32_t)obs_data_get_int(settings, "height");
+
+	enum bench_pattern pattern =
+		(enum bench_pattern)obs_data_get_int(settings, "pattern");
+	size_t count = (size_t)context->cx * context->cy;
+	uint32_t *pixels = (uint32_t *)bzalloc(count * sizeof(uint32_t));
+	uint32_t state = 0x9e3779b9;
+
+	switch (pattern) {
+	case PATTERN_SOLID:
+		for (size_t i = 0; i < count; i++)
+			pixels[i] = 0xFF6080A0;
+		break;
+	case PATTERN_TEXT:
+		fill_text(pixels, context->cx, context->cy);
+		break;
+	case PATTERN_NOISE:
+		for (size_t i = 0; i < count; i++)
+			pixels[i] = next_random(&state) | 0xFF000000;
+		break;
+	default:
+		break;
+	}
+
+	const uint8_t *data = (const uint8_t *)pixels;
+
+	obs_enter_graphics();
+	context->tex = gs_texture_create(context->cx, context->cy, GS_RGBA, 1,
+					 &data, 0);
+	obs_leave_graphics();
+
+	bfree(pixels);
+
+	UNUSED_PARAMETER(source);
+	return context;
+}
+
+static void bench_source_destroy(void *data)
+{
+	struct bench_source *context = (struct bench_source *)data;
+
+	obs_enter_graphics();
+	gs_texture_destroy(context->tex);
+	obs_leave_graphics();
+
+	bfree(context);
+}
+
+static void bench_source_render(void *data, gs_effect_t *effect)
+{
+	struct bench_source *context = (struct bench_source *)data;
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
+
+	gs_effect_set_texture(image, context->tex);
+	gs_draw_sprite(context->tex, 0, context->cx, context->cy);
+}
+
+static uint32_t bench_source_get_width(void *data)
+{
+	return ((struct bench_source *)data)->cx;
+}
+
+static uint32_t bench_source_get_height(void *data)
+{
+	return ((struct bench_source *)data)->cy;
+}
+
+static const char *bench_source_get_name(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "Benchmark Source";
+}
+
+static struct obs_source_info bench_source_info = [] {
+	obs_source_info info = {0};
+	info.id = BENCH_SOURCE_ID;
+	info.type = OBS_SOURCE_TYPE_INPUT;
+	info.output_flags = OBS_SOURCE_VIDEO;
+	info.get_name = bench_source_get_name;
+	info.create = bench_source_create;
+	info.destroy = bench_source_destroy;
+	info.video_render = bench_source_render;
+	info.get_width = bench_source_get_width;
+	info.get_height = bench_source_get_height;
+	return info;
+}();
+
+/* ------------------------------------------------------------------------- */
+/* Cases                                                                      */
+
+/* Cases are built from the filter types the module registers.  Each filter
+ * runs with the settings below (or its defaults if it has no entry), with
+ * its identity settings to time the bypass, and once per variant that its
+ * properties offer: every bool toggled and every list item picked.
+ * Properties that change nothing that is drawn are left alone. */
+struct bench_workload {
+	const char *filter_id;
+	const char *name;
+	void (*settings)(obs_data_t *settings, uint32_t cx, uint32_t cy);
+	void (*identity)(obs_data_t *settings, uint32_t cx, uint32_t cy);
+};
+
+struct bench_stage {
+	const char *filter_id;
+	const struct bench_workload *workload; /* NULL runs the defaults */
+	bool identity;
+	obs_data_t *overrides;
+};
+
+struct bench_case {
+	std::string name;
+	std::vector<struct bench_stage> stages;
+};
+
+static const char *const ignored_properties[] = {
+	"log_stats",
+	"keyframes_loop",
+};
+
+/* Stacks with a render path of their own, listed from the source up: an
+ * adjacent corner pin and lens distortion fold into one resample. */
+static const char *const bench_stacks[][2] = {
+	{"corner_pin_filter", "lens_distortion_filter"},
+	{"lens_distortion_filter", "corner_pin_filter"},
+};
+
+static std::string uv_map_path;
+
+static void corner_pin_perspective(obs_data_t *settings, uint32_t cx,
+				   uint32_t cy)
+{
+	obs_data_set_int(settings, "topLeftX", cx / 10);
+	obs_data_set_int(settings, "topLeftY", cy / 8);
+	obs_data_set_int(settings, "topRightX", cx - cx / 20);
+	obs_data_set_int(settings, "topRightY", 0);
+	obs_data_set_int(settings, "bottomLeftX", 0);
+	obs_data_set_int(settings, "bottomLeftY", cy - cy / 6);
+	obs_data_set_int(settings, "bottomRightX", cx);
+	obs_data_set_int(settings, "bottomRightY", cy);
+}
+
+static void lens_barrel(obs_data_t *settings, uint32_t cx, uint32_t cy)
+{
+	obs_data_set_double(settings, "Strength", 10.0);
+	obs_data_set_double(settings, "Zoom", 1.1);
+
+	UNUSED_PARAMETER(cx);
+	UNUSED_PARAMETER(cy);
+}
+
+/* Only identity for targets less than twice as wide as they are tall, and
+ * at the tiers that sample texel centers exactly */
+static void lens_identity(obs_data_t *settings, uint32_t cx, uint32_t cy)
+{
+	obs_data_set_double(settings, "Strength", 0.0);
+	obs_data_set_double(settings, "Zoom", 1.0);
+	obs_data_set_int(settings, "quality", QUALITY_SINGLE);
+
+	UNUSED_PARAMETER(cx);
+	UNUSED_PARAMETER(cy);
+}
+
+static void stroke_thin(obs_data_t *settings, uint32_t cx, uint32_t cy)
+{
+	obs_data_set_int(settings, "width", 2);
+	obs_data_set_int(settings, "color", 0xFF0000FF);
+
+	UNUSED_PARAMETER(cx);
+	UNUSED_PARAMETER(cy);
+}
+
+static void stroke_wide(obs_data_t *settings, uint32_t cx, uint32_t cy)
+{
+	stroke_thin(settings, cx, cy);
+	obs_data_set_int(settings, "width", 16);
+}
+
+static void stroke_identity(obs_data_t *settings, uint32_t cx, uint32_t cy)
+{
+	stroke_thin(settings, cx, cy);
+	obs_data_set_int(settings, "width", 0);
+}
+
+static void uv_map_swirl(obs_data_t *settings, uint32_t cx, uint32_t cy)
+{
+	obs_data_set_string(settings, "path", uv_map_path.c_str());
+
+	UNUSED_PARAMETER(cx);
+	UNUSED_PARAMETER(cy);
+}
+
+/* The first entry of a filter is the one its variants derive from */
+static const struct bench_workload workloads[] = {
+	{"corner_pin_filter", "perspective", corner_pin_perspective, NULL},
+	{"lens_distortion_filter", "barrel", lens_barrel, lens_identity},
+	{"stroke_filter", "2px", stroke_thin, stroke_identity},
+	{"stroke_filter", "16px", stroke_wide, NULL},
+	{"uv_map_filter", "swirl", uv_map_swirl, NULL},
+};
+
+static const struct bench_workload *find_workload(const char *filter_id)
+{
+	for (const auto &workload : workloads) {
+		if (strcmp(workload.filter_id, filter_id) == 0)
+			return &workload;
+	}
+	return NULL;
+}
+
+/* A small map that pulls the picture into a swirl around its center, so
+ * that neighbouring output texels sample scattered input */
+static bool write_uv_map(const char *path)
+{
+	const uint32_t cx = 256, cy = 144;
+	FILE *file = fopen(path, "wb");
+
+	if (!file)
+		return false;
+
+	uint32_t header[4] = {0, UV_MAP_VERSION, cx, cy};
+	memcpy(header, UV_MAP_MAGIC, 4);
+	bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+
+	for (uint32_t y = 0; ok && y < cy; y++) {
+		for (uint32_t x = 0; ok && x < cx; x++) {
+			float u = ((float)x + 0.5f) / (float)cx - 0.5f;
+			float v = ((float)y + 0.5f) / (float)cy - 0.5f;
+			float angle = 2.0f * sqrtf(u * u + v * v);
+			float uv[2] = {
+				0.5f + u * cosf(angle) - v * sinf(angle),
+				0.5f + u * sinf(angle) + v * cosf(angle),
+			};
+
+			ok = fwrite(uv, sizeof(uv), 1, file) == 1;
+		}
+	}
+
+	return fclose(file) == 0 && ok;
+}
+
+static bool ignored_property(const char *name)
+{
+	for (const char *ignored : ignored_properties) {
+		if (strcmp(name, ignored) == 0)
+			return true;
+	}
+	return false;
+}
+
+static void add_case(std::vector<struct bench_case> &cases, std::string name,
+		     const char *filter_id,
+		     const struct bench_workload *workload, bool identity,
+		     obs_data_t *overrides)
+{
+	struct bench_case bench;
+	bench.name = std::move(name);
+	bench.stages.push_back({filter_id, workload, identity, overrides});
+	cases.push_back(std::move(bench));
+}
+
+/* One case per value that a bool or list property could take other than
+ * the one the workload runs with */
+static void add_variants(std::vector<struct bench_case> &cases,
+			 const char *filter_id,
+			 const struct bench_workload *workload)
+{
+	obs_properties_t *props = obs_get_source_properties(filter_id);
+	obs_data_t *base = obs_get_source_defaults(filter_id);
+
+	if (workload)
+		workload->settings(base, 1920, 1080);
+
+	obs_property_t *prop = obs_properties_first(props);
+
+	for (; prop; obs_property_next(&prop)) {
+		const char *name = obs_property_name(prop);
+		enum obs_property_type type = obs_property_get_type(prop);
+
+		if (ignored_property(name))
+			continue;
+
+		if (type == OBS_PROPERTY_BOOL) {
+			bool value = !obs_data_get_bool(base, name);
+			obs_data_t *overrides = obs_data_create();
+
+			obs_data_set_bool(overrides, name, value);
+			add_case(cases,
+				 std::string(filter_id) + " " + name + "=" +
+					 (value ? "true" : "false"),
+				 filter_id, workload, false, overrides);
+			continue;
+		}
+
+		if (type != OBS_PROPERTY_LIST)
+			continue;
+
+		enum obs_combo_format format = obs_property_list_format(prop);
+		size_t count = obs_property_list_item_count(prop);
+
+		for (size_t i = 0; i < count; i++) {
+			obs_data_t *overrides = obs_data_create();
+			std::string value;
+
+			if (format == OBS_COMBO_FORMAT_INT) {
+				long long item =
+					obs_property_list_item_int(prop, i);
+				if (item == obs_data_get_int(base, name)) {
+					obs_data_release(overrides);
+					continue;
+				}
+				obs_data_set_int(overrides, name, item);
+				value = std::to_string(item);
+			} else if (format == OBS_COMBO_FORMAT_STRING) {
+				const char *item =
+					obs_property_list_item_string(prop, i);
+				if (strcmp(item, obs_data_get_string(
+							 base, name)) == 0) {
+					obs_data_release(overrides);
+					continue;
+				}
+				obs_data_set_string(overrides, name, item);
+				value = item;
+			} else {
+				obs_data_release(overrides);
+				continue;
+			}
+
+			add_case(cases,
+				 std::string(filter_id) + " " + name + "=" +
+					 value,
+				 filter_id, workload, false, overrides);
+		}
+	}
+
+	obs_data_release(base);
+	obs_properties_destroy(props);
+}
+
+static bool filter_registered(const char *filter_id)
+{
+	const char *id;
+
+	for (size_t i = 0; obs_enum_filter_types(i, &id); i++) {
+		if (strcmp(id, filter_id) == 0)
+			return true;
+	}
+	return false;
+}
+
+static std::vector<struct bench_case> build_cases(void)
+{
+	std::vector<struct bench_case> cases;
+	const char *filter_id;
+
+	cases.push_back({"none", {}});
+
+	for (size_t i = 0; obs_enum_filter_types(i, &filter_id); i++) {
+		const struct bench_workload *first = find_workload(filter_id);
+
+		for (const auto &workload : workloads) {
+			if (strcmp(workload.filter_id, filter_id) == 0)
+				add_case(cases,
+					 std::string(filter_id) + " " +
+						 workload.name,
+					 filter_id, &workload, false, NULL);
+		}
+
+		if (!first)
+			add_case(cases, filter_id, filter_id, NULL, false,
+				 NULL);
+		else if (first->identity)
+			add_case(cases, std::string(filter_id) + " identity",
+				 filter_id, first, true, NULL);
+
+		add_variants(cases, filter_id, first);
+	}
+
+	for (const auto &stack : bench_stacks) {
+		if (!filter_registered(stack[0]) ||
+		    !filter_registered(stack[1]))
+			continue;
+
+		struct bench_case bench;
+		bench.name = std::string(stack[0]) + " > " + stack[1];
+		bench.stages.push_back(
+			{stack[0], find_workload(stack[0]), false, NULL});
+		bench.stages.push_back(
+			{stack[1], find_workload(stack[1]), false, NULL});
+		cases.push_back(std::move(bench));
+	}
+
+	return cases;
+}
+
+static void free_cases(std::vector<struct bench_case> &cases)
+{
+	for (auto &bench : cases) {
+		for (auto &stage : bench.stages)
+			obs_data_release(stage.overrides);
+	}
+	cases.clear();
+}
+
+static const uint32_t resolutions[][2] = {
+	{1280, 720},
+	{1920, 1080},
+	{3840, 2160},
+};
+
+/* ------------------------------------------------------------------------- */
+
+struct bench_result {
+	double mean_ms;
+	double median_ms;
+	double min_ms;
+	long passes;
+	long bypasses;
+	double gpu_ms;
+};
+
+static void get_stats(obs_source_t *filter, long *passes, long *bypasses)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(filter);
+	calldata_t cd = {0};
+
+	*passes = 0;
+	*bypasses = 0;
+
+	if (proc_handler_call(ph, "get_stats", &cd)) {
+		*passes = (long)calldata_int(&cd, "passes");
+		*bypasses = (long)calldata_int(&cd, "bypasses");
+	}
+
+	calldata_free(&cd);
+}
+
+/* Rolling GPU time of the filter's own draws, from its gpu_timer */
+static double get_gpu_time(obs_source_t *filter)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(filter);
+	calldata_t cd = {0};
+	double ms = 0.0;
+
+	if (proc_handler_call(ph, "get_gpu_time", &cd))
+		ms = calldata_float(&cd, "frame_ms");
+
+	calldata_free(&cd);
+	return ms;
+}
+
+/* Renders one frame of `source` with its filters and waits for the GPU by
+ * reading the result back. */
+static void render_frame(obs_source_t *source, gs_texrender_t *render,
+			 gs_stagesurf_t *stage, uint32_t cx, uint32_t cy)
+{
+	gs_texrender_reset(render);
+
+	if (gs_texrender_begin(render, cx, cy)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		obs_source_video_render(source);
+		gs_texrender_end(render);
+	}
+
+	uint8_t *data;
+	uint32_t linesize;
+
+	gs_stage_texture(stage, gs_texrender_get_texture(render));
+	if (gs_stagesurface_map(stage, &data, &linesize))
+		gs_stagesurface_unmap(stage);
+}
+
+static obs_source_t *create_filter(const struct bench_stage *stage,
+				   const char *name, uint32_t cx, uint32_t cy)
+{
+	obs_data_t *settings = obs_data_create();
+
+	if (stage->workload && stage->identity)
+		stage->workload->identity(settings, cx, cy);
+	else if (stage->workload)
+		stage->workload->settings(settings, cx, cy);
+	if (stage->overrides)
+		obs_data_apply(settings, stage->overrides);
+
+	obs_source_t *filter =
+		obs_source_create_private(stage->filter_id, name, settings);
+	obs_data_release(settings);
+	return filter;
+}
+
+static void remove_filters(obs_source_t *source,
+			   std::vector<obs_source_t *> &filters)
+{
+	for (obs_source_t *filter : filters) {
+		obs_source_filter_remove(source, filter);
+		obs_source_release(filter);
+	}
+	filters.clear();
+}
+
+/* Passes and bypasses are summed over the stages of the case and counted
+ * per rendered frame, so that frames served from a cache count too. */
+static bool run_case(const struct bench_case *bench, enum bench_pattern pattern,
+		     uint32_t cx, uint32_t cy, int warmup, int frames,
+		     struct bench_result *result)
+{
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "width", cx);
+	obs_data_set_int(settings, "height", cy);
+	obs_data_set_int(settings, "pattern", pattern);
+
+	obs_source_t *source = obs_source_create_private(
+		BENCH_SOURCE_ID, "bench source", settings);
+	obs_data_release(settings);
+
+	std::vector<obs_source_t *> filters;
+
+	for (const auto &stage : bench->stages) {
+		obs_source_t *filter =
+			create_filter(&stage, bench->name.c_str(), cx, cy);
+
+		if (!filter) {
+			fprintf(stderr, "Could not create '%s'\n",
+				stage.filter_id);
+			remove_filters(source, filters);
+			obs_source_release(source);
+			return false;
+		}
+
+		obs_source_filter_add(source, filter);
+		filters.push_back(filter);
+	}
+
+	/* Let the video thread tick the filters, and any loader thread
+	 * finish, before rendering */
+	os_sleep_ms(100);
+
+	obs_enter_graphics();
+	gs_texrender_t *render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	gs_stagesurf_t *stage = gs_stagesurface_create(cx, cy, GS_RGBA);
+	obs_leave_graphics();
+
+	std::vector<double> times;
+	std::vector<long> passes_before(filters.size());
+	std::vector<long> bypasses_before(filters.size());
+
+	for (int i = 0; i < warmup + frames; i++) {
+		if (i == warmup) {
+			for (size_t f = 0; f < filters.size(); f++)
+				get_stats(filters[f], &passes_before[f],
+					  &bypasses_before[f]);
+		}
+
+		obs_enter_graphics();
+		uint64_t start = os_gettime_ns();
+		render_frame(source, render, stage, cx, cy);
+		uint64_t end = os_gettime_ns();
+		obs_leave_graphics();
+
+		if (i >= warmup)
+			times.push_back((double)(end - start) / 1000000.0);
+	}
+
+	memset(result, 0, sizeof(*result));
+
+	for (size_t f = 0; f < filters.size(); f++) {
+		long passes, bypasses;
+
+		get_stats(filters[f], &passes, &bypasses);
+		result->passes += passes - passes_before[f];
+		result->bypasses += bypasses - bypasses_before[f];
+		result->gpu_ms += get_gpu_time(filters[f]);
+	}
+
+	double total = 0.0;
+	for (double t : times)
+		total += t;
+
+	std::sort(times.begin(), times.end());
+	result->mean_ms = total / (double)times.size();
+	result->median_ms = times[times.size() / 2];
+	result->min_ms = times.front();
+
+	obs_enter_graphics();
+	gs_stagesurface_destroy(stage);
+	gs_texrender_destroy(render);
+	obs_leave_graphics();
+
+	remove_filters(source, filters);
+	obs_source_release(source);
+	return true;
+}
+
+/* Writes `str` as a JSON string, quotes included */
+static void print_json_string(const char *str)
+{
+	putchar('"');
+
+	for (const unsigned char *c = (const unsigned char *)str; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			printf("\\%c", *c);
+		else if (*c < 0x20)
+			printf("\\u%04x", *c);
+		else
+			putchar(*c);
+	}
+
+	putchar('"');
+}
+
+static bool startup(const char *module_path, const char *data_path)
+{
+#ifdef __linux__
+	setenv("LIBGL_ALWAYS_SOFTWARE", "1", 0);
+
+	Display *display = XOpenDisplay(NULL);
+	if (!display) {
+		fprintf(stderr, "Could not open an X display; on a headless "
+				"machine, run under xvfb-run -a\n");
+		return false;
+	}
+
+	obs_set_nix_platform(OBS_NIX_PLATFORM_X11_GLX);
+	obs_set_nix_platform_display(display);
+#endif
+
+	if (!obs_startup("en-US", NULL, NULL))
+		return false;
+
+	struct obs_video_info ovi = {0};
+	ovi.graphics_module = "libobs-opengl";
+	ovi.fps_num = 60;
+	ovi.fps_den = 1;
+	ovi.base_width = 1920;
+	ovi.base_height = 1080;
+	ovi.output_width = 1920;
+	ovi.output_height = 1080;
+	ovi.output_format = VIDEO_FORMAT_NV12;
+	ovi.colorspace = VIDEO_CS_709;
+	ovi.range = VIDEO_RANGE_PARTIAL;
+	ovi.scale_type = OBS_SCALE_BILINEAR;
+	ovi.gpu_conversion = true;
+	ovi.adapter = 0;
+
+	if (obs_reset_video(&ovi) != OBS_VIDEO_SUCCESS) {
+		fprintf(stderr, "Could not initialize video\n");
+		return false;
+	}
+
+	obs_module_t *module = NULL;
+	if (obs_open_module(&module, module_path, data_path) !=
+		    MODULE_SUCCESS ||
+	    !obs_init_module(module)) {
+		fprintf(stderr, "Could not load '%s'\n", module_path);
+		return false;
+	}
+
+	obs_register_source(&bench_source_info);
+	return true;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr,
+		"Usage: %s [--frames N] [--warmup N] [--module PATH] "
+		"[--data PATH] [--case PREFIX]\n"
+		"\n"
+		"On Linux this needs an X display; run it under Xvfb on "
+		"headless machines.\n",
+		argv0);
+}
+
+static std::string temp_path(const char *name)
+{
+	const char *dir = getenv("TMPDIR");
+
+	if (!dir)
+		dir = getenv("TEMP");
+	if (!dir)
+		dir = "/tmp";
+
+	return std::string(dir) + "/" + name;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *module_path = FILTER_PACK_MODULE;
+	const char *data_path = FILTER_PACK_DATA;
+	const char *prefix = "";
+	int frames = 120;
+	int warmup = 10;
+
+	for (int i = 1; i < argc; i++) {
+		bool has_value = i + 1 < argc;
+
+		if (strcmp(argv[i], "--frames") == 0 && has_value) {
+			frames = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--warmup") == 0 && has_value) {
+			warmup = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--module") == 0 && has_value) {
+			module_path = argv[++i];
+		} else if (strcmp(argv[i], "--data") == 0 && has_value) {
+			data_path = argv[++i];
+		} else if (strcmp(argv[i], "--case") == 0 && has_value) {
+			prefix = argv[++i];
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (frames < 1 || warmup < 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (!startup(module_path, data_path)) {
+		obs_shutdown();
+		return 1;
+	}
+
+	uv_map_path = temp_path("filter-pack-bench.uvmap");
+	if (!write_uv_map(uv_map_path.c_str()))
+		fprintf(stderr, "Could not write '%s'\n", uv_map_path.c_str());
+
+	std::vector<struct bench_case> cases = build_cases();
+
+	obs_enter_graphics();
+	const char *device = gs_get_device_name();
+	obs_leave_graphics();
+
+	printf("{\n  \"device\": ");
+	print_json_string(device ? device : "unknown");
+	printf(",\n  \"frames\": %d,\n  \"results\": [", frames);
+
+	bool first = true;
+
+	for (const auto &res : resolutions) {
+		for (int p = 0; p < NUM_PATTERNS; p++) {
+			for (const auto &bench : cases) {
+				struct bench_result r;
+
+				if (strncmp(bench.name.c_str(), prefix,
+					    strlen(prefix)) != 0 ||
+				    !run_case(&bench, (enum bench_pattern)p,
+					      res[0], res[1], warmup, frames,
+					      &r))
+					continue;
+
+				printf("%s\n    {\"case\": ", first ? "" : ",");
+				print_json_string(bench.name.c_str());
+				printf(", \"source\": \"%s\", \"width\": %u, "
+				       "\"height\": %u, "
+				       "\"ms_per_frame\": %.4f, "
+				       "\"median_ms\": %.4f, "
+				       "\"min_ms\": %.4f, "
+				       "\"gpu_ms\": %.4f, "
+				       "\"passes_per_frame\": %.2f, "
+				       "\"bypasses_per_frame\": %.2f}",
+				       pattern_names[p], res[0], res[1],
+				       r.mean_ms, r.median_ms, r.min_ms,
+				       r.gpu_ms,
+				       (double)r.passes / (double)frames,
+				       (double)r.bypasses / (double)frames);
+				fflush(stdout);
+				first = false;
+			}
+		}
+	}
+
+	printf("\n  ]\n}\n");
+
+	free_cases(cases);
+	os_unlink(uv_map_path.c_str());
+
+	obs_shutdown();
+	return 0;
+}
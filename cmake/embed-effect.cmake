@@ -0,0 +1,21 @@
+# Writes the text file INPUT to the header OUTPUT as a NUL terminated char
+# array called NAME, so that effects can be compiled into the module.
+#
+#   cmake -DINPUT=<file> -DOUTPUT=<header> -DNAME=<symbol> -P embed-effect.cmake
+
+file(READ "${INPUT}" content HEX)
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," content "${content}")
+
+# Sixteen bytes per line; CMake's regular expressions have no {n}
+set(line "")
+foreach(i RANGE 15)
+	set(line "${line}0x[0-9a-f][0-9a-f],")
+endforeach()
+string(REGEX REPLACE "(${line})" "\\1\n\t" content "${content}")
+
+get_filename_component(input_name "${INPUT}" NAME)
+
+file(WRITE "${OUTPUT}"
+	"/* Generated from ${input_name}, do not edit */\n"
+	"#pragma once\n\n"
+	"static const char ${NAME}[] = {\n\t${content}0x00};\n")
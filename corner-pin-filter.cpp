@@ -2,178 +2,379 @@
 #include <obs-source.h>
 #include <obs.h>
 #include <util/platform.h>
-#include "corner-pin-widget.hpp"
-
-struct corner_pin_data {
-	obs_source_t *context;
-
-	gs_effect_t *effect;
-	gs_eparam_t *uv1_param, *uv2_param, *uv3_param, *uv4_param;
-	gs_eparam_t *width, *height;
-	gs_eparam_t *outline_param;
-
-	int topLeftX;
-	int topRightX;
-	int bottomLeftX;
-	int bottomRightX;
-	int topLeftY;
-	int topRightY;
-	int bottomLeftY;
-	int bottomRightY;
-	float texwidth, texheight;
-	struct vec2 uv1;
-	struct vec2 uv2;
-	struct vec2 uv3;
-	struct vec2 uv4;
-	bool outline;
-
-	CornerPinWindow *window;
+#include "corner-pin-filter.hpp"
+#include "lens-distortion-filter.hpp"
+#include "render-pool.hpp"
+#include "corner_pin_filter.effect.h"
+#include <string.h>
+#include <algorithm>
+
+extern struct obs_source_info corner_pin_filter;
+
+enum corner_pin_param {
+	PARAM_UV1,
+	PARAM_UV2,
+	PARAM_UV3,
+	PARAM_UV4,
+	PARAM_TEXWIDTH,
+	PARAM_TEXHEIGHT,
+	PARAM_IMAGE,
+	PARAM_LENS_STRENGTH,
+	PARAM_LENS_ZOOM,
+	NUM_PARAMS,
 };
 
+static const char *const corner_pin_params[NUM_PARAMS] = {
+	"uv1",   "uv2",           "uv3",      "uv4", "texwidth", "texheight",
+	"image", "lens_strength", "lens_zoom",
+};
+
+enum corner_pin_feature {
+	FEATURE_OUTLINE,
+	FEATURE_FUSE_LENS,
+	FEATURE_LENS_HORIZONTAL,
+	FEATURE_QUALITY,
+	FEATURE_EDGE_AA,
+	NUM_FEATURES,
+};
+
+static const struct effect_feature corner_pin_features[NUM_FEATURES] = {
+	{"OUTLINE", NULL, 0},
+	{"FUSE_LENS", NULL, 0},
+	{"LENS_HORIZONTAL", NULL, 0},
+	{"QUALITY", filter_quality_values, NUM_QUALITY},
+	{"EDGE_AA", NULL, 0},
+};
+
+static struct effect_variants variants = EFFECT_VARIANTS(
+	"corner_pin_filter.effect", corner_pin_filter_effect,
+	corner_pin_features, NUM_FEATURES, corner_pin_params, NUM_PARAMS);
+
+/* Settings that keyframes can animate, in keyframe_anim order */
+static const char *const corner_pin_animated[] = {
+	"topLeftX",    "topLeftY",    "topRightX",    "topRightY",
+	"bottomLeftX", "bottomLeftY", "bottomRightX", "bottomRightY",
+};
+
+#define NUM_ANIMATED \
+	(sizeof(corner_pin_animated) / sizeof(corner_pin_animated[0]))
+
 static const char *corner_pin_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
 	return "Corner Pin";
 }
 
+/* Recomputes everything derived from the corners and the target's size */
+static void calc_uv(struct corner_pin_params *params, uint32_t width,
+		    uint32_t height)
+{
+	params->texwidth = (float)width;
+	params->texheight = (float)height;
+
+	if (!width || !height) {
+		vec2_zero(&params->uv1);
+		vec2_zero(&params->uv2);
+		vec2_zero(&params->uv3);
+		vec2_zero(&params->uv4);
+	} else {
+		params->uv1.x = params->topLeftX / (float)width;
+		params->uv1.y = params->topLeftY / (float)height;
+
+		params->uv2.x = params->topRightX / (float)width;
+		params->uv2.y = params->topRightY / (float)height;
+
+		params->uv3.x = params->bottomLeftX / (float)width;
+		params->uv3.y = params->bottomLeftY / (float)height;
+
+		params->uv4.x = params->bottomRightX / (float)width;
+		params->uv4.y = params->bottomRightY / (float)height;
+	}
+}
+
+static void apply_animation(struct corner_pin_params *params,
+			    struct keyframe_anim *anim)
+{
+	float *corners[NUM_ANIMATED] = {
+		&params->topLeftX,     &params->topLeftY,
+		&params->topRightX,    &params->topRightY,
+		&params->bottomLeftX,  &params->bottomLeftY,
+		&params->bottomRightX, &params->bottomRightY,
+	};
+
+	for (size_t i = 0; i < NUM_ANIMATED; i++) {
+		double value;
+		if (keyframe_anim_get(anim, i, &value))
+			*corners[i] = (float)value;
+	}
+}
+
 static void corner_pin_update(void *data, obs_data_t *settings)
 {
+	filter_profile_scope scope("corner_pin_update");
+
 	struct corner_pin_data *filter = (corner_pin_data *)data;
+	struct corner_pin_params params = {0};
+
+	params.topLeftX = (float)obs_data_get_int(settings, "topLeftX");
+	params.topLeftY = (float)obs_data_get_int(settings, "topLeftY");
+	params.topRightX = (float)obs_data_get_int(settings, "topRightX");
+	params.topRightY = (float)obs_data_get_int(settings, "topRightY");
+	params.bottomLeftX = (float)obs_data_get_int(settings, "bottomLeftX");
+	params.bottomLeftY = (float)obs_data_get_int(settings, "bottomLeftY");
+	params.bottomRightX =
+		(float)obs_data_get_int(settings, "bottomRightX");
+	params.bottomRightY =
+		(float)obs_data_get_int(settings, "bottomRightY");
+	params.outline = obs_data_get_bool(settings, "outline");
+	params.edge_aa = obs_data_get_bool(settings, "edge_aa");
+	params.quality = filter_quality_get(settings);
+	params.adaptive = filter_adaptive_get(settings);
+	filter_stats_update(&filter->stats, settings);
+	keyframe_anim_update(&filter->anim, settings);
 
-	filter->topLeftX = obs_data_get_int(settings, "topLeftX");
-	filter->topLeftY = obs_data_get_int(settings, "topLeftY");
-	filter->topRightX = obs_data_get_int(settings, "topRightX");
-	filter->topRightY = obs_data_get_int(settings, "topRightY");
-	filter->bottomLeftX = obs_data_get_int(settings, "bottomLeftX");
-	filter->bottomLeftY = obs_data_get_int(settings, "bottomLeftY");
-	filter->bottomRightX = obs_data_get_int(settings, "bottomRightX");
-	filter->bottomRightY = obs_data_get_int(settings, "bottomRightY");
-	filter->outline = obs_data_get_bool(settings, "outline");
 	obs_source_t *target = obs_filter_get_target(filter->context);
-	filter->texheight = obs_source_get_base_height(target);
-	filter->texwidth = obs_source_get_base_width(target);
+
+	filter_params_write_begin(&filter->params_lock);
+	filter->params = params;
+	apply_animation(&filter->params, &filter->anim);
+	calc_uv(&filter->params, obs_source_get_base_width(target),
+		obs_source_get_base_height(target));
+	filter_params_write_end(&filter->params_lock);
+}
+
+void corner_pin_set_corner(struct corner_pin_data *filter, int corner, int x,
+			   int y)
+{
+	filter_params_write_begin(&filter->params_lock);
+
+	struct corner_pin_params *params = &filter->params;
+
+	if (corner == 1) {
+		params->topLeftX = x;
+		params->topLeftY = y;
+	} else if (corner == 2) {
+		params->topRightX = x;
+		params->topRightY = y;
+	} else if (corner == 3) {
+		params->bottomLeftX = x;
+		params->bottomLeftY = y;
+	} else if (corner == 4) {
+		params->bottomRightX = x;
+		params->bottomRightY = y;
+	}
+
+	calc_uv(params, (uint32_t)params->texwidth,
+		(uint32_t)params->texheight);
+	filter_params_write_end(&filter->params_lock);
 }
 
 static void corner_pin_destroy(void *data)
 {
+	filter_profile_scope scope("corner_pin_destroy");
+
 	struct corner_pin_data *filter = (corner_pin_data *)data;
 
-	if (filter->effect) {
-		obs_enter_graphics();
-		gs_effect_destroy(filter->effect);
-		obs_leave_graphics();
-	}
+	effect_variants_release(&variants);
+	render_pool_release(&filter->stats);
 
-	if (filter->window) {
-		filter->window->close();
-		delete filter->window;
-		filter->window = nullptr;
-	}
+	obs_enter_graphics();
+	frame_capture_free(&filter->capture, &filter->stats);
+	gpu_timer_free(&filter->gpu_timer);
+	obs_leave_graphics();
 
+	corner_pin_editor_detach(filter);
+
+	keyframe_anim_free(&filter->anim);
+	filter_params_lock_free(&filter->params_lock);
 	bfree(data);
 }
 
 static void *corner_pin_create(obs_data_t *settings, obs_source_t *context)
 {
+	filter_profile_scope scope("corner_pin_create");
+
 	struct corner_pin_data *filter =
 		(corner_pin_data *)bzalloc(sizeof(struct corner_pin_data));
-	char *effect_path = obs_module_file("corner_pin_filter.effect");
 
 	filter->context = context;
+	filter_params_lock_init(&filter->params_lock);
+	keyframe_anim_init(&filter->anim, corner_pin_animated, NUM_ANIMATED);
+	filter_stats_init(&filter->stats, context, VRAM_CORNER_PIN);
+	filter_stats_budget(&filter->stats, 1);
+	gpu_timer_init(&filter->gpu_timer, context);
+	frame_capture_init(&filter->capture, context);
 
-	obs_enter_graphics();
+	effect_variants_acquire(&variants);
+	render_pool_acquire();
+
+	corner_pin_update(filter, settings);
+	return filter;
+}
 
-	filter->effect = gs_effect_create_from_file(effect_path, NULL);
-
-	if (filter->effect) {
-		filter->uv1_param =
-			gs_effect_get_param_by_name(filter->effect, "uv1");
-		filter->uv2_param =
-			gs_effect_get_param_by_name(filter->effect, "uv2");
-		filter->uv3_param =
-			gs_effect_get_param_by_name(filter->effect, "uv3");
-		filter->uv4_param =
-			gs_effect_get_param_by_name(filter->effect, "uv4");
-		filter->outline_param =
-			gs_effect_get_param_by_name(filter->effect, "outline");
-		filter->width =
-			gs_effect_get_param_by_name(filter->effect, "texwidth");
-		filter->height = gs_effect_get_param_by_name(filter->effect,
-							     "texheight");
+static void corner_pin_tick(void *data, float seconds)
+{
+	filter_profile_scope scope("corner_pin_tick");
+
+	struct corner_pin_data *filter = (corner_pin_data *)data;
+	struct corner_pin_params params;
+
+	corner_pin_read_params(filter, &params);
+
+	/* UVs are relative to the target, so they are republished only when
+	 * its size or an animated corner changes */
+	obs_source_t *target = obs_filter_get_target(filter->context);
+	uint32_t cx = obs_source_get_base_width(target);
+	uint32_t cy = obs_source_get_base_height(target);
+	bool animated = keyframe_anim_tick(&filter->anim, seconds);
+
+	if (animated || cx != (uint32_t)params.texwidth ||
+	    cy != (uint32_t)params.texheight) {
+		filter_params_write_begin(&filter->params_lock);
+		if (animated)
+			apply_animation(&filter->params, &filter->anim);
+		calc_uv(&filter->params, cx, cy);
+		params = filter->params;
+		filter_params_write_end(&filter->params_lock);
 	}
 
-	obs_leave_graphics();
+	if (params.adaptive)
+		filter_pressure_tick(seconds);
 
-	bfree(effect_path);
+	filter_stats_tick(&filter->stats, filter->context, &filter->gpu_timer,
+			  seconds);
+}
 
-	if (!filter->effect) {
-		corner_pin_destroy(filter);
+struct corner_pin_data *corner_pin_get_fusable(obs_source_t *source)
+{
+	if (!source || !obs_source_enabled(source))
+		return NULL;
+	if (strcmp(obs_source_get_id(source), corner_pin_filter.id) != 0)
+		return NULL;
+
+	struct corner_pin_data *filter =
+		(corner_pin_data *)obs_obj_get_data(source);
+	if (!filter || frame_capture_pending(&filter->capture))
+		return NULL;
+
+	/* The lens's fused pass has neither the outline nor edge coverage */
+	struct corner_pin_params params;
+	corner_pin_read_params(filter, &params);
+	if (params.outline || params.edge_aa)
 		return NULL;
-	}
 
-	corner_pin_update(filter, settings);
 	return filter;
 }
 
-static void calc_uv(struct corner_pin_data *filter, struct vec2 *uv1,
-		    struct vec2 *uv2, struct vec2 *uv3, struct vec2 *uv4)
+static void set_params(const struct corner_pin_params *cp,
+		       gs_eparam_t **params)
 {
-	obs_source_t *target = obs_filter_get_target(filter->context);
-	uint32_t width;
-	uint32_t height;
+	gs_effect_set_vec2(params[PARAM_UV1], &cp->uv1);
+	gs_effect_set_vec2(params[PARAM_UV2], &cp->uv2);
+	gs_effect_set_vec2(params[PARAM_UV3], &cp->uv3);
+	gs_effect_set_vec2(params[PARAM_UV4], &cp->uv4);
+	gs_effect_set_int(params[PARAM_TEXHEIGHT], (int)cp->texheight);
+	gs_effect_set_int(params[PARAM_TEXWIDTH], (int)cp->texwidth);
+}
 
-	if (!target) {
-		width = 0;
-		height = 0;
+static void draw_output(struct corner_pin_data *filter,
+			const struct effect_variant *variant,
+			const struct corner_pin_params *cp,
+			struct lens_distortion_data *lens,
+			const struct lens_distortion_params *lp)
+{
+	gs_eparam_t **params = variant->params;
+
+	if (!lens) {
+		if (!obs_source_process_filter_begin(
+			    filter->context, GS_RGBA,
+			    OBS_ALLOW_DIRECT_RENDERING))
+			return;
+
+		set_params(cp, params);
+		gpu_timer_begin(&filter->gpu_timer);
+		obs_source_process_filter_end(filter->context, variant->effect,
+					      0, 0);
+		gpu_timer_end(&filter->gpu_timer);
+		filter_stats_frame(&filter->stats, 1);
 		return;
-	} else {
-		width = obs_source_get_base_width(target);
-		height = obs_source_get_base_height(target);
 	}
 
-	uv1->x = (float)filter->topLeftX / (float)width;
-	uv1->y = (float)filter->topLeftY / (float)height;
-
-	uv2->x = (float)filter->topRightX / (float)width;
-	uv2->y = (float)filter->topRightY / (float)height;
+	/* The lens distortion below folds into this pass: render its input
+	 * and resample it once through both mappings. */
+	uint32_t cx = (uint32_t)cp->texwidth;
+	uint32_t cy = (uint32_t)cp->texheight;
 
-	uv3->x = (float)filter->bottomLeftX / (float)width;
-	uv3->y = (float)filter->bottomLeftY / (float)height;
+	gs_texrender_t *input =
+		render_pool_lease(GS_RGBA, cx, cy, &filter->stats);
 
-	uv4->x = (float)filter->bottomRightX / (float)width;
-	uv4->y = (float)filter->bottomRightY / (float)height;
-}
-
-static void corner_pin_tick(void *data, float seconds)
-{
-	struct corner_pin_data *filter = (corner_pin_data *)data;
+	if (!filter_render_input(input, filter->context,
+				 obs_filter_get_target(lens->context), cx,
+				 cy)) {
+		render_pool_return(input);
+		return;
+	}
 
-	vec2_zero(&filter->uv1);
-	vec2_zero(&filter->uv2);
-	vec2_zero(&filter->uv3);
-	vec2_zero(&filter->uv4);
-	calc_uv(filter, &filter->uv1, &filter->uv2, &filter->uv3, &filter->uv4);
+	set_params(cp, params);
+	gs_effect_set_float(params[PARAM_LENS_STRENGTH], (float)lp->strength);
+	gs_effect_set_float(params[PARAM_LENS_ZOOM], lp->zoom);
 
-	UNUSED_PARAMETER(seconds);
+	gpu_timer_begin(&filter->gpu_timer);
+	filter_draw_texture(variant->effect, params[PARAM_IMAGE],
+			    gs_texrender_get_texture(input), cx, cy);
+	gpu_timer_end(&filter->gpu_timer);
+	render_pool_return(input);
+	filter_stats_frame(&filter->stats, 1);
 }
 
 static void corner_pin_render(void *data, gs_effect_t *effect)
 {
+	filter_profile_scope scope("corner_pin_render");
+
 	struct corner_pin_data *filter = (corner_pin_data *)data;
 
-	if (!obs_source_process_filter_begin(filter->context, GS_RGBA,
-					     OBS_ALLOW_DIRECT_RENDERING))
+	struct corner_pin_params cp;
+	struct lens_distortion_params lp;
+
+	corner_pin_read_params(filter, &cp);
+
+	obs_source_t *target = obs_filter_get_target(filter->context);
+	struct lens_distortion_data *lens =
+		cp.outline ? NULL : lens_distortion_get_fusable(target);
+
+	if (lens)
+		lens_distortion_read_params(lens, &lp);
+
+	uint32_t features[NUM_FEATURES];
+	features[FEATURE_OUTLINE] = cp.outline;
+	features[FEATURE_FUSE_LENS] = lens != NULL;
+	features[FEATURE_LENS_HORIZONTAL] = lens && lp.dimension;
+	enum filter_quality quality = filter_quality_adapt(cp.quality,
+							   cp.adaptive);
+	if (lens)
+		quality = std::max(quality, filter_quality_adapt(lp.quality,
+								 lp.adaptive));
+	features[FEATURE_QUALITY] = quality;
+	features[FEATURE_EDGE_AA] = cp.edge_aa;
+
+	const struct effect_variant *variant = effect_variants_get(
+		&variants, effect_variants_key(&variants, features));
+
+	if (!variant) {
+		obs_source_skip_video_filter(filter->context);
 		return;
+	}
+
+	uint32_t cx = (uint32_t)cp.texwidth;
+	uint32_t cy = (uint32_t)cp.texheight;
 
-	gs_effect_set_vec2(filter->uv1_param, &filter->uv1);
-	gs_effect_set_vec2(filter->uv2_param, &filter->uv2);
-	gs_effect_set_vec2(filter->uv3_param, &filter->uv3);
-	gs_effect_set_vec2(filter->uv4_param, &filter->uv4);
-	gs_effect_set_int(filter->height, (int)&filter->texheight);
-	gs_effect_set_int(filter->width, (int)&filter->texwidth);
-	gs_effect_set_bool(filter->outline_param, filter->outline);
+	bool capture = frame_capture_begin(&filter->capture, &filter->stats,
+					   cx, cy);
 
-	obs_source_process_filter_end(filter->context, filter->effect, 0, 0);
+	draw_output(filter, variant, &cp, lens, &lp);
+
+	if (capture)
+		frame_capture_end(&filter->capture);
 
 	UNUSED_PARAMETER(effect);
 }
@@ -181,17 +382,17 @@ static void corner_pin_render(void *data, gs_effect_t *effect)
 static bool openUI(obs_properties_t *props, obs_property_t *property,
 		   void *data)
 {
-	struct corner_pin_data *filter = (corner_pin_data *)data;
-	obs_source_t *target = obs_filter_get_target(filter->context);
+	corner_pin_editor_open((corner_pin_data *)data);
 
-	if (!filter->window)
-		filter->window = new CornerPinWindow(nullptr, target, filter);
-	filter->window->show();
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
 	return true;
 }
 
 static obs_properties_t *corner_pin_properties(void *data)
 {
+	filter_profile_scope scope("corner_pin_properties");
+
 	obs_properties_t *props = obs_properties_create();
 
 	obs_properties_add_button(props, "openUI", "Open", openUI);
@@ -213,17 +414,27 @@ static obs_properties_t *corner_pin_properties(void *data)
 	obs_properties_add_int_slider(props, "bottomRightY", "Bottom Right Y",
 				      -8192, 8192, 1);
 	obs_properties_add_bool(props, "outline", "Display Box");
+	obs_properties_add_bool(props, "edge_aa", "Anti-alias Edges");
+	filter_quality_add_property(props);
+	filter_adaptive_add_property(props);
+	keyframe_anim_add_property(props);
+	filter_stats_add_property(props);
 
-	UNUSED_PARAMETER(data);
+	struct corner_pin_data *filter = (corner_pin_data *)data;
+	gpu_timer_add_property(props, filter ? &filter->gpu_timer : NULL);
 	return props;
 }
 
 static void corner_pin_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_bool(settings, "outline", false);
+	obs_data_set_default_bool(settings, "edge_aa", false);
+	obs_data_set_default_int(settings, "quality", QUALITY_9TAP);
+	obs_data_set_default_bool(settings, "adaptive_quality", false);
+	obs_data_set_default_bool(settings, "keyframes_loop", false);
 }
 
-struct obs_source_info corner_pin_filter = [&] {
+struct obs_source_info corner_pin_filter = [] {
 	obs_source_info corner_pin_filter = {0};
 
 	corner_pin_filter.id = "corner_pin_filter";
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <obs-module.h>
+#include <graphics/vec2.h>
+#include "effect-variants.hpp"
+#include "filter-pack.hpp"
+#include "frame-capture.hpp"
+#include "gpu-timer.hpp"
+#include "keyframes.hpp"
+
+/* Settings as last published by update or the editor, plus the UVs
+ * derived from them and the target's size.  Corners are whole pixels in
+ * the settings but keep the fractions keyframes animate them through. */
+struct corner_pin_params {
+	float topLeftX;
+	float topRightX;
+	float bottomLeftX;
+	float bottomRightX;
+	float topLeftY;
+	float topRightY;
+	float bottomLeftY;
+	float bottomRightY;
+	float texwidth, texheight;
+	struct vec2 uv1;
+	struct vec2 uv2;
+	struct vec2 uv3;
+	struct vec2 uv4;
+	bool outline;
+	bool edge_aa;
+	enum filter_quality quality;
+	bool adaptive;
+};
+
+struct corner_pin_data {
+	obs_source_t *context;
+
+	struct filter_params_lock params_lock;
+	struct corner_pin_params params;
+	struct keyframe_anim anim;
+
+	struct frame_capture capture;
+	struct filter_stats stats;
+	struct gpu_timer gpu_timer;
+};
+
+static inline void corner_pin_read_params(struct corner_pin_data *filter,
+					  struct corner_pin_params *params)
+{
+	filter_params_read(&filter->params_lock, params, &filter->params,
+			   sizeof(*params));
+}
+
+/* Moves corner `corner` (1 top left, 2 top right, 3 bottom left, 4 bottom
+ * right) to (`x`, `y`) in source pixels. */
+void corner_pin_set_corner(struct corner_pin_data *filter, int corner, int x,
+			   int y);
+
+/* Returns the corner pin instance behind `source` if it is one that an
+ * adjacent geometric filter can fold into its own resample, else NULL. */
+struct corner_pin_data *corner_pin_get_fusable(obs_source_t *source);
+
+/* The editor window lives in corner-pin-widget.cpp.  One editor is shared
+ * by every instance and retargeted to the one whose "Open" button was
+ * pressed; detach drops an instance that is being destroyed. */
+void corner_pin_editor_open(struct corner_pin_data *filter);
+void corner_pin_editor_detach(struct corner_pin_data *filter);
+void corner_pin_editor_free(void);
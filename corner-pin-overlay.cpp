@@ -0,0 +1,148 @@
+#include <obs-module.h>
+#include <graphics/vec3.h>
+#include <graphics/vec4.h>
+#include <math.h>
+#include <string.h>
+#include "corner-pin-overlay.hpp"
+#include "vram-stats.hpp"
+
+#define OVERLAY_VERT_BYTES                               \
+	((int64_t)(CORNER_PIN_OVERLAY_VERTS *            \
+		   (sizeof(struct vec3) + sizeof(uint32_t))))
+
+/* Packed as the COLOR vertex attribute expects, red in the low byte */
+#define OVERLAY_EDGE_COLOR 0xFFFF0000
+#define OVERLAY_HANDLE_COLOR 0xFF0000FF
+#define OVERLAY_SELECTED_COLOR 0xFF00FF00
+
+static gs_vertbuffer_t *create_buffer(void)
+{
+	struct gs_vb_data *vbd = gs_vbdata_create();
+	vbd->num = CORNER_PIN_OVERLAY_VERTS;
+	vbd->points = (struct vec3 *)bzalloc(sizeof(struct vec3) *
+					     CORNER_PIN_OVERLAY_VERTS);
+	vbd->colors = (uint32_t *)bzalloc(sizeof(uint32_t) *
+					  CORNER_PIN_OVERLAY_VERTS);
+
+	gs_vertbuffer_t *buffer = gs_vertexbuffer_create(vbd, GS_DYNAMIC);
+
+	if (buffer)
+		vram_stats_add(vram_stats_type(VRAM_EDITOR), NULL,
+			       OVERLAY_VERT_BYTES, true);
+	return buffer;
+}
+
+void corner_pin_overlay_free(struct corner_pin_overlay *overlay)
+{
+	if (!overlay->buffer)
+		return;
+
+	gs_vertexbuffer_destroy(overlay->buffer);
+	overlay->buffer = NULL;
+
+	vram_stats_add(vram_stats_type(VRAM_EDITOR), NULL, -OVERLAY_VERT_BYTES,
+		       false);
+}
+
+static void put_quad(struct vec3 *points, uint32_t *colors, const float x[4],
+		     const float y[4], uint32_t color)
+{
+	static const int order[6] = {0, 1, 2, 0, 2, 3};
+
+	for (int i = 0; i < 6; i++) {
+		vec3_set(&points[i], x[order[i]], y[order[i]], 0.0f);
+		colors[i] = color;
+	}
+}
+
+static void put_line(struct vec3 *points, uint32_t *colors, int x1, int y1,
+		     int x2, int y2)
+{
+	int border = 2;
+
+	int dX = x2 - x1;
+	int dY = y2 - y1;
+
+	double angle = atan2(dY, dX);
+	double rotSin = sin(angle);
+	double rotCos = cos(angle);
+
+	float x[4], y[4];
+	x[0] = x1 + border * (-1 * rotCos - -1 * rotSin);
+	x[1] = x1 + border * (-1 * rotCos - 1 * rotSin);
+	x[2] = x2 + border * (1 * rotCos - 1 * rotSin);
+	x[3] = x2 + border * (1 * rotCos - -1 * rotSin);
+
+	y[0] = y1 + border * (-1 * rotSin + -1 * rotCos);
+	y[1] = y1 + border * (-1 * rotSin + 1 * rotCos);
+	y[2] = y2 + border * (1 * rotSin + 1 * rotCos);
+	y[3] = y2 + border * (1 * rotSin + -1 * rotCos);
+
+	put_quad(points, colors, x, y, OVERLAY_EDGE_COLOR);
+}
+
+static void put_handle(struct vec3 *points, uint32_t *colors, int x, int y,
+		       bool selected)
+{
+	int size = 5;
+
+	float qx[4] = {float(x - size), float(x + size), float(x + size),
+		       float(x - size)};
+	float qy[4] = {float(y - size), float(y - size), float(y + size),
+		       float(y + size)};
+
+	put_quad(points, colors, qx, qy,
+		 selected ? OVERLAY_SELECTED_COLOR : OVERLAY_HANDLE_COLOR);
+}
+
+void corner_pin_overlay_draw(struct corner_pin_overlay *overlay,
+			     const int x[4], const int y[4], int selected)
+{
+	static const int edges[4][2] = {{0, 1}, {1, 3}, {3, 2}, {2, 0}};
+
+	struct vec3 points[CORNER_PIN_OVERLAY_VERTS];
+	uint32_t colors[CORNER_PIN_OVERLAY_VERTS];
+
+	for (int i = 0; i < 4; i++) {
+		int a = edges[i][0];
+		int b = edges[i][1];
+		put_line(points + i * 6, colors + i * 6, x[a], y[a], x[b],
+			 y[b]);
+	}
+	for (int i = 0; i < 4; i++)
+		put_handle(points + (i + 4) * 6, colors + (i + 4) * 6, x[i],
+			   y[i], selected == i + 1);
+
+	if (!overlay->buffer)
+		overlay->buffer = create_buffer();
+	if (!overlay->buffer)
+		return;
+
+	struct gs_vb_data *vbd = gs_vertexbuffer_get_data(overlay->buffer);
+	if (memcmp(vbd->points, points, sizeof(points)) != 0 ||
+	    memcmp(vbd->colors, colors, sizeof(colors)) != 0) {
+		memcpy(vbd->points, points, sizeof(points));
+		memcpy(vbd->colors, colors, sizeof(colors));
+		gs_vertexbuffer_flush(overlay->buffer);
+	}
+
+	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
+	gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
+	gs_technique_t *tech = gs_effect_get_technique(solid, "SolidColored");
+
+	struct vec4 white;
+	vec4_set(&white, 1.0f, 1.0f, 1.0f, 1.0f);
+	gs_effect_set_vec4(color, &white);
+
+	gs_load_vertexbuffer(overlay->buffer);
+	gs_load_indexbuffer(NULL);
+
+	gs_technique_begin(tech);
+	gs_technique_begin_pass(tech, 0);
+
+	gs_draw(GS_TRIS, 0, CORNER_PIN_OVERLAY_VERTS);
+	overlay->draws++;
+
+	gs_technique_end_pass(tech);
+	gs_technique_end(tech);
+}
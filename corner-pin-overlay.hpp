@@ -0,0 +1,24 @@
+#pragma once
+
+#include <obs-module.h>
+
+/* The corner pin editor's overlay: four edges and four handles, two
+ * triangles each, kept in one dynamic buffer that is only rewritten when
+ * something on it moves.  The whole overlay is a single draw. */
+#define CORNER_PIN_OVERLAY_QUADS 8
+#define CORNER_PIN_OVERLAY_VERTS (CORNER_PIN_OVERLAY_QUADS * 6)
+#define CORNER_PIN_OVERLAY_DRAW_BUDGET 1
+
+struct corner_pin_overlay {
+	gs_vertbuffer_t *buffer;
+
+	/* Draw calls made since the caller last cleared it */
+	long draws;
+};
+
+/* Corners in handle order: top left, top right, bottom left, bottom right.
+ * `selected` is the selected handle's corner number, or 0.  Both must be
+ * called from within the graphics context. */
+void corner_pin_overlay_draw(struct corner_pin_overlay *overlay,
+			     const int x[4], const int y[4], int selected);
+void corner_pin_overlay_free(struct corner_pin_overlay *overlay);
@@ -16,13 +16,15 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 
 #include "corner-pin-widget.hpp"
-#include <obs-frontend-api/obs-frontend-api.h>
+#include "corner-pin-filter.hpp"
+#include "vram-stats.hpp"
 #include <QScreen>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QCheckBox>
 #include <QMouseEvent>
 #include <QWheelEvent>
+#include <algorithm>
 #include "graphics/matrix4.h"
 
 struct TextSource {
@@ -31,65 +33,17 @@ struct TextSource {
 	gs_texture_t *tex = nullptr;
 };
 
-struct corner_pin_data {
-	obs_source_t *context;
-
-	gs_effect_t *effect;
-	gs_eparam_t *uv1_param, *uv2_param, *uv3_param, *uv4_param;
-	gs_eparam_t *width, *height;
-	gs_eparam_t *outline_param;
-
-	int topLeftX;
-	int topRightX;
-	int bottomLeftX;
-	int bottomRightX;
-	int topLeftY;
-	int topRightY;
-	int bottomLeftY;
-	int bottomRightY;
-	float texwidth, texheight;
-	struct vec2 uv1;
-	struct vec2 uv2;
-	struct vec2 uv3;
-	struct vec2 uv4;
-	bool outline;
-
-	CornerPinWidget *window;
-};
-
 using namespace std;
 
-CornerPinWindow::CornerPinWindow(QWidget *parent, obs_source_t *source_,
-				 void *data)
-	: QWidget(parent)
+CornerPinWindow::CornerPinWindow(QWidget *parent) : QWidget(parent)
 {
 	setAttribute(Qt::WA_NativeWindow);
 
-	obs_source_t *curScene = obs_frontend_get_current_scene();
-	scene = obs_scene_from_source(curScene);
-
-	source = source_;
-
 	QVBoxLayout *verticalLayout = new QVBoxLayout(this);
-	cornerWidget = new CornerPinWidget(this, source_, data);
+	cornerWidget = new CornerPinWidget(this);
 
 	QHBoxLayout *horizontalLayout = new QHBoxLayout(this);
 	comboBox = new QComboBox(this);
-	obs_scene_enum_items(
-		scene,
-		[](obs_scene_t *, obs_sceneitem_t *item, void *param) {
-			obs_source_t *source = obs_sceneitem_get_source(item);
-			CornerPinWindow *window = (CornerPinWindow *)param;
-			char *name = (char *)obs_source_get_name(source);
-			if (name == obs_source_get_name(window->source)) {
-				int items = window->comboBox->count();
-				window->comboBox->insertItem(
-					0, ("#" + to_string(items + 1)).c_str(),
-					obs_sceneitem_get_id(item));
-			}
-			return true;
-		},
-		this);
 	QCheckBox *check = new QCheckBox("Zoom To Scene Item", this);
 
 	QSizePolicy sizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -119,36 +73,65 @@ CornerPinWindow::CornerPinWindow(QWidget *parent, obs_source_t *source_,
 	};
 
 	auto changed = [this](int index) {
-		obs_scene_enum_items(
-			scene,
-			[](obs_scene_t *, obs_sceneitem_t *item, void *param) {
-				obs_source_t *source =
-					obs_sceneitem_get_source(item);
-				CornerPinWindow *window =
-					(CornerPinWindow *)param;
-				char *name =
-					(char *)obs_source_get_name(source);
-				if (name == obs_source_get_name(
-						    window->source) &&
-				    obs_sceneitem_get_id(item) ==
-					    window->comboBox->currentData()) {
-					window->cornerWidget->sceneitem = item;
-				}
-				return true;
-			},
-			this);
+		SelectItem(comboBox->itemData(index).toLongLong());
 	};
 
 	connect(comboBox, QOverload<int>::of(&QComboBox::activated), changed);
 	connect(check, &QCheckBox::stateChanged, checked);
 
-	obs_source_release(curScene);
+	obs_frontend_add_event_callback(FrontendEvent, this);
+}
+
+void CornerPinWindow::Retarget(obs_source_t *source_, void *data)
+{
+	if (source_ == source && data && cornerWidget->GetFilterData() == data)
+		return;
+
+	DisconnectScene();
+
+	source = source_;
+	cornerWidget->Retarget(source_, data);
+
+	if (source && isVisible()) {
+		obs_source_t *curScene = obs_frontend_get_current_scene();
+		ConnectScene(curScene);
+		obs_source_release(curScene);
+	}
+}
+
+/* May be called from any thread: the filter is being destroyed, so drop
+ * every reference to it right away and let the UI thread hide the editor. */
+void CornerPinWindow::Detach(void *data)
+{
+	if (!cornerWidget->Detach(data))
+		return;
+
+	QMetaObject::invokeMethod(
+		this,
+		[this]() {
+			if (!cornerWidget->GetFilterData())
+				hide();
+		},
+		Qt::QueuedConnection);
 }
 
 void CornerPinWindow::showEvent(QShowEvent *event)
 {
 	if (this->isMaximized())
 		showNormal();
+
+	if (source && !sceneSource) {
+		obs_source_t *curScene = obs_frontend_get_current_scene();
+		ConnectScene(curScene);
+		obs_source_release(curScene);
+	}
+	UNUSED_PARAMETER(event);
+}
+
+void CornerPinWindow::hideEvent(QHideEvent *event)
+{
+	/* Nothing to keep in sync while hidden */
+	DisconnectScene();
 	UNUSED_PARAMETER(event);
 }
 
@@ -159,43 +142,265 @@ void CornerPinWindow::resizeEvent(QResizeEvent *event)
 
 CornerPinWindow::~CornerPinWindow()
 {
-	return;
+	obs_frontend_remove_event_callback(FrontendEvent, this);
+	DisconnectScene();
 }
 
-CornerPinWidget::CornerPinWidget(QWidget *parent, obs_source_t *source_,
-				 void *data)
-	: QWidget(parent)
+void CornerPinWindow::FrontendEvent(enum obs_frontend_event event, void *data)
 {
-	filter_data = data;
+	CornerPinWindow *window = static_cast<CornerPinWindow *>(data);
+
+	if (event == OBS_FRONTEND_EVENT_SCENE_CHANGED) {
+		if (!window->source || !window->isVisible())
+			return;
+
+
+		obs_source_t *curScene = obs_frontend_get_current_scene();
+		window->ConnectScene(curScene);
+		obs_source_release(curScene);
+	} else if (event == OBS_FRONTEND_EVENT_EXIT) {
+		window->DisconnectScene();
+	}
+}
+
+void CornerPinWindow::ConnectScene(obs_source_t *newScene)
+{
+	if (newScene && newScene == sceneSource)
+		return;
+
+	DisconnectScene();
+
+	sceneSource = newScene;
+
+	CornerPinView newView;
+	newView.scene = newScene;
+	vec2_set(&newView.scale, 1.0f, 1.0f);
+	newView.sourceCX = max(obs_source_get_width(source), 1u);
+	newView.sourceCY = max(obs_source_get_height(source), 1u);
+
+	obs_video_info ovi;
+	if (obs_get_video_info(&ovi)) {
+		newView.sceneCX = max(ovi.base_width, 1u);
+		newView.sceneCY = max(ovi.base_height, 1u);
+	}
+
+	cornerWidget->SetView(newView);
+
+	if (!newScene)
+		return;
+
+	signal_handler_t *sh = obs_source_get_signal_handler(newScene);
+	signal_handler_connect(sh, "item_add", SceneItemAdd, this);
+	signal_handler_connect(sh, "item_remove", SceneItemRemove, this);
+	signal_handler_connect(sh, "item_transform", SceneItemTransform, this);
+	signal_handler_connect(sh, "item_visible", SceneItemVisible, this);
+
+	/* The only full walk of the scene: seed the item list once, after
+	 * which item_add/item_remove keep it current. */
+	obs_scene_enum_items(
+		obs_scene_from_source(newScene),
+		[](obs_scene_t *, obs_sceneitem_t *item, void *param) {
+			CornerPinWindow *window = (CornerPinWindow *)param;
+			window->AddItem(item);
+			return true;
+		},
+		this);
+
+	RefreshComboBox();
+
+	int64_t first = 0;
+	{
+		lock_guard<mutex> lock(itemsMutex);
+		if (!items.empty())
+			first = items.front().id;
+	}
+	if (first)
+		SelectItem(first);
+}
+
+void CornerPinWindow::DisconnectScene()
+{
+	if (sceneSource) {
+		signal_handler_t *sh =
+			obs_source_get_signal_handler(sceneSource);
+		signal_handler_disconnect(sh, "item_add", SceneItemAdd, this);
+		signal_handler_disconnect(sh, "item_remove", SceneItemRemove,
+					  this);
+		signal_handler_disconnect(sh, "item_transform",
+					  SceneItemTransform, this);
+		signal_handler_disconnect(sh, "item_visible", SceneItemVisible,
+					  this);
+		sceneSource = nullptr;
+	}
+
+	{
+		lock_guard<mutex> lock(itemsMutex);
+		items.clear();
+	}
+
+	cornerWidget->SetView(CornerPinView());
+	RefreshComboBox();
+}
+
+void CornerPinWindow::AddItem(obs_sceneitem_t *item)
+{
+	if (obs_sceneitem_get_source(item) != source)
+		return;
+
+	lock_guard<mutex> lock(itemsMutex);
+	items.push_back({obs_sceneitem_get_id(item), item});
+}
+
+void CornerPinWindow::RemoveItem(obs_sceneitem_t *item)
+{
+	{
+		lock_guard<mutex> lock(itemsMutex);
+		items.erase(remove_if(items.begin(), items.end(),
+				      [item](const SceneItemEntry &entry) {
+					      return entry.item == item;
+				      }),
+			    items.end());
+	}
+
+	cornerWidget->UpdateView([item](CornerPinView &view) {
+		if (view.sceneitem == item) {
+			view.sceneitem = nullptr;
+			view.visible = false;
+		}
+	});
+}
+
+void CornerPinWindow::UpdateItemTransform(obs_sceneitem_t *item)
+{
+	filter_profile_scope scope("CornerPinWindow::UpdateItemTransform");
+
+	if (!item)
+		return;
+
+	obs_source_t *itemSource = source;
+	cornerWidget->UpdateView([item, itemSource](CornerPinView &view) {
+		if (view.sceneitem != item)
+			return;
+
+		obs_sceneitem_get_pos(item, &view.pos);
+		obs_sceneitem_get_scale(item, &view.scale);
+		view.visible = obs_sceneitem_visible(item);
+		view.sourceCX = max(obs_source_get_width(itemSource), 1u);
+		view.sourceCY = max(obs_source_get_height(itemSource), 1u);
+	});
+}
+
+void CornerPinWindow::RefreshComboBox()
+{
+	vector<int64_t> ids;
+	{
+		lock_guard<mutex> lock(itemsMutex);
+		for (const SceneItemEntry &entry : items)
+			ids.push_back(entry.id);
+	}
+
+	comboBox->clear();
+	for (size_t i = 0; i < ids.size(); i++)
+		comboBox->addItem(("#" + to_string(i + 1)).c_str(),
+				  (qlonglong)ids[i]);
+}
+
+void CornerPinWindow::SelectItem(int64_t id)
+{
+	obs_sceneitem_t *item = nullptr;
+	{
+		lock_guard<mutex> lock(itemsMutex);
+		for (const SceneItemEntry &entry : items) {
+			if (entry.id == id) {
+				item = entry.item;
+				break;
+			}
+		}
+	}
+
+	cornerWidget->UpdateView([item](CornerPinView &view) {
+		view.sceneitem = item;
+		view.visible = false;
+	});
+
+	UpdateItemTransform(item);
+}
+
+void CornerPinWindow::SceneItemAdd(void *data, calldata_t *cd)
+{
+	CornerPinWindow *window = static_cast<CornerPinWindow *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	if (obs_sceneitem_get_source(item) != window->source)
+		return;
+
+	window->AddItem(item);
+	QMetaObject::invokeMethod(
+		window, [window]() { window->RefreshComboBox(); },
+		Qt::QueuedConnection);
+}
+
+void CornerPinWindow::SceneItemRemove(void *data, calldata_t *cd)
+{
+	CornerPinWindow *window = static_cast<CornerPinWindow *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	if (obs_sceneitem_get_source(item) != window->source)
+		return;
+
+	window->RemoveItem(item);
+	QMetaObject::invokeMethod(
+		window, [window]() { window->RefreshComboBox(); },
+		Qt::QueuedConnection);
+}
+
+void CornerPinWindow::SceneItemTransform(void *data, calldata_t *cd)
+{
+	CornerPinWindow *window = static_cast<CornerPinWindow *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+
+	window->UpdateItemTransform(item);
+}
+
+void CornerPinWindow::SceneItemVisible(void *data, calldata_t *cd)
+{
+	CornerPinWindow *window = static_cast<CornerPinWindow *>(data);
+	obs_sceneitem_t *item = (obs_sceneitem_t *)calldata_ptr(cd, "item");
+	bool visible = calldata_bool(cd, "visible");
+
+	window->cornerWidget->UpdateView([item, visible](CornerPinView &view) {
+		if (item && view.sceneitem == item)
+			view.visible = visible;
+	});
+}
+
+/* A display owns a front and a back buffer */
+static int64_t swapChainBytes(uint32_t cx, uint32_t cy)
+{
+	return 2 * vram_texture_bytes(GS_RGBA, cx, cy);
+}
 
+CornerPinWidget::CornerPinWidget(QWidget *parent) : QWidget(parent)
+{
 	setAttribute(Qt::WA_PaintOnScreen);
 	setAttribute(Qt::WA_NoSystemBackground);
 	setAttribute(Qt::WA_OpaquePaintEvent);
 	setAttribute(Qt::WA_DontCreateNativeAncestors);
 	setAttribute(Qt::WA_NativeWindow);
 
-	source = source_;
-
-	fill(verts, verts + 8, nullptr);
-
 	auto windowVisible = [this](bool visible) {
 		if (!visible)
 			return;
 
-		if (!display) {
+		if (!display)
 			CreateDisplay();
-		} else {
-			QSize size = this->size() * this->devicePixelRatio();
-			obs_display_resize(display, size.width(),
-					   size.height());
-		}
+		else
+			ResizeDisplay();
 	};
 
 	auto sizeChanged = [this](QScreen *) {
 		CreateDisplay();
-
-		QSize size = this->size() * this->devicePixelRatio();
-		obs_display_resize(display, size.width(), size.height());
+		ResizeDisplay();
 	};
 
 	connect(windowHandle(), &QWindow::visibleChanged, windowVisible);
@@ -204,16 +409,67 @@ CornerPinWidget::CornerPinWidget(QWidget *parent, obs_source_t *source_,
 
 CornerPinWidget::~CornerPinWidget()
 {
-	obs_display_remove_draw_callback(this->GetDisplay(), drawPreview, this);
-	obs_display_destroy(display);
-	if (text)
+	ReleaseDisplay();
+}
+
+void CornerPinWidget::Retarget(obs_source_t *source_, void *data)
+{
+	lock_guard<mutex> lock(targetMutex);
+
+	if (display)
+		obs_display_remove_draw_callback(display, drawPreview, this);
+
+	source = source_;
+	filter_data = data;
+	selected = 0;
+	mouseDrag = false;
+
+	if (display && data)
+		obs_display_add_draw_callback(display, drawPreview, this);
+}
+
+bool CornerPinWidget::Detach(void *data)
+{
+	lock_guard<mutex> lock(targetMutex);
+
+	if (!data || filter_data != data)
+		return false;
+
+	source = nullptr;
+	filter_data = nullptr;
+
+	/* Waits for a draw that may still be using the old filter */
+	if (display)
+		obs_display_remove_draw_callback(display, drawPreview, this);
+	return true;
+}
+
+/* The swap chain, the label source and the overlay geometry are only needed
+ * while the editor is on screen, so they are dropped whenever it hides and
+ * recreated by CreateDisplay on the next expose. */
+void CornerPinWidget::ReleaseDisplay()
+{
+	lock_guard<mutex> lock(targetMutex);
+
+	if (display) {
+		obs_display_remove_draw_callback(display, drawPreview, this);
+		obs_display_destroy(display);
+		display = nullptr;
+
+		vram_stats_add(vram_stats_type(VRAM_EDITOR), nullptr,
+			       -displayBytes, false);
+		displayBytes = 0;
+	}
+
+	if (text) {
 		obs_source_release(text);
+		text = nullptr;
+	}
+
+	mouseDrag = false;
 
 	obs_enter_graphics();
-	for (int i = 0; i < 8; i++) {
-		if (verts[i])
-			gs_vertexbuffer_destroy(verts[i]);
-	}
+	corner_pin_overlay_free(&overlay);
 	obs_leave_graphics();
 }
 
@@ -272,9 +528,34 @@ void CornerPinWidget::CreateDisplay()
 	info.window.display = QX11Info::display();
 #endif
 
+	lock_guard<mutex> lock(targetMutex);
+
 	display = obs_display_create(&info, 0);
 
-	obs_display_add_draw_callback(this->GetDisplay(), drawPreview, this);
+	if (display) {
+		displayBytes = swapChainBytes(info.cx, info.cy);
+		vram_stats_add(vram_stats_type(VRAM_EDITOR), nullptr,
+			       displayBytes, true);
+	}
+
+	if (filter_data)
+		obs_display_add_draw_callback(this->GetDisplay(), drawPreview,
+					      this);
+}
+
+void CornerPinWidget::ResizeDisplay()
+{
+	if (!display)
+		return;
+
+	QSize size = this->size() * this->devicePixelRatio();
+	obs_display_resize(display, size.width(), size.height());
+
+	int64_t bytes = swapChainBytes(size.width(), size.height());
+
+	vram_stats_add(vram_stats_type(VRAM_EDITOR), nullptr,
+		       bytes - displayBytes, false);
+	displayBytes = bytes;
 }
 
 void CornerPinWidget::handleResizeRequest(int width, int height)
@@ -283,6 +564,24 @@ void CornerPinWidget::handleResizeRequest(int width, int height)
 	UNUSED_PARAMETER(height);
 }
 
+CornerPinView CornerPinWidget::GetView()
+{
+	lock_guard<mutex> lock(viewMutex);
+	return view;
+}
+
+void CornerPinWidget::SetView(const CornerPinView &newView)
+{
+	lock_guard<mutex> lock(viewMutex);
+	view = newView;
+}
+
+void CornerPinWidget::UpdateView(const function<void(CornerPinView &)> &func)
+{
+	lock_guard<mutex> lock(viewMutex);
+	func(view);
+}
+
 static void GetScaleAndCenterPos(int baseCX, int baseCY, int windowCX,
 				 int windowCY, int &x, int &y, float &scale)
 {
@@ -306,132 +605,53 @@ static void GetScaleAndCenterPos(int baseCX, int baseCY, int windowCX,
 	y = windowCY / 2 - newCY / 2;
 }
 
-static void fillVert(float r, float g, float b, float a)
-{
-	gs_effect_t *solid = obs_get_base_effect(OBS_EFFECT_SOLID);
-	gs_eparam_t *color = gs_effect_get_param_by_name(solid, "color");
-	gs_technique_t *tech = gs_effect_get_technique(solid, "Solid");
-
-	vec4 colorVal;
-	vec4_set(&colorVal, r, g, b, a);
-	gs_effect_set_vec4(color, &colorVal);
-
-	gs_technique_begin(tech);
-	gs_technique_begin_pass(tech, 0);
-
-	gs_draw(GS_TRISTRIP, 0, 0);
-
-	gs_technique_end_pass(tech);
-	gs_technique_end(tech);
-}
-
-static void drawLine(int x1, int y1, int x2, int y2, gs_vertbuffer_t **verts,
-		     int index)
-{
-	int border = 2;
-
-	int dX = x2 - x1;
-	int dY = y2 - y1;
-
-	double angle = atan2(dY, dX);
-	double rotSin = sin(angle);
-	double rotCos = cos(angle);
-
-	float cx1 = x1 + border * (-1 * rotCos - -1 * rotSin);
-	float cx2 = x1 + border * (-1 * rotCos - 1 * rotSin);
-	float cx3 = x2 + border * (1 * rotCos - 1 * rotSin);
-	float cx4 = x2 + border * (1 * rotCos - -1 * rotSin);
-
-	float cy1 = y1 + border * (-1 * rotSin + -1 * rotCos);
-	float cy2 = y1 + border * (-1 * rotSin + 1 * rotCos);
-	float cy3 = y2 + border * (1 * rotSin + 1 * rotCos);
-	float cy4 = y2 + border * (1 * rotSin + -1 * rotCos);
-
-	if (verts[index])
-		gs_vertexbuffer_destroy(verts[index]);
-
-	gs_render_start(true);
-	gs_vertex2f(cx1, cy1);
-	gs_vertex2f(cx2, cy2);
-	gs_vertex2f(cx3, cy3);
-	gs_vertex2f(cx4, cy4);
-	gs_vertex2f(cx1, cy1);
-	verts[index] = gs_render_save();
-
-	gs_load_vertexbuffer(verts[index]);
-
-	fillVert(0.0f, 0.0f, 1.0f, 1.0f);
-}
-
-static void drawHandle(int x, int y, bool selected, gs_vertbuffer_t **verts,
-		       int index)
-{
-	int size = 5;
-
-	if (verts[index])
-		gs_vertexbuffer_destroy(verts[index]);
-
-	gs_render_start(true);
-	gs_vertex2f(x - size, y - size);
-	gs_vertex2f(x + size, y - size);
-	gs_vertex2f(x + size, y + size);
-	gs_vertex2f(x - size, y + size);
-	gs_vertex2f(x - size, y - size);
-	verts[index] = gs_render_save();
-
-	gs_load_vertexbuffer(verts[index]);
-
-	fillVert(selected ? 0.0f : 1.0f, selected ? 1.0f : 0.0f, 0.0f, 1.0f);
-}
-
 void CornerPinWidget::drawPreview(void *data, uint32_t cx, uint32_t cy)
 {
+	filter_profile_scope scope("CornerPinWidget::drawPreview");
+
 	CornerPinWidget *window = static_cast<CornerPinWidget *>(data);
+	corner_pin_data *filter = (corner_pin_data *)window->filter_data.load();
 
-	if (!window->source)
+	if (!filter)
 		return;
 
-	corner_pin_data *filter = (corner_pin_data *)window->filter_data;
+	corner_pin_params corners;
+	corner_pin_read_params(filter, &corners);
 
-	obs_source_t *currentScene = obs_frontend_get_current_scene();
+	CornerPinView view = window->GetView();
+	obs_source_t *currentScene = view.scene;
+
+	if (!currentScene)
+		return;
 
-	uint32_t sceneCX = max(obs_source_get_width(currentScene), 1u);
-	uint32_t sceneCY = max(obs_source_get_height(currentScene), 1u);
+	uint32_t sceneCX = view.sceneCX;
+	uint32_t sceneCY = view.sceneCY;
 
 	uint32_t areaCX;
 	uint32_t areaCY;
 
-	vec2 itemScale, itemSize, pos;
+	vec2 itemScale, pos;
 	itemScale.x = 1.0f;
 	itemScale.y = 1.0f;
+	vec2_zero(&pos);
 
 	int x, y;
 	int newCX, newCY;
 	int offX, offY;
 	float scale;
 
-	if (window->sceneitem) {
-		obs_sceneitem_get_scale(window->sceneitem, &itemScale);
+	if (view.sceneitem) {
+		itemScale = view.scale;
 
 		if (window->zoom) {
-			areaCX = max(obs_source_get_width(window->source), 1u) *
-				 itemScale.x;
-			areaCY =
-				max(obs_source_get_height(window->source), 1u) *
-				itemScale.y;
+			areaCX = view.sourceCX * itemScale.x;
+			areaCY = view.sourceCY * itemScale.y;
 		} else {
 			areaCX = sceneCX;
 			areaCY = sceneCY;
-
-			itemSize.x =
-				max(obs_source_get_width(window->source), 1u) *
-				itemScale.x;
-			itemSize.y =
-				max(obs_source_get_width(window->source), 1u) *
-				itemScale.x;
 		}
 
-		obs_sceneitem_get_pos(window->sceneitem, &pos);
+		pos = view.pos;
 
 		offX = pos.x;
 		offY = pos.y;
@@ -459,7 +679,7 @@ void CornerPinWidget::drawPreview(void *data, uint32_t cx, uint32_t cy)
 	gs_viewport_push();
 	gs_projection_push();
 
-	if (window->sceneitem && window->zoom) {
+	if (view.sceneitem && window->zoom) {
 		gs_ortho(offX, areaCX + offX, offY, areaCY + offY, -100.0f,
 			 100.0f);
 	} else {
@@ -470,8 +690,8 @@ void CornerPinWidget::drawPreview(void *data, uint32_t cx, uint32_t cy)
 
 	obs_source_video_render(currentScene);
 
-	if (obs_sceneitem_visible(window->sceneitem)) {
-		if (window->sceneitem && window->zoom) {
+	if (view.sceneitem && view.visible) {
+		if (window->zoom) {
 			gs_ortho(0.0f, float(sceneCX), 0.0f, float(sceneCY),
 				 -100.0f, 100.0f);
 			offX = 0;
@@ -481,39 +701,31 @@ void CornerPinWidget::drawPreview(void *data, uint32_t cx, uint32_t cy)
 			itemScale.y = 1.0f;
 		}
 
-		drawLine(filter->topLeftX * itemScale.x + offX,
-			 filter->topLeftY * itemScale.y + offY,
-			 filter->topRightX * itemScale.x + offX,
-			 filter->topRightY * itemScale.y + offY, window->verts,
-			 0);
-		drawLine(filter->topRightX * itemScale.x + offX,
-			 filter->topRightY * itemScale.y + offY,
-			 filter->bottomRightX * itemScale.x + offX,
-			 filter->bottomRightY * itemScale.y + offY,
-			 window->verts, 1);
-		drawLine(filter->bottomRightX * itemScale.x + offX,
-			 filter->bottomRightY * itemScale.y + offY,
-			 filter->bottomLeftX * itemScale.x + offX,
-			 filter->bottomLeftY * itemScale.y + offY,
-			 window->verts, 2);
-		drawLine(filter->bottomLeftX * itemScale.x + offX,
-			 filter->bottomLeftY * itemScale.y + offY,
-			 filter->topLeftX * itemScale.x + offX,
-			 filter->topLeftY * itemScale.y + offY, window->verts,
-			 3);
-
-		drawHandle(filter->topLeftX * itemScale.x + offX,
-			   filter->topLeftY * itemScale.y + offY,
-			   window->selected == 1, window->verts, 4);
-		drawHandle(filter->topRightX * itemScale.x + offX,
-			   filter->topRightY * itemScale.y + offY,
-			   window->selected == 2, window->verts, 5);
-		drawHandle(filter->bottomLeftX * itemScale.x + offX,
-			   filter->bottomLeftY * itemScale.y + offY,
-			   window->selected == 3, window->verts, 6);
-		drawHandle(filter->bottomRightX * itemScale.x + offX,
-			   filter->bottomRightY * itemScale.y + offY,
-			   window->selected == 4, window->verts, 7);
+		int handleX[4] = {
+			int(corners.topLeftX * itemScale.x + offX),
+			int(corners.topRightX * itemScale.x + offX),
+			int(corners.bottomLeftX * itemScale.x + offX),
+			int(corners.bottomRightX * itemScale.x + offX)};
+		int handleY[4] = {
+			int(corners.topLeftY * itemScale.y + offY),
+			int(corners.topRightY * itemScale.y + offY),
+			int(corners.bottomLeftY * itemScale.y + offY),
+			int(corners.bottomRightY * itemScale.y + offY)};
+
+		window->overlay.draws = 0;
+		corner_pin_overlay_draw(&window->overlay, handleX, handleY,
+					window->selected);
+
+#ifdef FILTER_PACK_BUDGETS
+		static bool reported = false;
+		if (window->overlay.draws > CORNER_PIN_OVERLAY_DRAW_BUDGET &&
+		    !reported) {
+			filter_budget_report("editor overlay draws",
+					     window->overlay.draws,
+					     CORNER_PIN_OVERLAY_DRAW_BUDGET);
+			reported = true;
+		}
+#endif
 
 		if (window->mouseDrag) {
 			uint32_t textWidth = obs_source_get_width(window->text);
@@ -542,8 +754,6 @@ void CornerPinWidget::drawPreview(void *data, uint32_t cx, uint32_t cy)
 
 	gs_projection_pop();
 	gs_viewport_pop();
-
-	obs_source_release(currentScene);
 }
 
 void CornerPinWidget::resizeEvent(QResizeEvent *event)
@@ -552,10 +762,8 @@ void CornerPinWidget::resizeEvent(QResizeEvent *event)
 
 	CreateDisplay();
 
-	if (isVisible() && display) {
-		QSize size = this->size() * this->devicePixelRatio();
-		obs_display_resize(display, size.width(), size.height());
-	}
+	if (isVisible())
+		ResizeDisplay();
 }
 
 void CornerPinWidget::paintEvent(QPaintEvent *event)
@@ -567,31 +775,36 @@ void CornerPinWidget::paintEvent(QPaintEvent *event)
 
 void CornerPinWidget::showEvent(QShowEvent *event)
 {
-	if (display)
-		obs_display_add_draw_callback(this->GetDisplay(), drawPreview,
-					      this);
+	CreateDisplay();
 	UNUSED_PARAMETER(event);
 }
 
 void CornerPinWidget::hideEvent(QHideEvent *event)
 {
-	obs_display_remove_draw_callback(this->GetDisplay(), drawPreview, this);
+	ReleaseDisplay();
 
-	corner_pin_data *filter = (corner_pin_data *)filter_data;
-	obs_source_update_properties(filter->context);
+	lock_guard<mutex> lock(targetMutex);
+	corner_pin_data *filter = (corner_pin_data *)filter_data.load();
+	if (filter)
+		obs_source_update_properties(filter->context);
 	UNUSED_PARAMETER(event);
 }
 
 void CornerPinWidget::mousePressEvent(QMouseEvent *event)
 {
-	corner_pin_data *filter = (corner_pin_data *)filter_data;
+	filter_profile_scope scope("CornerPinWidget::mousePressEvent");
 
-	vec2 itemScale, pos;
-	obs_sceneitem_get_scale(sceneitem, &itemScale);
-	obs_sceneitem_get_pos(sceneitem, &pos);
+	lock_guard<mutex> lock(targetMutex);
+	corner_pin_data *filter = (corner_pin_data *)filter_data.load();
+
+	if (!filter)
+		return;
+
+	CornerPinView curView = GetView();
+	vec2 itemScale = curView.scale, pos = curView.pos;
 
-	uint32_t width = obs_source_get_width(source);
-	uint32_t height = obs_source_get_height(source);
+	uint32_t width = curView.sourceCX;
+	uint32_t height = curView.sourceCY;
 
 	vec2 scale;
 	vec2_set(&scale, previewW / float(width), previewH / float(height));
@@ -607,14 +820,17 @@ void CornerPinWidget::mousePressEvent(QMouseEvent *event)
 	vec2 res;
 	vec2_set(&res, previewW, previewH);
 
+	corner_pin_params corners;
+	corner_pin_read_params(filter, &corners);
+
 	vec2 uv1;
-	vec2_mul(&uv1, &filter->uv1, &res);
+	vec2_mul(&uv1, &corners.uv1, &res);
 	vec2 uv2;
-	vec2_mul(&uv2, &filter->uv2, &res);
+	vec2_mul(&uv2, &corners.uv2, &res);
 	vec2 uv3;
-	vec2_mul(&uv3, &filter->uv3, &res);
+	vec2_mul(&uv3, &corners.uv3, &res);
 	vec2 uv4;
-	vec2_mul(&uv4, &filter->uv4, &res);
+	vec2_mul(&uv4, &corners.uv4, &res);
 
 	if (vec2_dist(&mouse, &uv1) < 10) {
 		selected = 1;
@@ -632,16 +848,23 @@ void CornerPinWidget::mousePressEvent(QMouseEvent *event)
 void CornerPinWidget::mouseReleaseEvent(QMouseEvent *event)
 {
 	mouseDrag = false;
-	obs_source_set_enabled(text, false);
+	if (text)
+		obs_source_set_enabled(text, false);
+	UNUSED_PARAMETER(event);
 }
 
 void CornerPinWidget::mouseMoveEvent(QMouseEvent *event)
 {
-	corner_pin_data *filter = (corner_pin_data *)filter_data;
+	filter_profile_scope scope("CornerPinWidget::mouseMoveEvent");
 
-	vec2 itemScale, pos;
-	obs_sceneitem_get_scale(sceneitem, &itemScale);
-	obs_sceneitem_get_pos(sceneitem, &pos);
+	lock_guard<mutex> lock(targetMutex);
+	corner_pin_data *filter = (corner_pin_data *)filter_data.load();
+
+	if (!filter || !text)
+		return;
+
+	CornerPinView curView = GetView();
+	vec2 itemScale = curView.scale, pos = curView.pos;
 
 	int addX = !zoom ? 0 : pos.x / itemScale.x;
 	int addY = !zoom ? 0 : pos.y / itemScale.y;
@@ -654,8 +877,6 @@ void CornerPinWidget::mouseMoveEvent(QMouseEvent *event)
 		vec2_div(&movedMouse, &movedMouse, &itemScale);
 	}
 
-	obs_data_t *settings = obs_source_get_settings(filter->context);
-
 	if (!mouseDrag && selected > 0 && vec2_dist(&movedMouse, &mouse) > 3) {
 		mouseDrag = true;
 		obs_source_set_enabled(text, true);
@@ -664,25 +885,21 @@ void CornerPinWidget::mouseMoveEvent(QMouseEvent *event)
 		if (zoom)
 			vec2_div(&movedMouse, &movedMouse, &itemScale);
 
-		corner_pin_data *filter = (corner_pin_data *)filter_data;
+		obs_data_t *settings = obs_source_get_settings(filter->context);
+
+		corner_pin_set_corner(filter, selected, movedMouse.x,
+				      movedMouse.y);
+
 		if (selected == 1) {
-			filter->topLeftX = movedMouse.x;
-			filter->topLeftY = movedMouse.y;
 			obs_data_set_int(settings, "topLeftX", movedMouse.x);
 			obs_data_set_int(settings, "topLeftY", movedMouse.y);
 		} else if (selected == 2) {
-			filter->topRightX = movedMouse.x;
-			filter->topRightY = movedMouse.y;
 			obs_data_set_int(settings, "topRightX", movedMouse.x);
 			obs_data_set_int(settings, "topRightY", movedMouse.y);
 		} else if (selected == 3) {
-			filter->bottomLeftX = movedMouse.x;
-			filter->bottomLeftY = movedMouse.y;
 			obs_data_set_int(settings, "bottomLeftX", movedMouse.x);
 			obs_data_set_int(settings, "bottomLeftY", movedMouse.y);
 		} else if (selected == 4) {
-			filter->bottomRightX = movedMouse.x;
-			filter->bottomRightY = movedMouse.y;
 			obs_data_set_int(settings, "bottomRightX",
 					 movedMouse.x);
 			obs_data_set_int(settings, "bottomRightY",
@@ -697,14 +914,13 @@ void CornerPinWidget::mouseMoveEvent(QMouseEvent *event)
 
 		obs_source_update(text, textSettings);
 		obs_data_release(textSettings);
+		obs_data_release(settings);
 	}
-
-	obs_data_release(settings);
 }
 
 void CornerPinWidget::wheelEvent(QWheelEvent *event)
 {
-	if (mouseDrag) {
+	if (mouseDrag && text) {
 		obs_data_t *textSettings = obs_source_get_settings(text);
 		obs_data_t *font = obs_data_get_obj(textSettings, "font");
 		if (event->angleDelta().y() >= 0) {
@@ -727,3 +943,27 @@ QPaintEngine *CornerPinWidget::paintEngine() const
 {
 	return nullptr;
 }
+
+/* One editor is shared by every corner pin instance */
+static CornerPinWindow *editor = nullptr;
+
+void corner_pin_editor_open(struct corner_pin_data *filter)
+{
+	if (!editor)
+		editor = new CornerPinWindow(nullptr);
+	editor->Retarget(obs_filter_get_target(filter->context), filter);
+	editor->show();
+	editor->raise();
+}
+
+void corner_pin_editor_detach(struct corner_pin_data *filter)
+{
+	if (editor)
+		editor->Detach(filter);
+}
+
+void corner_pin_editor_free(void)
+{
+	delete editor;
+	editor = nullptr;
+}
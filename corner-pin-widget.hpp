@@ -19,28 +19,77 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QWindow>
 #include <QComboBox>
 #include <obs.hpp>
+#include <obs-frontend-api/obs-frontend-api.h>
+#include "corner-pin-overlay.hpp"
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
 
 class CornerPinWindow;
 class CornerPinWidget;
 
+/* Snapshot of everything the editor needs from the scene to draw and hit
+ * test.  Kept up to date by scene signals so that the editor's hot paths
+ * never have to walk the scene or query libobs. */
+struct CornerPinView {
+	OBSSource scene;
+	uint32_t sceneCX = 1;
+	uint32_t sceneCY = 1;
+
+	obs_sceneitem_t *sceneitem = nullptr;
+	bool visible = false;
+	vec2 pos = {};
+	vec2 scale = {};
+	uint32_t sourceCX = 1;
+	uint32_t sourceCY = 1;
+};
+
 class CornerPinWindow : public QWidget {
 	CornerPinWidget *cornerWidget;
 
+	struct SceneItemEntry {
+		int64_t id;
+		obs_sceneitem_t *item;
+	};
+
+	std::mutex itemsMutex;
+	std::vector<SceneItemEntry> items;
+	OBSSource sceneSource;
+
+	void ConnectScene(obs_source_t *newScene);
+	void DisconnectScene();
+	void AddItem(obs_sceneitem_t *item);
+	void RemoveItem(obs_sceneitem_t *item);
+	void UpdateItemTransform(obs_sceneitem_t *item);
+	void RefreshComboBox();
+	void SelectItem(int64_t id);
+
+	static void SceneItemAdd(void *data, calldata_t *cd);
+	static void SceneItemRemove(void *data, calldata_t *cd);
+	static void SceneItemTransform(void *data, calldata_t *cd);
+	static void SceneItemVisible(void *data, calldata_t *cd);
+	static void FrontendEvent(enum obs_frontend_event event, void *data);
+
 public:
-	obs_source_t *source;
-	obs_scene_t *scene;
+	obs_source_t *source = nullptr;
 	QComboBox *comboBox;
-	CornerPinWindow(QWidget *parent, obs_source_t *source_, void *data);
+	CornerPinWindow(QWidget *parent);
 	~CornerPinWindow();
+	void Retarget(obs_source_t *source_, void *data);
+	void Detach(void *data);
 	void showEvent(QShowEvent *event) override;
+	void hideEvent(QHideEvent *event) override;
 	void resizeEvent(QResizeEvent *event) override;
 };
 
 class CornerPinWidget : public QWidget {
 	obs_display_t *display = nullptr;
+	int64_t displayBytes = 0;
 	obs_source_t *text = nullptr;
-	void *filter_data = nullptr;
-	gs_vertbuffer_t *verts[8];
+	std::mutex targetMutex;
+	std::atomic<void *> filter_data{nullptr};
+	corner_pin_overlay overlay = {};
 	int selected = 0;
 	vec2 mouse;
 	vec2 movedMouse;
@@ -48,6 +97,9 @@ class CornerPinWidget : public QWidget {
 
 	int textSize = 50;
 
+	std::mutex viewMutex;
+	CornerPinView view;
+
 	int offX;
 	int offY;
 	int previewW;
@@ -55,6 +107,8 @@ class CornerPinWidget : public QWidget {
 	float previewScale;
 
 	void CreateDisplay();
+	void ResizeDisplay();
+	void ReleaseDisplay();
 	void paintEvent(QPaintEvent *event) override;
 	void resizeEvent(QResizeEvent *event) override;
 	void showEvent(QShowEvent *event) override;
@@ -66,16 +120,22 @@ class CornerPinWidget : public QWidget {
 	void wheelEvent(QWheelEvent *event) override;
 
 public:
-	obs_source_t *source;
-	obs_sceneitem_t *sceneitem = nullptr;
+	obs_source_t *source = nullptr;
 	bool zoom = false;
 
-	CornerPinWidget(QWidget *parent, obs_source_t *source_, void *data);
+	CornerPinWidget(QWidget *parent);
 	~CornerPinWidget();
+	void Retarget(obs_source_t *source_, void *data);
+	bool Detach(void *data);
 	void handleResizeRequest(int width, int height);
 	static void drawPreview(void *data, uint32_t cx, uint32_t cy);
 
+	CornerPinView GetView();
+	void SetView(const CornerPinView &newView);
+	void UpdateView(const std::function<void(CornerPinView &)> &func);
+
 	virtual QPaintEngine *paintEngine() const override;
 
 	inline obs_display_t *GetDisplay() const { return display; }
+	inline void *GetFilterData() const { return filter_data.load(); }
 };
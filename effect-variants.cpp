@@ -0,0 +1,128 @@
+#include <obs-module.h>
+#include <util/dstr.h>
+#include <mutex>
+#include "effect-variants.hpp"
+
+static inline uint32_t feature_values(const struct effect_feature *feature)
+{
+	return feature->values ? feature->num_values : 2;
+}
+
+/* Guards the reference counts; compiling and reading variants only ever
+ * happens on the graphics thread while a reference is held. */
+static std::mutex refs_mutex;
+
+void effect_variants_acquire(struct effect_variants *ev)
+{
+	std::lock_guard<std::mutex> lock(refs_mutex);
+
+	if (ev->refs++)
+		return;
+
+	ev->num_variants = 1;
+	for (size_t i = 0; i < ev->num_features; i++)
+		ev->num_variants *= feature_values(&ev->features[i]);
+
+	ev->variants = (struct effect_variant *)bzalloc(
+		sizeof(struct effect_variant) * ev->num_variants);
+}
+
+void effect_variants_release(struct effect_variants *ev)
+{
+	std::lock_guard<std::mutex> lock(refs_mutex);
+
+	if (--ev->refs)
+		return;
+
+	obs_enter_graphics();
+	for (uint32_t i = 0; i < ev->num_variants; i++) {
+		gs_effect_destroy(ev->variants[i].effect);
+		bfree(ev->variants[i].params);
+	}
+	obs_leave_graphics();
+
+	bfree(ev->variants);
+	ev->variants = NULL;
+	ev->num_variants = 0;
+}
+
+uint32_t effect_variants_key(const struct effect_variants *ev,
+			     const uint32_t *values)
+{
+	uint32_t key = 0;
+
+	for (size_t i = ev->num_features; i > 0; i--) {
+		const struct effect_feature *feature = &ev->features[i - 1];
+		uint32_t count = feature_values(feature);
+		uint32_t value = values[i - 1];
+
+		key = key * count + (value < count ? value : 0);
+	}
+
+	return key;
+}
+
+static void build_defines(const struct effect_variants *ev, uint32_t key,
+			  struct dstr *defines)
+{
+	for (size_t i = 0; i < ev->num_features; i++) {
+		const struct effect_feature *feature = &ev->features[i];
+		uint32_t count = feature_values(feature);
+		uint32_t value = key % count;
+
+		key /= count;
+
+		if (!feature->values) {
+			if (value)
+				dstr_catf(defines, "#define %s\n",
+					  feature->name);
+		} else {
+			dstr_catf(defines, "#define %s_%s\n", feature->name,
+				  feature->values[value]);
+		}
+	}
+}
+
+const struct effect_variant *effect_variants_get(struct effect_variants *ev,
+						 uint32_t key)
+{
+	if (!ev->variants || key >= ev->num_variants)
+		return NULL;
+
+	struct effect_variant *variant = &ev->variants[key];
+
+	if (variant->effect)
+		return variant;
+	if (variant->failed)
+		return NULL;
+
+	struct dstr source = {0};
+	char *errors = NULL;
+
+	build_defines(ev, key, &source);
+	dstr_cat(&source, ev->source);
+
+	/* No file name: libobs keeps named effects cached until shutdown,
+	 * while these are owned (and destroyed) by the caller. */
+	variant->effect = gs_effect_create(source.array, NULL, &errors);
+	dstr_free(&source);
+
+	if (!variant->effect) {
+		blog(LOG_WARNING,
+		     "[filter-pack] Failed to compile variant %u of '%s': %s",
+		     key, ev->file, errors ? errors : "(unknown error)");
+		bfree(errors);
+		variant->failed = true;
+		return NULL;
+	}
+
+	bfree(errors);
+
+	variant->params = (gs_eparam_t **)bzalloc(sizeof(gs_eparam_t *) *
+						  (ev->num_params + 1));
+	for (size_t i = 0; i < ev->num_params; i++)
+		variant->params[i] = gs_effect_get_param_by_name(
+			variant->effect, ev->param_names[i]);
+
+	return variant;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <obs-module.h>
+
+/* A feature is one axis of an effect's permutation space.  Boolean features
+ * (values == NULL) add "#define NAME" when enabled; enumerated features add
+ * "#define NAME_VALUE" for the selected value. */
+struct effect_feature {
+	const char *name;
+	const char *const *values;
+	uint32_t num_values;
+};
+
+struct effect_variant {
+	gs_effect_t *effect;
+	gs_eparam_t **params;
+	bool failed;
+};
+
+/* Compiles one .effect, embedded in the module at build time, into a
+ * specialized effect per feature combination.  There is one of these per
+ * effect for the whole module, shared by every filter instance: instances
+ * acquire it on create and release it on destroy, and the compiled effects
+ * are freed with the last reference.  Variants are compiled on first use
+ * from the graphics thread, and the parameters listed here are resolved
+ * once per variant so render callbacks never look them up by name. */
+struct effect_variants {
+	const char *file;
+	const char *source;
+	const struct effect_feature *features;
+	size_t num_features;
+	const char *const *param_names;
+	size_t num_params;
+
+	long refs;
+	uint32_t num_variants;
+	struct effect_variant *variants;
+};
+
+#define EFFECT_VARIANTS(file, source, features, num_features, param_names, \
+			num_params)                                          \
+	{                                                                    \
+		file, source, features, num_features, param_names,           \
+			num_params, 0, 0, NULL                               \
+	}
+
+void effect_variants_acquire(struct effect_variants *ev);
+void effect_variants_release(struct effect_variants *ev);
+
+uint32_t effect_variants_key(const struct effect_variants *ev,
+			     const uint32_t *values);
+const struct effect_variant *effect_variants_get(struct effect_variants *ev,
+						 uint32_t key);
@@ -0,0 +1,336 @@
+#include <obs-module.h>
+#include <graphics/vec2.h>
+#include <graphics/vec4.h>
+#include <util/platform.h>
+#include <string.h>
+#include "effect-variants.hpp"
+#include "filter-cache.hpp"
+#include "render-pool.hpp"
+#include "filter_cache.effect.h"
+
+enum filter_cache_param {
+	PARAM_IMAGE,
+	PARAM_PREVIOUS,
+	PARAM_SIZE,
+	PARAM_OUT_SIZE,
+	NUM_PARAMS,
+};
+
+static const char *const filter_cache_params[NUM_PARAMS] = {
+	"image",
+	"previous",
+	"size",
+	"out_size",
+};
+
+static struct effect_variants variants =
+	EFFECT_VARIANTS("filter_cache.effect", filter_cache_effect, NULL, 0,
+			filter_cache_params, NUM_PARAMS);
+
+void filter_cache_acquire(void)
+{
+	effect_variants_acquire(&variants);
+	render_pool_acquire();
+}
+
+void filter_cache_release(struct filter_stats *stats)
+{
+	effect_variants_release(&variants);
+	render_pool_release(stats);
+}
+
+void filter_cache_add_property(obs_properties_t *props)
+{
+	obs_property_t *p = obs_properties_add_bool(props, "cache_static",
+						    "Cache Static Output");
+	obs_property_set_long_description(
+		p, "Draws the last output while the input and settings stay "
+		   "the same.  A change to a synchronous input is only noticed "
+		   "a frame later, so its first changed frame is drawn stale.");
+}
+
+bool filter_cache_get(obs_data_t *settings)
+{
+	return obs_data_get_bool(settings, "cache_static");
+}
+
+static void destroy(struct filter_cache *cache, struct filter_stats *stats,
+		    struct vram_stats *instance)
+{
+	gs_texrender_destroy(cache->output);
+	gs_texrender_destroy(cache->inputs[0]);
+	gs_texrender_destroy(cache->inputs[1]);
+	gs_stagesurface_destroy(cache->stage);
+
+	vram_stats_add(vram_stats_type(stats->vram_type), instance,
+		       -cache->bytes - cache->input_bytes, false);
+
+	/* Still counted by filter_video on another thread */
+	long async_frames = os_atomic_load_long(&cache->async_frames);
+
+	bfree(cache->key);
+	memset(cache, 0, sizeof(*cache));
+	os_atomic_set_long(&cache->async_frames, async_frames);
+}
+
+void filter_cache_free(struct filter_cache *cache, struct filter_stats *stats)
+{
+	/* The instance's own counters go away with it */
+	destroy(cache, stats, NULL);
+}
+
+static void reduce(gs_effect_t *effect, gs_eparam_t **params,
+		   const char *technique, gs_texture_t *tex,
+		   gs_texture_t *previous, uint32_t cx, uint32_t cy,
+		   gs_texrender_t *out, uint32_t out_cx, uint32_t out_cy)
+{
+	gs_texrender_reset(out);
+	if (!gs_texrender_begin(out, out_cx, out_cy))
+		return;
+
+	struct vec2 size, out_size;
+	vec2_set(&size, (float)cx, (float)cy);
+	vec2_set(&out_size, (float)out_cx, (float)out_cy);
+
+	gs_ortho(0.0f, (float)out_cx, 0.0f, (float)out_cy, -100.0f, 100.0f);
+	gs_effect_set_texture(params[PARAM_IMAGE], tex);
+	gs_effect_set_texture(params[PARAM_PREVIOUS], previous);
+	gs_effect_set_vec2(params[PARAM_SIZE], &size);
+	gs_effect_set_vec2(params[PARAM_OUT_SIZE], &out_size);
+
+	while (gs_effect_loop(effect, technique))
+		gs_draw_sprite(tex, 0, out_cx, out_cy);
+
+	gs_texrender_end(out);
+}
+
+/* Two input targets, one for this frame and one for the last */
+static bool prepare_inputs(struct filter_cache *cache,
+			   struct filter_stats *stats, uint32_t cx,
+			   uint32_t cy)
+{
+	for (int i = 0; i < 2; i++) {
+		if (!cache->inputs[i])
+			cache->inputs[i] =
+				gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+		if (!cache->inputs[i])
+			return false;
+	}
+
+	if (cache->input_cx != cx || cache->input_cy != cy) {
+		int64_t bytes = 2 * vram_texture_bytes(GS_RGBA, cx, cy);
+
+		vram_stats_add(vram_stats_type(stats->vram_type), &stats->vram,
+			       bytes - cache->input_bytes, true);
+		filter_stats_alloc(stats);
+		cache->input_bytes = bytes;
+		cache->input_cx = cx;
+		cache->input_cy = cy;
+		cache->have_previous = false;
+	}
+
+	return true;
+}
+
+/* Reads back the comparison staged last frame and stages this frame's */
+static bool input_compare(struct filter_cache *cache,
+			  struct filter_stats *stats, obs_source_t *context,
+			  obs_source_t *target, uint32_t cx, uint32_t cy)
+{
+	bool changed = true;
+
+	if (cache->staged) {
+		uint8_t *data;
+		uint32_t linesize;
+
+		if (gs_stagesurface_map(cache->stage, &data, &linesize)) {
+			changed = data[0] != 0;
+			gs_stagesurface_unmap(cache->stage);
+		}
+		cache->staged = false;
+	}
+
+	const struct effect_variant *variant =
+		effect_variants_get(&variants, 0);
+	if (!variant || !prepare_inputs(cache, stats, cx, cy))
+		return true;
+
+	gs_texrender_t *input = cache->inputs[cache->current];
+	gs_texrender_t *previous = cache->inputs[!cache->current];
+	bool have_previous = cache->have_previous;
+
+	cache->have_previous = false;
+	if (!filter_render_input(input, context, target, cx, cy))
+		return true;
+
+	cache->current = !cache->current;
+	cache->have_previous = true;
+	if (!have_previous)
+		return true;
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	/* Mark every 2x2 block that differs from the last input, then halve
+	 * the marks down to a single texel */
+	gs_texrender_t *level = NULL;
+	gs_texture_t *tex = gs_texrender_get_texture(input);
+	const char *technique = "Changed";
+
+	do {
+		uint32_t out_cx = (cx + 1) / 2;
+		uint32_t out_cy = (cy + 1) / 2;
+		gs_texrender_t *out =
+			render_pool_lease(GS_R8, out_cx, out_cy, stats);
+
+		if (out)
+			reduce(variant->effect, variant->params, technique,
+			       tex, gs_texrender_get_texture(previous), cx, cy,
+			       out, out_cx, out_cy);
+
+		render_pool_return(level);
+		level = out;
+		tex = gs_texrender_get_texture(level);
+		technique = "Reduce";
+		cx = out_cx;
+		cy = out_cy;
+	} while (level && (cx > 1 || cy > 1));
+
+	gs_blend_state_pop();
+
+	if (!cache->stage)
+		cache->stage = gs_stagesurface_create(1, 1, GS_R8);
+	if (cache->stage && level) {
+		gs_stage_texture(cache->stage, tex);
+		cache->staged = true;
+	}
+
+	render_pool_return(level);
+	return changed;
+}
+
+struct obs_source_frame *filter_cache_video(struct filter_cache *cache,
+					    struct obs_source_frame *frame)
+{
+	os_atomic_inc_long(&cache->async_frames);
+	return frame;
+}
+
+/* Frames are queued and shown when they are due, so a frame that arrived
+ * may still be on its way to the screen; wait for the source to settle */
+static bool async_changed(struct filter_cache *cache)
+{
+	long frames = os_atomic_load_long(&cache->async_frames);
+	uint64_t now = os_gettime_ns();
+
+	if (frames != cache->seen_frames) {
+		cache->seen_frames = frames;
+		cache->settle_ts = now + CACHE_ASYNC_SETTLE_NS;
+	}
+
+	return now < cache->settle_ts;
+}
+
+static bool input_changed(struct filter_cache *cache,
+			  struct filter_stats *stats, obs_source_t *context,
+			  uint32_t cx, uint32_t cy)
+{
+	obs_source_t *target = obs_filter_get_target(context);
+	obs_source_t *parent = obs_filter_get_parent(context);
+
+	if (!target || !parent)
+		return true;
+
+	uint32_t flags = obs_source_get_output_flags(target);
+
+	if (target == parent && (flags & OBS_SOURCE_ASYNC) != 0)
+		return async_changed(cache);
+
+	return input_compare(cache, stats, context, target, cx, cy);
+}
+
+bool filter_cache_draw(struct filter_cache *cache, struct filter_stats *stats,
+		       obs_source_t *context, const void *key, size_t key_size,
+		       uint32_t cx, uint32_t cy, bool enabled)
+{
+	if (!enabled) {
+		if (cache->output || cache->inputs[0] || cache->stage)
+			destroy(cache, stats, &stats->vram);
+		return false;
+	}
+
+	if (cache->key_size != key_size ||
+	    memcmp(cache->key, key, key_size) != 0) {
+		cache->key = brealloc(cache->key, key_size);
+		cache->key_size = key_size;
+		memcpy(cache->key, key, key_size);
+		cache->valid = false;
+	}
+
+	if (cache->cx != cx || cache->cy != cy)
+		cache->valid = false;
+
+	/* Always sampled, so that a change is noticed even while the cache
+	 * is being refilled */
+	if (input_changed(cache, stats, context, cx, cy))
+		cache->valid = false;
+
+	if (!cache->valid)
+		return false;
+
+	filter_draw_texture(obs_get_base_effect(OBS_EFFECT_DEFAULT),
+			    gs_effect_get_param_by_name(
+				    obs_get_base_effect(OBS_EFFECT_DEFAULT),
+				    "image"),
+			    gs_texrender_get_texture(cache->output), cx, cy);
+	filter_stats_frame(stats, 0);
+	return true;
+}
+
+bool filter_cache_capture_begin(struct filter_cache *cache,
+				struct filter_stats *stats, uint32_t cx,
+				uint32_t cy)
+{
+	if (!cache->output)
+		cache->output = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	if (!cache->output)
+		return false;
+
+	if (cache->cx != cx || cache->cy != cy) {
+		int64_t bytes = vram_texture_bytes(GS_RGBA, cx, cy);
+
+		vram_stats_add(vram_stats_type(stats->vram_type), &stats->vram,
+			       bytes - cache->bytes, true);
+		filter_stats_alloc(stats);
+		cache->bytes = bytes;
+		cache->cx = cx;
+		cache->cy = cy;
+	}
+
+	gs_texrender_reset(cache->output);
+	if (!gs_texrender_begin(cache->output, cx, cy))
+		return false;
+
+	struct vec4 clear_color;
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	return true;
+}
+
+void filter_cache_capture_end(struct filter_cache *cache)
+{
+	gs_blend_state_pop();
+	gs_texrender_end(cache->output);
+	cache->valid = true;
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	filter_draw_texture(effect,
+			    gs_effect_get_param_by_name(effect, "image"),
+			    gs_texrender_get_texture(cache->output), cache->cx,
+			    cache->cy);
+}
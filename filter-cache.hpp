@@ -0,0 +1,74 @@
+#pragma once
+
+#include <obs-module.h>
+#include "filter-pack.hpp"
+
+/* Opt-in cache of a filter's last output, for inputs that sit still for
+ * long stretches (logos, backgrounds, paused media).  The cached texture
+ * is drawn instead of the filter's passes for as long as the filter's key
+ * (its parameter snapshot and anything else its output depends on), the
+ * output size and the input are all unchanged.
+ *
+ * An async source directly below the filter is watched through the frames
+ * it pushes into the filter chain (see filter_cache_video); its input
+ * counts as changed until none has arrived for CACHE_ASYNC_SETTLE_NS.
+ * Anything else is rendered every frame and compared texel by texel with
+ * the previous frame's input.  The comparison is exact, but it is read
+ * back a frame later so the graphics thread never waits on it; the first
+ * frame after such an input changes is therefore still served from the
+ * cache.
+ *
+ * Watching a synchronous input re-renders and compares it every frame,
+ * which costs more than a single pass, so only multi-pass filters offer
+ * the cache. */
+#define CACHE_ASYNC_SETTLE_NS 100000000ULL
+
+struct filter_cache {
+	gs_texrender_t *output;
+	uint32_t cx, cy;
+	int64_t bytes;
+	bool valid;
+
+	void *key;
+	size_t key_size;
+
+	volatile long async_frames;
+	long seen_frames;
+	uint64_t settle_ts;
+
+	gs_texrender_t *inputs[2];
+	uint32_t input_cx, input_cy;
+	int64_t input_bytes;
+	int current;
+	bool have_previous;
+	gs_stagesurf_t *stage;
+	bool staged;
+};
+
+/* Also hold a reference on the render pool, which the signature uses */
+void filter_cache_acquire(void);
+void filter_cache_release(struct filter_stats *stats);
+
+void filter_cache_add_property(obs_properties_t *props);
+bool filter_cache_get(obs_data_t *settings);
+
+/* Must be called from within the graphics context */
+void filter_cache_free(struct filter_cache *cache, struct filter_stats *stats);
+
+/* For the filter's filter_video callback: counts frames from an async
+ * source.  Safe to call from any thread. */
+struct obs_source_frame *filter_cache_video(struct filter_cache *cache,
+					    struct obs_source_frame *frame);
+
+/* Draws the cached output and returns true if it is still current.  With
+ * `enabled` off the cache is emptied and this always returns false. */
+bool filter_cache_draw(struct filter_cache *cache, struct filter_stats *stats,
+		       obs_source_t *context, const void *key, size_t key_size,
+		       uint32_t cx, uint32_t cy, bool enabled);
+
+/* Redirects everything the filter draws until filter_cache_capture_end
+ * into the cache, which is then drawn in its place. */
+bool filter_cache_capture_begin(struct filter_cache *cache,
+				struct filter_stats *stats, uint32_t cx,
+				uint32_t cy);
+void filter_cache_capture_end(struct filter_cache *cache);
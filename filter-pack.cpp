@@ -1,4 +1,9 @@
 #include <obs-module.h>
+#include <graphics/vec4.h>
+#include <atomic>
+#include "filter-pack.hpp"
+#include "corner-pin-filter.hpp"
+#include "frame-capture.hpp"
 
 OBS_DECLARE_MODULE()
 
@@ -7,11 +12,394 @@ OBS_MODULE_USE_DEFAULT_LOCALE("obs-filters", "en-US")
 extern struct obs_source_info corner_pin_filter;
 extern struct obs_source_info lens_distortion_filter;
 extern struct obs_source_info stroke_filter;
+extern struct obs_source_info uv_map_filter;
+
+const char *const filter_quality_values[NUM_QUALITY] = {
+	"TAP1",
+	"TAP4",
+	"TAP9",
+	"BICUBIC",
+};
+
+obs_property_t *filter_quality_add_property(obs_properties_t *props)
+{
+	obs_property_t *p = obs_properties_add_list(props, "quality",
+						    "Sampling Quality",
+						    OBS_COMBO_TYPE_LIST,
+						    OBS_COMBO_FORMAT_INT);
+
+	obs_property_list_add_int(p, "Single tap", QUALITY_SINGLE);
+	obs_property_list_add_int(p, "4-tap rotated grid", QUALITY_RGSS);
+	obs_property_list_add_int(p, "9-tap", QUALITY_9TAP);
+	obs_property_list_add_int(p, "Bicubic", QUALITY_BICUBIC);
+	return p;
+}
+
+enum filter_quality filter_quality_get(obs_data_t *settings)
+{
+	long long quality = obs_data_get_int(settings, "quality");
+
+	if (quality < 0 || quality >= NUM_QUALITY)
+		return QUALITY_SINGLE;
+	return (enum filter_quality)quality;
+}
+
+static volatile long pressure_level = 0;
+
+void filter_pressure_tick(float seconds)
+{
+	static uint64_t last_frame = 0;
+	static float over = 0.0f;
+	static float under = 0.0f;
+
+	/* Every adaptive filter ticks, but the pressure advances once per
+	 * frame */
+	uint64_t frame = obs_get_video_frame_time();
+	if (frame == last_frame)
+		return;
+	last_frame = frame;
+
+	struct obs_video_info ovi;
+	if (!obs_get_video_info(&ovi) || !ovi.fps_num)
+		return;
+
+	double budget = 1000000000.0 * ovi.fps_den / ovi.fps_num;
+	double load = (double)obs_get_average_frame_time_ns() / budget;
+	long level = os_atomic_load_long(&pressure_level);
+	long next = level;
+
+	over = load > FILTER_PRESSURE_HIGH ? over + seconds : 0.0f;
+	under = load < FILTER_PRESSURE_LOW ? under + seconds : 0.0f;
+
+	if (over >= FILTER_PRESSURE_RAISE_SECONDS &&
+	    level < FILTER_PRESSURE_MAX_LEVEL) {
+		next = level + 1;
+		over = 0.0f;
+	} else if (under >= FILTER_PRESSURE_LOWER_SECONDS && level > 0) {
+		next = level - 1;
+		under = 0.0f;
+	}
+
+	if (next == level)
+		return;
+
+	os_atomic_set_long(&pressure_level, next);
+	blog(LOG_INFO,
+	     "[filter-pack] frame time at %.0f%% of budget, %s adaptive "
+	     "quality (pressure level %ld of %d)",
+	     load * 100.0, next > level ? "lowering" : "raising", next,
+	     FILTER_PRESSURE_MAX_LEVEL);
+}
+
+long filter_pressure_level(void)
+{
+	return os_atomic_load_long(&pressure_level);
+}
+
+void filter_adaptive_add_property(obs_properties_t *props)
+{
+	obs_properties_add_bool(props, "adaptive_quality", "Adaptive Quality");
+}
+
+bool filter_adaptive_get(obs_data_t *settings)
+{
+	return obs_data_get_bool(settings, "adaptive_quality");
+}
+
+void filter_bypass_set(struct filter_bypass *bypass, obs_source_t *context,
+		       bool identity)
+{
+	if (bypass->active == identity)
+		return;
+
+	bypass->active = identity;
+
+	if (identity) {
+		bypass->frames = 0;
+		blog(LOG_INFO,
+		     "[filter-pack] '%s': identity settings, bypassing filter",
+		     obs_source_get_name(context));
+	} else {
+		blog(LOG_INFO,
+		     "[filter-pack] '%s': leaving bypass after %llu frames",
+		     obs_source_get_name(context),
+		     (unsigned long long)bypass->frames);
+	}
+}
+
+void filter_params_lock_init(struct filter_params_lock *lock)
+{
+	pthread_mutex_init(&lock->write_mutex, NULL);
+	lock->seq = 0;
+}
+
+void filter_params_lock_free(struct filter_params_lock *lock)
+{
+	pthread_mutex_destroy(&lock->write_mutex);
+}
+
+void filter_params_write_begin(struct filter_params_lock *lock)
+{
+	pthread_mutex_lock(&lock->write_mutex);
+	os_atomic_inc_long(&lock->seq);
+
+	/* Pairs with the reader's acquire fence: a reader that sees any of
+	 * the stores that follow also sees the odd sequence */
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void filter_params_write_end(struct filter_params_lock *lock)
+{
+	os_atomic_inc_long(&lock->seq);
+	pthread_mutex_unlock(&lock->write_mutex);
+}
+
+void filter_params_read(struct filter_params_lock *lock, void *dst,
+			const void *params, size_t size)
+{
+	long seq;
+
+	do {
+		/* An odd sequence means a write is in progress */
+		while ((seq = os_atomic_load_long(&lock->seq)) & 1)
+			;
+
+		memcpy(dst, params, size);
+
+		/* Keeps the copy from being read after the second load, where
+		 * a torn snapshot would pass the check on weakly ordered
+		 * CPUs */
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while (os_atomic_load_long(&lock->seq) != seq);
+}
+
+void filter_budget_frame(struct filter_budget *budget, long allocations,
+			 long passes)
+{
+	const char *name = obs_source_get_name(budget->context);
+
+	budget->alloc_streak = allocations != budget->last_allocations
+				       ? budget->alloc_streak + 1
+				       : 0;
+	budget->last_allocations = allocations;
+
+	if (budget->alloc_streak >= FILTER_BUDGET_ALLOC_FRAMES &&
+	    !budget->reported_allocations) {
+		blog(LOG_WARNING,
+		     "[filter-pack] '%s': over budget: allocated on %ld "
+		     "frames in a row",
+		     name, budget->alloc_streak);
+		budget->reported_allocations = true;
+	}
+
+	if (budget->max_passes && passes > budget->max_passes &&
+	    !budget->reported_passes) {
+		blog(LOG_WARNING,
+		     "[filter-pack] '%s': over budget: %ld passes in a frame, "
+		     "budget %ld",
+		     name, passes, budget->max_passes);
+		budget->reported_passes = true;
+	}
+}
+
+void filter_budget_report(const char *what, long count, long budget)
+{
+	blog(LOG_WARNING, "[filter-pack] over budget: %ld %s, budget %ld",
+	     count, what, budget);
+}
+
+static void filter_stats_proc(void *data, calldata_t *cd)
+{
+	struct filter_stats *stats = (struct filter_stats *)data;
+
+	calldata_set_int(cd, "frames", os_atomic_load_long(&stats->frames));
+	calldata_set_int(cd, "passes", os_atomic_load_long(&stats->passes));
+	calldata_set_int(cd, "bypasses", os_atomic_load_long(&stats->bypasses));
+	calldata_set_int(cd, "allocations",
+			 os_atomic_load_long(&stats->allocations));
+}
+
+static void filter_vram_proc(void *data, calldata_t *cd)
+{
+	struct filter_stats *stats = (struct filter_stats *)data;
+	struct vram_stats instance, type;
+
+	vram_stats_read(&stats->vram, &instance);
+	vram_stats_read(vram_stats_type(stats->vram_type), &type);
+
+	calldata_set_int(cd, "bytes", instance.bytes);
+	calldata_set_int(cd, "peak_bytes", instance.peak);
+	calldata_set_float(cd, "allocations_per_second", instance.rate);
+	calldata_set_int(cd, "type_bytes", type.bytes);
+	calldata_set_int(cd, "type_peak_bytes", type.peak);
+	calldata_set_float(cd, "type_allocations_per_second", type.rate);
+}
+
+void filter_stats_init(struct filter_stats *stats, obs_source_t *context,
+		       enum vram_type vram_type)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(context);
+
+	stats->vram_type = vram_type;
+	stats->budget.context = context;
+
+	proc_handler_add(ph,
+			 "void get_stats(out int frames, out int passes, "
+			 "out int bypasses, out int allocations)",
+			 filter_stats_proc, stats);
+	proc_handler_add(ph,
+			 "void get_vram(out int bytes, out int peak_bytes, "
+			 "out float allocations_per_second, "
+			 "out int type_bytes, out int type_peak_bytes, "
+			 "out float type_allocations_per_second)",
+			 filter_vram_proc, stats);
+}
+
+void filter_stats_update(struct filter_stats *stats, obs_data_t *settings)
+{
+	os_atomic_set_bool(&stats->log,
+			   obs_data_get_bool(settings, "log_stats"));
+}
+
+void filter_stats_add_property(obs_properties_t *props)
+{
+	obs_properties_add_bool(props, "log_stats", "Log Statistics");
+}
+
+void filter_stats_tick(struct filter_stats *stats, obs_source_t *context,
+		       const struct gpu_timer *timer, float seconds)
+{
+	if (!os_atomic_load_bool(&stats->log)) {
+		stats->elapsed = 0.0f;
+		return;
+	}
+
+	stats->elapsed += seconds;
+	if (stats->elapsed < FILTER_STATS_LOG_INTERVAL)
+		return;
+
+	long now[4] = {
+		os_atomic_load_long(&stats->frames),
+		os_atomic_load_long(&stats->passes),
+		os_atomic_load_long(&stats->bypasses),
+		os_atomic_load_long(&stats->allocations),
+	};
+	long frames = now[0] - stats->logged[0];
+	long passes = now[1] - stats->logged[1];
+
+	blog(LOG_INFO,
+	     "[filter-pack] '%s': %ld frames, %ld bypassed, %.2f passes per "
+	     "frame, %ld allocations, %.3f ms GPU in the last %.0f s",
+	     obs_source_get_name(context), frames, now[2] - stats->logged[2],
+	     frames ? (double)passes / (double)frames : 0.0,
+	     now[3] - stats->logged[3],
+	     timer ? os_atomic_load_long(&timer->frame_ns) / 1000000.0 : 0.0,
+	     stats->elapsed);
+
+	struct vram_stats instance, type;
+
+	vram_stats_read(&stats->vram, &instance);
+	vram_stats_read(vram_stats_type(stats->vram_type), &type);
+
+	blog(LOG_INFO,
+	     "[filter-pack] '%s': VRAM %.2f MB (peak %.2f MB, %.1f "
+	     "allocations/s), all %s filters %.2f MB (peak %.2f MB, %.1f "
+	     "allocations/s)",
+	     obs_source_get_name(context), instance.bytes / 1048576.0,
+	     instance.peak / 1048576.0, instance.rate,
+	     vram_stats_type_name(stats->vram_type), type.bytes / 1048576.0,
+	     type.peak / 1048576.0, type.rate);
+
+	memcpy(stats->logged, now, sizeof(now));
+	stats->elapsed = 0.0f;
+}
+
+bool filter_render_input(gs_texrender_t *render, obs_source_t *context,
+			 obs_source_t *input, uint32_t cx, uint32_t cy)
+{
+	obs_source_t *parent = obs_filter_get_parent(context);
+	bool success = false;
+
+	if (!input || !parent || !cx || !cy)
+		return false;
+
+	gs_texrender_reset(render);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	if (gs_texrender_begin(render, cx, cy)) {
+		uint32_t parent_flags = obs_source_get_output_flags(input);
+
+		bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
+		bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		if (input == parent && !custom_draw && !async)
+			obs_source_default_render(input);
+		else
+			obs_source_video_render(input);
+
+		gs_texrender_end(render);
+		success = true;
+	}
+
+	gs_blend_state_pop();
+	return success;
+}
+
+void filter_draw_texture(gs_effect_t *effect, gs_eparam_t *image,
+			 gs_texture_t *tex, uint32_t cx, uint32_t cy)
+{
+#ifdef sRGB_SUPPORT
+	const bool linear_srgb = gs_get_linear_srgb();
+
+	const bool previous = gs_framebuffer_srgb_enabled();
+	gs_enable_framebuffer_srgb(linear_srgb);
+
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
+#endif
+		gs_effect_set_texture(image, tex);
+
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, cx, cy);
+
+#ifdef sRGB_SUPPORT
+	gs_enable_framebuffer_srgb(previous);
+#endif
+}
+
+static void capture_reap_tick(void *param, float seconds)
+{
+	frame_capture_reap(false);
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(seconds);
+}
 
 bool obs_module_load(void)
 {
 	obs_register_source(&corner_pin_filter);
 	obs_register_source(&lens_distortion_filter);
 	obs_register_source(&stroke_filter);
+	obs_register_source(&uv_map_filter);
+	obs_add_tick_callback(capture_reap_tick, NULL);
 	return true;
 }
+
+void obs_module_unload(void)
+{
+	/* Captures still being written are completed before the module's
+	 * code goes away */
+	obs_remove_tick_callback(capture_reap_tick, NULL);
+	frame_capture_reap(true);
+
+	corner_pin_editor_free();
+	vram_stats_log_types();
+}
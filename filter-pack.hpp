@@ -0,0 +1,191 @@
+#pragma once
+
+#include <obs-module.h>
+#include <util/threading.h>
+#include <util/profiler.h>
+#include "gpu-timer.hpp"
+#include "vram-stats.hpp"
+
+/* Sampling tiers shared by the resampling filters.  Each one is compiled
+ * as its own effect variant through the "QUALITY" feature. */
+enum filter_quality {
+	QUALITY_SINGLE,
+	QUALITY_RGSS,
+	QUALITY_9TAP,
+	QUALITY_BICUBIC,
+	NUM_QUALITY,
+};
+
+extern const char *const filter_quality_values[NUM_QUALITY];
+
+obs_property_t *filter_quality_add_property(obs_properties_t *props);
+enum filter_quality filter_quality_get(obs_data_t *settings);
+
+/* Module-wide render pressure for filters with "Adaptive Quality" on.
+ * Their ticks compare libobs' average frame time against the frame
+ * interval; sustained time over FILTER_PRESSURE_HIGH of the budget raises
+ * the level by one, and sustained time under FILTER_PRESSURE_LOW lowers
+ * it again.  Each level drops resampling filters one quality tier and
+ * doubles the stroke's dilation step. */
+#define FILTER_PRESSURE_MAX_LEVEL 3
+#define FILTER_PRESSURE_HIGH 0.9
+#define FILTER_PRESSURE_LOW 0.6
+#define FILTER_PRESSURE_RAISE_SECONDS 1.0f
+#define FILTER_PRESSURE_LOWER_SECONDS 5.0f
+
+void filter_pressure_tick(float seconds);
+long filter_pressure_level(void);
+
+void filter_adaptive_add_property(obs_properties_t *props);
+bool filter_adaptive_get(obs_data_t *settings);
+
+static inline enum filter_quality filter_quality_adapt(enum filter_quality q,
+						       bool adaptive)
+{
+	long level = adaptive ? filter_pressure_level() : 0;
+
+	return (long)q > level ? (enum filter_quality)(q - level)
+			       : QUALITY_SINGLE;
+}
+
+/* Tracks whether a filter instance is currently passing its input straight
+ * through because its settings are an exact identity. */
+struct filter_bypass {
+	bool active;
+	uint64_t frames;
+};
+
+void filter_bypass_set(struct filter_bypass *bypass, obs_source_t *context,
+		       bool identity);
+
+/* Sequence lock guarding a filter's parameter snapshot.  Writers (update,
+ * the corner pin editor, tick when the target resizes) are serialized by
+ * a mutex and change the snapshot between write_begin and write_end,
+ * including any values derived from it.  Readers on the graphics thread
+ * never block: filter_params_read copies the snapshot and retries if a
+ * write overlapped the copy, so they never see a half-written one. */
+struct filter_params_lock {
+	pthread_mutex_t write_mutex;
+	volatile long seq;
+};
+
+void filter_params_lock_init(struct filter_params_lock *lock);
+void filter_params_lock_free(struct filter_params_lock *lock);
+void filter_params_write_begin(struct filter_params_lock *lock);
+void filter_params_write_end(struct filter_params_lock *lock);
+void filter_params_read(struct filter_params_lock *lock, void *dst,
+			const void *params, size_t size);
+
+/* Per-frame cost invariants, checked in builds configured with
+ * FILTER_PACK_BUDGETS and logged once per instance when broken:
+ *
+ * - a render never allocates on FILTER_BUDGET_ALLOC_FRAMES frames in a
+ *   row, which is how per-frame allocation shows once the render pool
+ *   is warm, while one-off allocations (resizes, map loads) stay quiet;
+ * - a frame never takes more passes than the filter's declared budget.
+ *
+ * State is only touched from the graphics thread. */
+#define FILTER_BUDGET_ALLOC_FRAMES 3
+
+struct filter_budget {
+	obs_source_t *context;
+	long max_passes;
+
+	long last_allocations;
+	long alloc_streak;
+	bool reported_allocations;
+	bool reported_passes;
+};
+
+void filter_budget_frame(struct filter_budget *budget, long allocations,
+			 long passes);
+
+/* Logs a broken budget that is not tied to a filter instance */
+void filter_budget_report(const char *what, long count, long budget);
+
+/* Per-instance counters.  Written from the graphics thread only and read
+ * through the filter's "get_stats" and "get_vram" procs, or summarized in
+ * the log every FILTER_STATS_LOG_INTERVAL seconds when "log_stats" is
+ * enabled. */
+struct filter_stats {
+	volatile long frames;
+	volatile long passes;
+	volatile long bypasses;
+	volatile long allocations;
+
+	enum vram_type vram_type;
+	struct vram_stats vram;
+	struct filter_budget budget;
+
+	volatile bool log;
+	float elapsed;
+	long logged[4];
+};
+
+#define FILTER_STATS_LOG_INTERVAL 10.0f
+
+void filter_stats_init(struct filter_stats *stats, obs_source_t *context,
+		       enum vram_type vram_type);
+void filter_stats_update(struct filter_stats *stats, obs_data_t *settings);
+void filter_stats_add_property(obs_properties_t *props);
+void filter_stats_tick(struct filter_stats *stats, obs_source_t *context,
+		       const struct gpu_timer *timer, float seconds);
+
+static inline void filter_stats_alloc(struct filter_stats *stats)
+{
+	os_atomic_inc_long(&stats->allocations);
+}
+
+/* Most passes one rendered frame may take; 0 leaves it unchecked */
+static inline void filter_stats_budget(struct filter_stats *stats,
+				       long max_passes)
+{
+	stats->budget.max_passes = max_passes;
+}
+
+static inline void filter_stats_frame(struct filter_stats *stats, long passes)
+{
+	os_atomic_inc_long(&stats->frames);
+	os_atomic_set_long(&stats->passes,
+			   os_atomic_load_long(&stats->passes) + passes);
+
+#ifdef FILTER_PACK_BUDGETS
+	filter_budget_frame(&stats->budget,
+			    os_atomic_load_long(&stats->allocations), passes);
+#endif
+}
+
+/* Renders a filter's input (the next filter down the chain, or the source
+ * itself) into `render` the same way obs_source_process_filter_begin does. */
+bool filter_render_input(gs_texrender_t *render, obs_source_t *context,
+			 obs_source_t *input, uint32_t cx, uint32_t cy);
+
+/* Draws `tex` through the "Draw" technique of `effect`, honoring linear
+ * sRGB rendering when it is available. */
+void filter_draw_texture(gs_effect_t *effect, gs_eparam_t *image,
+			 gs_texture_t *tex, uint32_t cx, uint32_t cy);
+
+static inline bool filter_bypass_render(struct filter_bypass *bypass,
+					struct filter_stats *stats,
+					obs_source_t *context)
+{
+	if (!bypass->active)
+		return false;
+
+	bypass->frames++;
+	os_atomic_inc_long(&stats->bypasses);
+	obs_source_skip_video_filter(context);
+	return true;
+}
+
+/* Scope in the libobs profiler.  The profiler tells entries apart by
+ * pointer, so `name` must be a string literal. */
+struct filter_profile_scope {
+	const char *name;
+
+	inline filter_profile_scope(const char *name_) : name(name_)
+	{
+		profile_start(name);
+	}
+	inline ~filter_profile_scope() { profile_end(name); }
+};
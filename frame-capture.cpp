@@ -0,0 +1,468 @@
+#include <obs-module.h>
+#include <graphics/vec4.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <stdio.h>
+#include <string.h>
+#include "frame-capture.hpp"
+#include "render-pool.hpp"
+
+/* Writes mapped frames to disk in the order they were queued.  Created
+ * per capture; the graphics thread queues, then finishes it and moves on.
+ * The thread closes the file and exits on its own, and is joined from a
+ * tick once it has, so the graphics thread never waits on the disk. */
+struct frame_capture_writer {
+	pthread_t thread;
+	bool thread_created;
+	volatile bool done;
+	os_sem_t *sem;
+	pthread_mutex_t mutex;
+	DARRAY(uint8_t *) queue;
+	bool finish;
+
+	char *path;
+	char *metadata;
+	char *name;
+	uint32_t cx, cy;
+	size_t frame_size;
+	size_t record_size;
+};
+
+static const uint8_t zeros[FRAME_CAPTURE_ALIGNMENT] = {0};
+
+/* Finished writers whose thread may still be draining its queue */
+static pthread_mutex_t finished_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct frame_capture_writer *) finished;
+
+static bool write_header(FILE *file, struct frame_capture_writer *writer,
+			 uint32_t frames)
+{
+	uint32_t metadata_size = (uint32_t)strlen(writer->metadata);
+	uint32_t offset = FRAME_CAPTURE_HEADER_SIZE + metadata_size;
+	offset = (offset + FRAME_CAPTURE_ALIGNMENT - 1) &
+		 ~(uint32_t)(FRAME_CAPTURE_ALIGNMENT - 1);
+
+	uint32_t header[8] = {0};
+	memcpy(header, FRAME_CAPTURE_MAGIC, 4);
+	header[1] = FRAME_CAPTURE_VERSION;
+	header[2] = writer->cx;
+	header[3] = writer->cy;
+	header[4] = frames;
+	header[5] = metadata_size;
+	header[6] = offset;
+
+	if (fseek(file, 0, SEEK_SET) != 0 ||
+	    fwrite(header, sizeof(header), 1, file) != 1 ||
+	    fwrite(writer->metadata, 1, metadata_size, file) != metadata_size)
+		return false;
+
+	size_t padding = offset - FRAME_CAPTURE_HEADER_SIZE - metadata_size;
+	return fwrite(zeros, 1, padding, file) == padding;
+}
+
+static void *writer_thread(void *data)
+{
+	struct frame_capture_writer *writer =
+		(struct frame_capture_writer *)data;
+
+	os_set_thread_name("filter-pack: frame capture writer");
+
+	FILE *file = os_fopen(writer->path, "wb");
+	bool ok = file && write_header(file, writer, 0);
+	uint32_t frames = 0;
+
+	if (!ok)
+		blog(LOG_WARNING, "[filter-pack] '%s': could not write '%s'",
+		     writer->name, writer->path);
+
+	for (;;) {
+		os_sem_wait(writer->sem);
+
+		pthread_mutex_lock(&writer->mutex);
+		uint8_t *frame = NULL;
+		bool finish = writer->finish;
+		if (writer->queue.num) {
+			frame = writer->queue.array[0];
+			da_erase(writer->queue, 0);
+		}
+		pthread_mutex_unlock(&writer->mutex);
+
+		if (!frame) {
+			if (finish)
+				break;
+			continue;
+		}
+
+		if (ok) {
+			size_t padding = writer->record_size -
+					 writer->frame_size;
+
+			ok = fwrite(frame, 1, writer->frame_size, file) ==
+				     writer->frame_size &&
+			     fwrite(zeros, 1, padding, file) == padding;
+			frames += ok;
+		}
+		bfree(frame);
+	}
+
+	/* The frame count goes in last, so an interrupted capture reads back
+	 * as an empty one rather than a truncated one */
+	if (ok)
+		ok = write_header(file, writer, frames);
+	if (file)
+		fclose(file);
+
+	blog(ok ? LOG_INFO : LOG_WARNING,
+	     "[filter-pack] '%s': captured %u frames to '%s'%s", writer->name,
+	     frames, writer->path, ok ? "" : " (incomplete)");
+
+	os_atomic_set_bool(&writer->done, true);
+	return NULL;
+}
+
+static struct frame_capture_writer *writer_create(obs_source_t *context,
+						  const char *path,
+						  const char *metadata,
+						  uint32_t cx, uint32_t cy)
+{
+	struct frame_capture_writer *writer =
+		(struct frame_capture_writer *)bzalloc(
+			sizeof(struct frame_capture_writer));
+
+	writer->path = bstrdup(path);
+	writer->metadata = bstrdup(metadata);
+	writer->name = bstrdup(obs_source_get_name(context));
+	writer->cx = cx;
+	writer->cy = cy;
+	writer->frame_size = (size_t)cx * cy * 4 * 2;
+	writer->record_size = frame_capture_record_size(cx, cy);
+
+	da_init(writer->queue);
+	pthread_mutex_init(&writer->mutex, NULL);
+	os_sem_init(&writer->sem, 0);
+	writer->thread_created = pthread_create(&writer->thread, NULL,
+						writer_thread, writer) == 0;
+	return writer;
+}
+
+static void writer_queue(struct frame_capture_writer *writer, uint8_t *frame)
+{
+	pthread_mutex_lock(&writer->mutex);
+	da_push_back(writer->queue, &frame);
+	pthread_mutex_unlock(&writer->mutex);
+
+	os_sem_post(writer->sem);
+}
+
+/* Hands the writer everything it still needs to write and leaves it to
+ * finish on its own; it is reaped by frame_capture_reap */
+static void writer_finish(struct frame_capture_writer *writer)
+{
+	pthread_mutex_lock(&writer->mutex);
+	writer->finish = true;
+	pthread_mutex_unlock(&writer->mutex);
+
+	os_sem_post(writer->sem);
+
+	pthread_mutex_lock(&finished_mutex);
+	da_push_back(finished, &writer);
+	pthread_mutex_unlock(&finished_mutex);
+}
+
+static void writer_destroy(struct frame_capture_writer *writer)
+{
+	if (writer->thread_created)
+		pthread_join(writer->thread, NULL);
+
+	for (size_t i = 0; i < writer->queue.num; i++)
+		bfree(writer->queue.array[i]);
+	da_free(writer->queue);
+
+	os_sem_destroy(writer->sem);
+	pthread_mutex_destroy(&writer->mutex);
+	bfree(writer->path);
+	bfree(writer->metadata);
+	bfree(writer->name);
+	bfree(writer);
+}
+
+void frame_capture_reap(bool wait)
+{
+	pthread_mutex_lock(&finished_mutex);
+
+	for (size_t i = finished.num; i > 0; i--) {
+		struct frame_capture_writer *writer = finished.array[i - 1];
+
+		/* A writer that never started a thread has nothing to wait
+		 * for */
+		if (!wait && writer->thread_created &&
+		    !os_atomic_load_bool(&writer->done))
+			continue;
+
+		writer_destroy(writer);
+		da_erase(finished, i - 1);
+	}
+
+	if (wait)
+		da_free(finished);
+
+	pthread_mutex_unlock(&finished_mutex);
+}
+
+static void capture_proc(void *data, calldata_t *cd)
+{
+	struct frame_capture *capture = (struct frame_capture *)data;
+	long frames = (long)calldata_int(cd, "frames");
+	const char *path = calldata_string(cd, "path");
+
+	if (frames <= 0 || !path || !*path) {
+		calldata_set_bool(cd, "started", false);
+		return;
+	}
+
+	obs_data_t *settings = obs_source_get_settings(capture->context);
+	obs_data_t *metadata = obs_data_create();
+
+	obs_data_set_string(metadata, "id",
+			    obs_source_get_id(capture->context));
+	obs_data_set_string(metadata, "name",
+			    obs_source_get_name(capture->context));
+	obs_data_set_obj(metadata, "settings", settings);
+
+	/* A request made while a capture runs starts once that one is done,
+	 * but only one can wait */
+	pthread_mutex_lock(&capture->mutex);
+	bool started = !capture->requested_path;
+	if (started) {
+		capture->requested_path = bstrdup(path);
+		capture->requested_metadata =
+			bstrdup(obs_data_get_json(metadata));
+		capture->requested_frames = frames;
+		os_atomic_set_bool(&capture->requested, true);
+	}
+	pthread_mutex_unlock(&capture->mutex);
+
+	obs_data_release(metadata);
+	obs_data_release(settings);
+	calldata_set_bool(cd, "started", started);
+}
+
+void frame_capture_init(struct frame_capture *capture, obs_source_t *context)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(context);
+
+	capture->context = context;
+	pthread_mutex_init(&capture->mutex, NULL);
+
+	proc_handler_add(ph,
+			 "void capture_frames(in int frames, in string path, "
+			 "out bool started)",
+			 capture_proc, capture);
+}
+
+static void destroy_slots(struct frame_capture *capture,
+			  struct filter_stats *stats)
+{
+	for (size_t i = 0; i < FRAME_CAPTURE_RING; i++) {
+		gs_stagesurface_destroy(capture->slots[i].input);
+		gs_stagesurface_destroy(capture->slots[i].output);
+	}
+	memset(capture->slots, 0, sizeof(capture->slots));
+
+	vram_stats_add(vram_stats_type(stats->vram_type), &stats->vram,
+		       -capture->bytes, false);
+	capture->bytes = 0;
+}
+
+static void copy_rows(uint8_t *dst, const uint8_t *src, uint32_t linesize,
+		      uint32_t cx, uint32_t cy)
+{
+	for (uint32_t y = 0; y < cy; y++)
+		memcpy(dst + (size_t)y * cx * 4, src + (size_t)y * linesize,
+		       (size_t)cx * 4);
+}
+
+/* Reads back the oldest staged frame and queues it for the writer */
+static void map_oldest(struct frame_capture *capture)
+{
+	struct frame_capture_slot *slot =
+		&capture->slots[capture->mapped % FRAME_CAPTURE_RING];
+	size_t plane = (size_t)capture->cx * capture->cy * 4;
+	uint8_t *frame = (uint8_t *)bmalloc(plane * 2);
+	uint8_t *data;
+	uint32_t linesize;
+	bool ok = false;
+
+	capture->mapped++;
+
+	if (gs_stagesurface_map(slot->input, &data, &linesize)) {
+		copy_rows(frame, data, linesize, capture->cx, capture->cy);
+		gs_stagesurface_unmap(slot->input);
+
+		if (gs_stagesurface_map(slot->output, &data, &linesize)) {
+			copy_rows(frame + plane, data, linesize, capture->cx,
+				  capture->cy);
+			gs_stagesurface_unmap(slot->output);
+			ok = true;
+		}
+	}
+
+	if (ok)
+		writer_queue(capture->writer, frame);
+	else
+		bfree(frame);
+}
+
+static void finish(struct frame_capture *capture, struct filter_stats *stats)
+{
+	while (capture->mapped < capture->staged)
+		map_oldest(capture);
+
+	writer_finish(capture->writer);
+	capture->writer = NULL;
+	capture->remaining = 0;
+	destroy_slots(capture, stats);
+}
+
+static bool start(struct frame_capture *capture, struct filter_stats *stats,
+		  uint32_t cx, uint32_t cy)
+{
+	if (!os_atomic_load_bool(&capture->requested))
+		return false;
+
+	pthread_mutex_lock(&capture->mutex);
+	char *path = capture->requested_path;
+	char *metadata = capture->requested_metadata;
+	long frames = capture->requested_frames;
+	capture->requested_path = NULL;
+	capture->requested_metadata = NULL;
+	os_atomic_set_bool(&capture->requested, false);
+	pthread_mutex_unlock(&capture->mutex);
+
+	if (!path)
+		return false;
+
+	bool ok = cx && cy;
+
+	for (size_t i = 0; ok && i < FRAME_CAPTURE_RING; i++) {
+		struct frame_capture_slot *slot = &capture->slots[i];
+
+		slot->input = gs_stagesurface_create(cx, cy, GS_RGBA);
+		slot->output = gs_stagesurface_create(cx, cy, GS_RGBA);
+		ok = slot->input && slot->output;
+	}
+
+	if (ok) {
+		capture->bytes = vram_texture_bytes(GS_RGBA, cx, cy) * 2 *
+				 FRAME_CAPTURE_RING;
+		vram_stats_add(vram_stats_type(stats->vram_type),
+			       &stats->vram, capture->bytes, true);
+		filter_stats_alloc(stats);
+
+		capture->writer = writer_create(capture->context, path,
+						metadata, cx, cy);
+		capture->cx = cx;
+		capture->cy = cy;
+		capture->remaining = frames;
+		capture->staged = 0;
+		capture->mapped = 0;
+	} else {
+		destroy_slots(capture, stats);
+		blog(LOG_WARNING, "[filter-pack] '%s': could not start capture",
+		     obs_source_get_name(capture->context));
+	}
+
+	bfree(path);
+	bfree(metadata);
+	return ok;
+}
+
+bool frame_capture_begin(struct frame_capture *capture,
+			 struct filter_stats *stats, uint32_t cx, uint32_t cy)
+{
+	if (!capture->writer && !start(capture, stats, cx, cy))
+		return false;
+
+	if (capture->remaining && (cx != capture->cx || cy != capture->cy)) {
+		blog(LOG_WARNING,
+		     "[filter-pack] '%s': input resized, capture stopped early",
+		     obs_source_get_name(capture->context));
+		capture->remaining = 0;
+	}
+
+	/* Once every frame is staged, the ring drains one frame per render */
+	if (!capture->remaining) {
+		if (capture->mapped < capture->staged)
+			map_oldest(capture);
+		if (capture->mapped == capture->staged)
+			finish(capture, stats);
+		return false;
+	}
+
+	if (capture->staged - capture->mapped >= FRAME_CAPTURE_RING)
+		map_oldest(capture);
+
+	struct frame_capture_slot *slot =
+		&capture->slots[capture->staged % FRAME_CAPTURE_RING];
+
+	gs_texrender_t *input = render_pool_lease(GS_RGBA, cx, cy, stats);
+	if (!filter_render_input(input, capture->context,
+				 obs_filter_get_target(capture->context), cx,
+				 cy)) {
+		render_pool_return(input);
+		return false;
+	}
+	gs_stage_texture(slot->input, gs_texrender_get_texture(input));
+	render_pool_return(input);
+
+	capture->output = render_pool_lease(GS_RGBA, cx, cy, stats);
+	gs_texrender_reset(capture->output);
+	if (!gs_texrender_begin(capture->output, cx, cy)) {
+		render_pool_return(capture->output);
+		capture->output = NULL;
+		return false;
+	}
+
+	struct vec4 clear_color;
+	vec4_zero(&clear_color);
+	gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+	gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+	return true;
+}
+
+void frame_capture_end(struct frame_capture *capture)
+{
+	gs_blend_state_pop();
+	gs_texrender_end(capture->output);
+
+	struct frame_capture_slot *slot =
+		&capture->slots[capture->staged % FRAME_CAPTURE_RING];
+	gs_texture_t *tex = gs_texrender_get_texture(capture->output);
+
+	gs_stage_texture(slot->output, tex);
+	capture->staged++;
+	capture->remaining--;
+
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+
+	filter_draw_texture(effect,
+			    gs_effect_get_param_by_name(effect, "image"), tex,
+			    capture->cx, capture->cy);
+
+	render_pool_return(capture->output);
+	capture->output = NULL;
+}
+
+void frame_capture_free(struct frame_capture *capture,
+			struct filter_stats *stats)
+{
+	if (capture->writer)
+		finish(capture, stats);
+
+	bfree(capture->requested_path);
+	bfree(capture->requested_metadata);
+	pthread_mutex_destroy(&capture->mutex);
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <obs-module.h>
+#include <util/threading.h>
+#include "filter-pack.hpp"
+
+/* Raw capture of a filter's input and output frames (".fpcap"), laid out
+ * so that it can be memory mapped and replayed as is:
+ *
+ *   char     magic[4]   "FPCF"
+ *   uint32_t version    2
+ *   uint32_t width
+ *   uint32_t height
+ *   uint32_t frames
+ *   uint32_t metadata_size
+ *   uint32_t frame_offset
+ *   uint32_t reserved
+ *   char     metadata[metadata_size]
+ *   ...      padding up to frame_offset
+ *   struct {
+ *       uint8_t input[height][width][4];
+ *       uint8_t output[height][width][4];
+ *       ...     padding up to a multiple of FRAME_CAPTURE_ALIGNMENT
+ *   } frame[frames]
+ *
+ * frame_offset and every frame record are page aligned, so that each
+ * frame can be mapped on its own.  Everything is little-endian, pixels
+ * are RGBA with the top row first.  The metadata is JSON holding the
+ * filter's id, name and settings as they were when the capture was
+ * requested. */
+#define FRAME_CAPTURE_MAGIC "FPCF"
+#define FRAME_CAPTURE_VERSION 2
+#define FRAME_CAPTURE_HEADER_SIZE 32
+#define FRAME_CAPTURE_ALIGNMENT 4096
+
+/* Frames are staged into a ring this deep and mapped when their slot comes
+ * around again, so the GPU has long finished with them by then */
+#define FRAME_CAPTURE_RING 3
+
+struct frame_capture_slot {
+	gs_stagesurf_t *input;
+	gs_stagesurf_t *output;
+};
+
+struct frame_capture_writer;
+
+/* Per-instance capture state, driven through the filter's
+ * "capture_frames" proc.  The request is handed to the graphics thread
+ * under `mutex`; everything else belongs to the graphics thread, apart
+ * from the file, which a writer thread fills. */
+struct frame_capture {
+	obs_source_t *context;
+
+	pthread_mutex_t mutex;
+	volatile bool requested;
+	char *requested_path;
+	char *requested_metadata;
+	long requested_frames;
+
+	uint32_t cx, cy;
+	long remaining;
+	long staged;
+	long mapped;
+	struct frame_capture_slot slots[FRAME_CAPTURE_RING];
+	int64_t bytes;
+
+	gs_texrender_t *output;
+	struct frame_capture_writer *writer;
+};
+
+void frame_capture_init(struct frame_capture *capture, obs_source_t *context);
+
+/* Size of one frame record in the file, padding included */
+static inline size_t frame_capture_record_size(uint32_t cx, uint32_t cy)
+{
+	size_t size = (size_t)cx * cy * 4 * 2;
+	return (size + FRAME_CAPTURE_ALIGNMENT - 1) &
+	       ~(size_t)(FRAME_CAPTURE_ALIGNMENT - 1);
+}
+
+/* True while a capture is requested or running.  The filter must then
+ * render for real even where it would otherwise be bypassed or folded
+ * into a neighbour, or the capture would never see a frame. */
+static inline bool frame_capture_pending(struct frame_capture *capture)
+{
+	return os_atomic_load_bool(&capture->requested) || capture->writer;
+}
+
+/* Must be called from within the graphics context.  Frames still in the
+ * ring are read back, waiting on the GPU if need be, and handed to the
+ * writer, which completes the file in the background. */
+void frame_capture_free(struct frame_capture *capture,
+			struct filter_stats *stats);
+
+/* While a capture is running, stages the filter's input and redirects
+ * everything the filter draws until frame_capture_end, which stages it
+ * as the output and then draws it in its place.  Returns false when
+ * there is nothing to capture this frame. */
+bool frame_capture_begin(struct frame_capture *capture,
+			 struct filter_stats *stats, uint32_t cx, uint32_t cy);
+void frame_capture_end(struct frame_capture *capture);
+
+/* Joins writers that have completed their file, or with `wait` every
+ * writer, once all of them have.  Called from the module's tick and,
+ * waiting, on unload, never from within the graphics context. */
+void frame_capture_reap(bool wait);
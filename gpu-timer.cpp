@@ -0,0 +1,195 @@
+#include <obs-module.h>
+#include <util/threading.h>
+#include <stdio.h>
+#include "gpu-timer.hpp"
+
+/* Weight of a new sample in the rolling averages */
+#define GPU_TIMER_SMOOTHING 16
+
+static void gpu_time_proc(void *data, calldata_t *cd)
+{
+	struct gpu_timer *timer = (struct gpu_timer *)data;
+
+	calldata_set_float(cd, "frame_ms",
+			   os_atomic_load_long(&timer->frame_ns) / 1000000.0);
+	calldata_set_float(cd, "section_ms",
+			   os_atomic_load_long(&timer->section_ns) /
+				   1000000.0);
+	calldata_set_int(cd, "samples", os_atomic_load_long(&timer->samples));
+}
+
+void gpu_timer_init(struct gpu_timer *timer, obs_source_t *context)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(context);
+
+	proc_handler_add(ph,
+			 "void get_gpu_time(out float frame_ms, "
+			 "out float section_ms, out int samples)",
+			 gpu_time_proc, timer);
+}
+
+void gpu_timer_free(struct gpu_timer *timer)
+{
+	for (size_t i = 0; i < GPU_TIMER_LATENCY; i++) {
+		struct gpu_timer_slot *slot = &timer->slots[i];
+
+		for (size_t j = 0; j < slot->num_timers; j++)
+			gs_timer_destroy(slot->timers[j]);
+
+		bfree(slot->timers);
+		gs_timer_range_destroy(slot->range);
+	}
+
+	memset(timer->slots, 0, sizeof(timer->slots));
+}
+
+static inline void update_average(volatile long *average, long samples,
+				  double ns)
+{
+	long prev = os_atomic_load_long(average);
+
+	if (samples)
+		ns = prev + (ns - prev) / GPU_TIMER_SMOOTHING;
+	os_atomic_set_long(average, (long)ns);
+}
+
+static void collect(struct gpu_timer *timer, struct gpu_timer_slot *slot)
+{
+	bool disjoint = false;
+	uint64_t frequency = 0;
+	uint64_t ticks;
+
+	slot->pending = false;
+
+	if (!gs_timer_range_get_data(slot->range, &disjoint, &frequency) ||
+	    disjoint || !frequency)
+		return;
+	if (!slot->used || !gs_timer_get_data(slot->timers[0], &ticks))
+		return;
+
+	double scale = 1000000000.0 / (double)frequency;
+	double frame = (double)ticks * scale;
+	double sections = 0.0;
+	size_t count = 0;
+
+	for (size_t i = 1; i < slot->used; i++) {
+		if (gs_timer_get_data(slot->timers[i], &ticks)) {
+			sections += (double)ticks * scale;
+			count++;
+		}
+	}
+
+	long samples = os_atomic_load_long(&timer->samples);
+
+	update_average(&timer->frame_ns, samples, frame);
+	if (count)
+		update_average(&timer->section_ns, samples,
+			       sections / (double)count);
+	os_atomic_inc_long(&timer->samples);
+}
+
+void gpu_timer_begin(struct gpu_timer *timer)
+{
+	if (timer->unsupported)
+		return;
+
+	struct gpu_timer_slot *slot = &timer->slots[timer->current];
+
+	if (slot->pending)
+		collect(timer, slot);
+
+	if (!slot->range) {
+		slot->range = gs_timer_range_create();
+
+		if (!slot->range) {
+			timer->unsupported = true;
+			return;
+		}
+	}
+
+	slot->used = 0;
+	gs_timer_range_begin(slot->range);
+	timer->active = true;
+
+	gpu_timer_section_begin(timer);
+}
+
+void gpu_timer_end(struct gpu_timer *timer)
+{
+	if (!timer->active)
+		return;
+
+	struct gpu_timer_slot *slot = &timer->slots[timer->current];
+
+	gpu_timer_section_end(timer, 0);
+	gs_timer_range_end(slot->range);
+
+	slot->pending = true;
+	timer->active = false;
+	timer->current = (timer->current + 1) % GPU_TIMER_LATENCY;
+}
+
+size_t gpu_timer_section_begin(struct gpu_timer *timer)
+{
+	if (!timer->active)
+		return GPU_TIMER_NO_SECTION;
+
+	struct gpu_timer_slot *slot = &timer->slots[timer->current];
+
+	if (slot->used == slot->num_timers) {
+		gs_timer_t *query = gs_timer_create();
+		if (!query)
+			return GPU_TIMER_NO_SECTION;
+
+		slot->timers = (gs_timer_t **)brealloc(
+			slot->timers,
+			sizeof(gs_timer_t *) * (slot->num_timers + 1));
+		slot->timers[slot->num_timers++] = query;
+	}
+
+	gs_timer_begin(slot->timers[slot->used]);
+	return slot->used++;
+}
+
+void gpu_timer_section_end(struct gpu_timer *timer, size_t section)
+{
+	struct gpu_timer_slot *slot = &timer->slots[timer->current];
+
+	if (!timer->active || section >= slot->used)
+		return;
+
+	gs_timer_end(slot->timers[section]);
+}
+
+static bool refresh_clicked(obs_properties_t *props, obs_property_t *property,
+			    void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	UNUSED_PARAMETER(data);
+	return true;
+}
+
+void gpu_timer_add_property(obs_properties_t *props,
+			    const struct gpu_timer *timer)
+{
+	char text[128] = "GPU Time: n/a";
+
+	if (timer && !timer->unsupported &&
+	    os_atomic_load_long(&timer->samples)) {
+		double frame = os_atomic_load_long(&timer->frame_ns) /
+			       1000000.0;
+		double section = os_atomic_load_long(&timer->section_ns) /
+				 1000000.0;
+
+		if (section > 0.0)
+			snprintf(text, sizeof(text),
+				 "GPU Time: %.3f ms (%.3f ms per pass)", frame,
+				 section);
+		else
+			snprintf(text, sizeof(text), "GPU Time: %.3f ms",
+				 frame);
+	}
+
+	obs_properties_add_button(props, "gpu_time", text, refresh_clicked);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <obs-module.h>
+
+/* Frames a query stays in flight before it is read back */
+#define GPU_TIMER_LATENCY 4
+
+#define GPU_TIMER_NO_SECTION ((size_t)-1)
+
+struct gpu_timer_slot {
+	gs_timer_range_t *range;
+	gs_timer_t **timers;
+	size_t num_timers;
+	size_t used;
+	bool pending;
+};
+
+/* Per-instance GPU timing of a filter's own draws (not the input it
+ * renders).  Each frame is one timer range holding a timer for the whole
+ * frame plus one per section, e.g. a stroke dilation pass.  Results are
+ * read back GPU_TIMER_LATENCY frames later so the graphics thread never
+ * waits on them, and are kept as rolling averages that any thread can
+ * read through the filter's "get_gpu_time" proc. */
+struct gpu_timer {
+	struct gpu_timer_slot slots[GPU_TIMER_LATENCY];
+	size_t current;
+	bool active;
+	bool unsupported;
+
+	volatile long frame_ns;
+	volatile long section_ns;
+	volatile long samples;
+};
+
+void gpu_timer_init(struct gpu_timer *timer, obs_source_t *context);
+/* Must be called from within the graphics context */
+void gpu_timer_free(struct gpu_timer *timer);
+
+void gpu_timer_begin(struct gpu_timer *timer);
+void gpu_timer_end(struct gpu_timer *timer);
+
+size_t gpu_timer_section_begin(struct gpu_timer *timer);
+void gpu_timer_section_end(struct gpu_timer *timer, size_t section);
+
+/* Read-only line in the filter's properties showing the rolling GPU time;
+ * clicking it refreshes the value. */
+void gpu_timer_add_property(obs_properties_t *props,
+			    const struct gpu_timer *timer);
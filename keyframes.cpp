@@ -0,0 +1,374 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/dstr.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "keyframes.hpp"
+
+struct keyframe {
+	size_t param;
+	size_t order;
+	double time;
+	double value;
+	enum keyframe_interp interp;
+	double x1, y1, x2, y2;
+};
+
+static enum keyframe_interp get_interp(const char *name)
+{
+	if (strcmp(name, "bezier") == 0)
+		return KEYFRAME_BEZIER;
+	if (strcmp(name, "hold") == 0)
+		return KEYFRAME_HOLD;
+	return KEYFRAME_LINEAR;
+}
+
+static double get_double(obs_data_t *item, const char *name, double def)
+{
+	return obs_data_has_user_value(item, name)
+		       ? obs_data_get_double(item, name)
+		       : def;
+}
+
+static double clamp01(double x)
+{
+	return x < 0.0 ? 0.0 : (x > 1.0 ? 1.0 : x);
+}
+
+/* One coordinate of a cubic bezier running from 0 to 1 */
+static double bezier(double p1, double p2, double t)
+{
+	double u = 1.0 - t;
+	return 3.0 * u * u * t * p1 + 3.0 * u * t * t * p2 + t * t * t;
+}
+
+static void fill_ease(struct keyframe_segment *segment,
+		      const struct keyframe *key)
+{
+	/* With both handles' x inside [0, 1] x(t) never turns back, so it
+	 * can be inverted by bisection */
+	double x1 = clamp01(key->x1);
+	double x2 = clamp01(key->x2);
+
+	for (size_t i = 0; i <= KEYFRAME_EASE_SAMPLES; i++) {
+		double x = (double)i / KEYFRAME_EASE_SAMPLES;
+		double lo = 0.0, hi = 1.0;
+
+		for (int step = 0; step < 32; step++) {
+			double mid = (lo + hi) * 0.5;
+			if (bezier(x1, x2, mid) < x)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		segment->ease[i] =
+			(float)bezier(key->y1, key->y2, (lo + hi) * 0.5);
+	}
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+	const struct keyframe *ka = (const struct keyframe *)a;
+	const struct keyframe *kb = (const struct keyframe *)b;
+
+	if (ka->param != kb->param)
+		return ka->param < kb->param ? -1 : 1;
+	if (ka->time != kb->time)
+		return ka->time < kb->time ? -1 : 1;
+	if (ka->order != kb->order)
+		return ka->order < kb->order ? -1 : 1;
+	return 0;
+}
+
+static void free_set(struct keyframe_set *set, size_t count)
+{
+	if (!set)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+		bfree(set->tracks[i].segments);
+	bfree(set->tracks);
+	bfree(set);
+}
+
+/* Turns the keys of each parameter into a segment table */
+static void build_track(struct keyframe_track *track,
+			const struct keyframe *keys, size_t count)
+{
+	track->animated = true;
+	track->first = keys[0].value;
+	track->last = keys[count - 1].value;
+
+	if (count < 2)
+		return;
+
+	track->segments = (struct keyframe_segment *)bzalloc(
+		sizeof(struct keyframe_segment) * (count - 1));
+	track->count = count - 1;
+
+	for (size_t i = 0; i < track->count; i++) {
+		struct keyframe_segment *segment = &track->segments[i];
+		const struct keyframe *key = &keys[i];
+		double length = keys[i + 1].time - key->time;
+
+		segment->start = key->time;
+		segment->end = keys[i + 1].time;
+		segment->inv_length = length > 0.0 ? 1.0 / length : 0.0;
+		segment->from = key->value;
+		segment->to = keys[i + 1].value;
+		segment->interp = key->interp;
+
+		if (segment->interp == KEYFRAME_BEZIER)
+			fill_ease(segment, key);
+	}
+}
+
+static struct keyframe_set *build_set(struct keyframe_anim *anim,
+				      obs_data_array_t *array)
+{
+	DARRAY(struct keyframe) keys;
+	da_init(keys);
+
+	size_t count = array ? obs_data_array_count(array) : 0;
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		const char *name = obs_data_get_string(item, "param");
+		size_t param = anim->count;
+
+		for (size_t j = 0; j < anim->count; j++) {
+			if (strcmp(anim->names[j], name) == 0)
+				param = j;
+		}
+
+		if (param == anim->count) {
+			blog(LOG_WARNING,
+			     "[filter-pack] unknown keyframe parameter '%s'",
+			     name);
+		} else {
+			struct keyframe *key =
+				(struct keyframe *)da_push_back_new(keys);
+			key->param = param;
+			key->order = i;
+			key->time = obs_data_get_double(item, "time");
+			key->value = obs_data_get_double(item, "value");
+			key->interp = get_interp(
+				obs_data_get_string(item, "interp"));
+			key->x1 = get_double(item, "x1", 0.42);
+			key->y1 = get_double(item, "y1", 0.0);
+			key->x2 = get_double(item, "x2", 0.58);
+			key->y2 = get_double(item, "y2", 1.0);
+		}
+
+		obs_data_release(item);
+	}
+
+	qsort(keys.array, keys.num, sizeof(struct keyframe), compare_keys);
+
+	struct keyframe_set *set =
+		(struct keyframe_set *)bzalloc(sizeof(struct keyframe_set));
+	set->tracks = (struct keyframe_track *)bzalloc(
+		sizeof(struct keyframe_track) * anim->count);
+
+	for (size_t i = 0; i < keys.num;) {
+		size_t end = i;
+		while (end < keys.num &&
+		       keys.array[end].param == keys.array[i].param)
+			end++;
+
+		build_track(&set->tracks[keys.array[i].param], &keys.array[i],
+			    end - i);
+		if (keys.array[end - 1].time > set->length)
+			set->length = keys.array[end - 1].time;
+		i = end;
+	}
+
+	da_free(keys);
+	return set;
+}
+
+static double sample_segment(const struct keyframe_segment *segment,
+			     double time)
+{
+	double u = clamp01((time - segment->start) * segment->inv_length);
+
+	switch (segment->interp) {
+	case KEYFRAME_HOLD:
+		return segment->from;
+	case KEYFRAME_BEZIER: {
+		double f = u * KEYFRAME_EASE_SAMPLES;
+		size_t i = (size_t)f;
+		if (i >= KEYFRAME_EASE_SAMPLES)
+			i = KEYFRAME_EASE_SAMPLES - 1;
+
+		double e0 = segment->ease[i];
+		double e1 = segment->ease[i + 1];
+		u = e0 + (e1 - e0) * (f - (double)i);
+		break;
+	}
+	case KEYFRAME_LINEAR:
+		break;
+	}
+
+	return segment->from + (segment->to - segment->from) * u;
+}
+
+static double sample_track(struct keyframe_track *track, double time)
+{
+	if (!track->count || time <= track->segments[0].start)
+		return track->first;
+	if (time >= track->segments[track->count - 1].end)
+		return track->last;
+
+	/* The clock only runs forward between wraps, so the segment is
+	 * usually the one sampled last */
+	if (track->cursor >= track->count ||
+	    track->segments[track->cursor].start > time)
+		track->cursor = 0;
+	while (track->segments[track->cursor].end <= time)
+		track->cursor++;
+
+	return sample_segment(&track->segments[track->cursor], time);
+}
+
+/* Values of the tracks at `time`, for keyframe_anim_get */
+static void store_values(struct keyframe_anim *anim, struct keyframe_set *set,
+			 double time)
+{
+	for (size_t i = 0; i < anim->count; i++) {
+		struct keyframe_track *track = &set->tracks[i];
+
+		anim->values[i].animated = track->animated;
+		if (track->animated)
+			anim->values[i].value = sample_track(track, time);
+	}
+}
+
+void keyframe_anim_init(struct keyframe_anim *anim, const char *const *names,
+			size_t count)
+{
+	anim->names = names;
+	anim->count = count;
+	anim->values = (struct keyframe_value *)bzalloc(
+		sizeof(struct keyframe_value) * count);
+	pthread_mutex_init(&anim->mutex, NULL);
+}
+
+void keyframe_anim_free(struct keyframe_anim *anim)
+{
+	free_set(anim->pending, anim->count);
+	free_set(anim->current, anim->count);
+	bfree(anim->keys_json);
+	bfree(anim->values);
+	pthread_mutex_destroy(&anim->mutex);
+}
+
+void keyframe_anim_update(struct keyframe_anim *anim, obs_data_t *settings)
+{
+	os_atomic_set_bool(&anim->loop,
+			   obs_data_get_bool(settings, "keyframes_loop"));
+
+	/* Settings are pushed for all sorts of reasons, so the tables are
+	 * only rebuilt, and the clock restarted, when the keys change */
+	obs_data_array_t *array = obs_data_get_array(settings, "keyframes");
+	size_t count = array ? obs_data_array_count(array) : 0;
+	struct dstr json = {0};
+
+	for (size_t i = 0; i < count; i++) {
+		obs_data_t *item = obs_data_array_item(array, i);
+		dstr_cat(&json, obs_data_get_json(item));
+		obs_data_release(item);
+	}
+
+	pthread_mutex_lock(&anim->mutex);
+
+	const char *previous = anim->keys_json ? anim->keys_json : "";
+	if (strcmp(previous, json.array ? json.array : "") != 0) {
+		bfree(anim->keys_json);
+		anim->keys_json = json.array;
+		json.array = NULL;
+
+		/* The clock restarts, so the values it starts from apply
+		 * from this update on */
+		free_set(anim->pending, anim->count);
+		anim->pending = build_set(anim, array);
+		store_values(anim, anim->pending, 0.0);
+	}
+
+	pthread_mutex_unlock(&anim->mutex);
+
+	dstr_free(&json);
+	obs_data_array_release(array);
+}
+
+void keyframe_anim_add_property(obs_properties_t *props)
+{
+	obs_properties_add_bool(props, "keyframes_loop", "Loop Keyframes");
+}
+
+bool keyframe_anim_tick(struct keyframe_anim *anim, float seconds)
+{
+	pthread_mutex_lock(&anim->mutex);
+	struct keyframe_set *pending = anim->pending;
+	anim->pending = NULL;
+
+	bool changed = false;
+
+	if (pending) {
+		free_set(anim->current, anim->count);
+		anim->current = pending;
+		anim->time = 0.0;
+		changed = true;
+	} else if (anim->current) {
+		anim->time += seconds;
+	}
+
+	struct keyframe_set *set = anim->current;
+	if (!set) {
+		pthread_mutex_unlock(&anim->mutex);
+		return false;
+	}
+
+	if (anim->time > set->length) {
+		if (os_atomic_load_bool(&anim->loop) && set->length > 0.0)
+			anim->time = fmod(anim->time, set->length);
+		else
+			anim->time = set->length;
+	}
+
+	for (size_t i = 0; i < anim->count; i++) {
+		struct keyframe_track *track = &set->tracks[i];
+
+		anim->values[i].animated = track->animated;
+		if (!track->animated)
+			continue;
+
+		double value = sample_track(track, anim->time);
+		if (!track->sampled || value != track->value)
+			changed = true;
+
+		track->value = value;
+		track->sampled = true;
+		anim->values[i].value = value;
+	}
+
+	pthread_mutex_unlock(&anim->mutex);
+	return changed;
+}
+
+bool keyframe_anim_get(struct keyframe_anim *anim, size_t param,
+		       double *value)
+{
+	bool animated = false;
+
+	pthread_mutex_lock(&anim->mutex);
+	if (param < anim->count && anim->values[param].animated) {
+		*value = anim->values[param].value;
+		animated = true;
+	}
+	pthread_mutex_unlock(&anim->mutex);
+
+	return animated;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <obs-module.h>
+#include <util/threading.h>
+
+/* Keyframe animation of a filter's numeric parameters, so that scripts can
+ * hand over a whole move once instead of pushing settings every frame.
+ *
+ * Keys live in the "keyframes" array of the filter's settings, one object
+ * per key:
+ *
+ *   "param"   name of the animated setting, e.g. "topLeftX"
+ *   "time"    seconds from the start of the animation
+ *   "value"   value at that time
+ *   "interp"  how to reach the next key: "linear" (default), "bezier" or
+ *             "hold"
+ *   "x1", "y1", "x2", "y2"
+ *             bezier easing handles, as in CSS cubic-bezier(); they
+ *             default to ease-in-out (0.42, 0, 0.58, 1)
+ *
+ * The clock starts when the keys change and stops on the last key, or
+ * wraps around to 0 with "keyframes_loop" on. */
+#define KEYFRAME_EASE_SAMPLES 32
+
+enum keyframe_interp {
+	KEYFRAME_LINEAR,
+	KEYFRAME_BEZIER,
+	KEYFRAME_HOLD,
+};
+
+struct keyframe_segment {
+	double start, end;
+	double inv_length;
+	double from, to;
+	enum keyframe_interp interp;
+
+	/* Eased progress at evenly spaced points of the segment */
+	float ease[KEYFRAME_EASE_SAMPLES + 1];
+};
+
+/* Keys of one parameter, turned into segments between consecutive keys.
+ * A track with a single key holds its value. */
+struct keyframe_track {
+	bool animated;
+	struct keyframe_segment *segments;
+	size_t count;
+	double first, last;
+
+	size_t cursor;
+	double value;
+	bool sampled;
+};
+
+struct keyframe_set {
+	struct keyframe_track *tracks;
+	double length;
+};
+
+struct keyframe_value {
+	bool animated;
+	double value;
+};
+
+/* Animation state of one filter instance.  update builds the segment
+ * tables and hands them over through `pending`; the latest value of each
+ * parameter is kept in `values` for both threads.  Everything else belongs
+ * to the thread running video_tick. */
+struct keyframe_anim {
+	const char *const *names;
+	size_t count;
+
+	pthread_mutex_t mutex;
+	char *keys_json;
+	struct keyframe_set *pending;
+	struct keyframe_value *values;
+	volatile bool loop;
+
+	struct keyframe_set *current;
+	double time;
+};
+
+void keyframe_anim_init(struct keyframe_anim *anim, const char *const *names,
+			size_t count);
+void keyframe_anim_free(struct keyframe_anim *anim);
+
+/* Call in update before the settings are published, then lay the values
+ * from keyframe_anim_get over them within the same parameter write, so
+ * that no frame renders without the animation.  New keys apply from
+ * their start. */
+void keyframe_anim_update(struct keyframe_anim *anim, obs_data_t *settings);
+void keyframe_anim_add_property(obs_properties_t *props);
+
+/* Advances the clock and samples every track.  Returns true if any
+ * animated value has to be written into the filter's parameters, which
+ * keyframe_anim_get then reads back one by one. */
+bool keyframe_anim_tick(struct keyframe_anim *anim, float seconds);
+bool keyframe_anim_get(struct keyframe_anim *anim, size_t param,
+		       double *value);
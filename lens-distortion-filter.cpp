@@ -2,19 +2,74 @@
 #include <obs-source.h>
 #include <obs.h>
 #include <util/platform.h>
+#include <string.h>
+#include <algorithm>
+#include "lens-distortion-filter.hpp"
+#include "corner-pin-filter.hpp"
+#include "render-pool.hpp"
+#include "lens_distortion_filter.effect.h"
 
-struct lens_distortion_data {
-	obs_source_t *context;
+extern struct obs_source_info lens_distortion_filter;
 
-	gs_effect_t *effect;
-	gs_eparam_t *amount, *zoom_param;
-	gs_eparam_t *width, *height;
+enum lens_distortion_param {
+	PARAM_STRENGTH,
+	PARAM_ZOOM,
+	PARAM_TEXWIDTH,
+	PARAM_TEXHEIGHT,
+	PARAM_IMAGE,
+	PARAM_UV1,
+	PARAM_UV2,
+	PARAM_UV3,
+	PARAM_UV4,
+	NUM_PARAMS,
+};
+
+static const char *const lens_distortion_params[NUM_PARAMS] = {
+	"strength", "zoom", "texwidth", "texheight", "image",
+	"uv1",      "uv2",  "uv3",      "uv4",
+};
+
+enum lens_distortion_feature {
+	FEATURE_HORIZONTAL,
+	FEATURE_FUSE_CORNER,
+	FEATURE_QUALITY,
+	NUM_FEATURES,
+};
+
+static const struct effect_feature lens_distortion_features[NUM_FEATURES] = {
+	{"HORIZONTAL", NULL, 0},
+	{"FUSE_CORNER", NULL, 0},
+	{"QUALITY", filter_quality_values, NUM_QUALITY},
+};
+
+static struct effect_variants variants = EFFECT_VARIANTS(
+	"lens_distortion_filter.effect", lens_distortion_filter_effect,
+	lens_distortion_features, NUM_FEATURES, lens_distortion_params,
+	NUM_PARAMS);
+
+/* Settings that keyframes can animate, in keyframe_anim order */
+enum lens_distortion_animated {
+	ANIMATED_STRENGTH,
+	ANIMATED_ZOOM,
+	NUM_ANIMATED,
+};
 
-	double strength;
-	float zoom;
-	bool dimension;
+static const char *const lens_distortion_animated[NUM_ANIMATED] = {
+	"Strength",
+	"Zoom",
 };
 
+static void apply_animation(struct lens_distortion_params *params,
+			    struct keyframe_anim *anim)
+{
+	double value;
+
+	if (keyframe_anim_get(anim, ANIMATED_STRENGTH, &value))
+		params->strength = value;
+	if (keyframe_anim_get(anim, ANIMATED_ZOOM, &value))
+		params->zoom = (float)value;
+}
+
 static const char *lens_distortion_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -23,84 +78,248 @@ static const char *lens_distortion_getname(void *unused)
 
 static void lens_distortion_update(void *data, obs_data_t *settings)
 {
+	filter_profile_scope scope("lens_distortion_update");
+
 	struct lens_distortion_data *filter = (lens_distortion_data *)data;
+	struct lens_distortion_params params = {0};
 
-	filter->strength = obs_data_get_double(settings, "Strength");
-	filter->zoom = obs_data_get_double(settings, "Zoom");
-	filter->dimension = obs_data_get_string(settings, "Dimension") ==
-			    "Horizontal";
+	params.strength = obs_data_get_double(settings, "Strength");
+	params.zoom = obs_data_get_double(settings, "Zoom");
+	params.dimension = strcmp(obs_data_get_string(settings, "Dimension"),
+				  "Horizontal") == 0;
+	params.quality = filter_quality_get(settings);
+	params.adaptive = filter_adaptive_get(settings);
+	filter_stats_update(&filter->stats, settings);
+	keyframe_anim_update(&filter->anim, settings);
+
+	filter_params_write_begin(&filter->params_lock);
+	filter->params = params;
+	apply_animation(&filter->params, &filter->anim);
+	filter_params_write_end(&filter->params_lock);
 }
 
 static void lens_distortion_destroy(void *data)
 {
+	filter_profile_scope scope("lens_distortion_destroy");
+
 	struct lens_distortion_data *filter = (lens_distortion_data *)data;
 
-	if (filter->effect) {
-		obs_enter_graphics();
-		gs_effect_destroy(filter->effect);
-		obs_leave_graphics();
-	}
+	effect_variants_release(&variants);
+	render_pool_release(&filter->stats);
+
+	obs_enter_graphics();
+	frame_capture_free(&filter->capture, &filter->stats);
+	gpu_timer_free(&filter->gpu_timer);
+	obs_leave_graphics();
 
+	keyframe_anim_free(&filter->anim);
+	filter_params_lock_free(&filter->params_lock);
 	bfree(data);
 }
 
+/* "Dimension" used to be ignored, so every filter saved before it took
+ * effect drew vertically whatever it said; keep those drawing that way */
+#define LENS_SETTINGS_VERSION 1
+
+static void migrate_settings(obs_data_t *settings)
+{
+	if (obs_data_get_int(settings, "settings_version") >=
+	    LENS_SETTINGS_VERSION)
+		return;
+
+	obs_data_set_string(settings, "Dimension", "Vertical");
+	obs_data_set_int(settings, "settings_version", LENS_SETTINGS_VERSION);
+}
+
 static void *lens_distortion_create(obs_data_t *settings, obs_source_t *context)
 {
+	filter_profile_scope scope("lens_distortion_create");
+
 	struct lens_distortion_data *filter = (lens_distortion_data *)bzalloc(
 		sizeof(struct lens_distortion_data));
-	char *effect_path = obs_module_file("lens_distortion_filter.effect");
 
 	filter->context = context;
+	filter_params_lock_init(&filter->params_lock);
+	keyframe_anim_init(&filter->anim, lens_distortion_animated,
+			   NUM_ANIMATED);
+	filter_stats_init(&filter->stats, context, VRAM_LENS_DISTORTION);
+	filter_stats_budget(&filter->stats, 1);
+	gpu_timer_init(&filter->gpu_timer, context);
+	frame_capture_init(&filter->capture, context);
 
-	obs_enter_graphics();
+	effect_variants_acquire(&variants);
+	render_pool_acquire();
+
+	migrate_settings(settings);
+	lens_distortion_update(filter, settings);
+	return filter;
+}
+
+struct lens_distortion_data *lens_distortion_get_fusable(obs_source_t *source)
+{
+	if (!source || !obs_source_enabled(source))
+		return NULL;
+	if (strcmp(obs_source_get_id(source), lens_distortion_filter.id) != 0)
+		return NULL;
+
+	struct lens_distortion_data *filter =
+		(lens_distortion_data *)obs_obj_get_data(source);
+	if (!filter || filter->bypass.active ||
+	    frame_capture_pending(&filter->capture))
+		return NULL;
+
+	return filter;
+}
+
+static void lens_distortion_tick(void *data, float seconds)
+{
+	filter_profile_scope scope("lens_distortion_tick");
+
+	struct lens_distortion_data *filter = (lens_distortion_data *)data;
+	struct lens_distortion_params params;
 
-	filter->effect = gs_effect_create_from_file(effect_path, NULL);
-
-	if (filter->effect) {
-		filter->amount =
-			gs_effect_get_param_by_name(filter->effect, "strength");
-		filter->zoom_param =
-			gs_effect_get_param_by_name(filter->effect, "zoom");
-		filter->width =
-			gs_effect_get_param_by_name(filter->effect, "texwidth");
-		filter->height = gs_effect_get_param_by_name(filter->effect,
-							     "texheight");
+	if (keyframe_anim_tick(&filter->anim, seconds)) {
+		filter_params_write_begin(&filter->params_lock);
+		apply_animation(&filter->params, &filter->anim);
+		filter_params_write_end(&filter->params_lock);
 	}
 
-	obs_leave_graphics();
+	lens_distortion_read_params(filter, &params);
 
-	bfree(effect_path);
+	if (params.adaptive)
+		filter_pressure_tick(seconds);
 
-	if (!filter->effect) {
-		lens_distortion_destroy(filter);
-		return NULL;
+	/* Whether the settings are an identity depends on the target's
+	 * aspect ratio and the tier adaptive quality picks, so this is
+	 * checked every tick */
+	obs_source_t *target = obs_filter_get_target(filter->context);
+	bool identity = lens_distortion_is_identity(
+		&params, filter_quality_adapt(params.quality, params.adaptive),
+		obs_source_get_base_width(target),
+		obs_source_get_base_height(target));
+	filter_bypass_set(&filter->bypass, filter->context, identity);
+
+	filter_stats_tick(&filter->stats, filter->context, &filter->gpu_timer,
+			  seconds);
+}
+
+static void set_params(const struct lens_distortion_params *lp,
+		       gs_eparam_t **params, uint32_t cx, uint32_t cy)
+{
+	gs_effect_set_float(params[PARAM_STRENGTH], (float)lp->strength);
+	gs_effect_set_float(params[PARAM_ZOOM], lp->zoom);
+	gs_effect_set_int(params[PARAM_TEXHEIGHT], cy);
+	gs_effect_set_int(params[PARAM_TEXWIDTH], cx);
+}
+
+static void draw_output(struct lens_distortion_data *filter,
+			const struct effect_variant *variant,
+			const struct lens_distortion_params *lp,
+			struct corner_pin_data *corner,
+			const struct corner_pin_params *cp, uint32_t cx,
+			uint32_t cy)
+{
+	gs_eparam_t **params = variant->params;
+
+	if (!corner) {
+		if (!obs_source_process_filter_begin(
+			    filter->context, GS_RGBA,
+			    OBS_ALLOW_DIRECT_RENDERING))
+			return;
+
+		set_params(lp, params, cx, cy);
+		gpu_timer_begin(&filter->gpu_timer);
+		obs_source_process_filter_end(filter->context, variant->effect,
+					      0, 0);
+		gpu_timer_end(&filter->gpu_timer);
+		filter_stats_frame(&filter->stats, 1);
+		return;
 	}
 
-	lens_distortion_update(filter, settings);
-	return filter;
+	/* The corner pin below folds into this pass: render its input and
+	 * resample it once through both mappings. */
+	gs_texrender_t *input =
+		render_pool_lease(GS_RGBA, cx, cy, &filter->stats);
+
+	if (!filter_render_input(input, filter->context,
+				 obs_filter_get_target(corner->context), cx,
+				 cy)) {
+		render_pool_return(input);
+		return;
+	}
+
+	set_params(lp, params, cx, cy);
+	gs_effect_set_vec2(params[PARAM_UV1], &cp->uv1);
+	gs_effect_set_vec2(params[PARAM_UV2], &cp->uv2);
+	gs_effect_set_vec2(params[PARAM_UV3], &cp->uv3);
+	gs_effect_set_vec2(params[PARAM_UV4], &cp->uv4);
+
+	gpu_timer_begin(&filter->gpu_timer);
+	filter_draw_texture(variant->effect, params[PARAM_IMAGE],
+			    gs_texrender_get_texture(input), cx, cy);
+	gpu_timer_end(&filter->gpu_timer);
+	render_pool_return(input);
+	filter_stats_frame(&filter->stats, 1);
 }
 
 static void lens_distortion_render(void *data, gs_effect_t *effect)
 {
+	filter_profile_scope scope("lens_distortion_render");
+
 	struct lens_distortion_data *filter = (lens_distortion_data *)data;
 
-	if (!obs_source_process_filter_begin(filter->context, GS_RGBA,
-					     OBS_ALLOW_DIRECT_RENDERING))
+	if (!frame_capture_pending(&filter->capture) &&
+	    filter_bypass_render(&filter->bypass, &filter->stats,
+				 filter->context))
 		return;
 
-	gs_effect_set_float(filter->amount, filter->strength);
-	gs_effect_set_float(filter->zoom_param, filter->zoom);
+	struct lens_distortion_params lp;
+	struct corner_pin_params cp;
+
+	lens_distortion_read_params(filter, &lp);
+
 	obs_source_t *target = obs_filter_get_target(filter->context);
-	gs_effect_set_int(filter->height, obs_source_get_base_height(target));
-	gs_effect_set_int(filter->width, obs_source_get_base_width(target));
+	struct corner_pin_data *corner = corner_pin_get_fusable(target);
+
+	if (corner)
+		corner_pin_read_params(corner, &cp);
 
-	obs_source_process_filter_end(filter->context, filter->effect, 0, 0);
+	uint32_t features[NUM_FEATURES];
+	features[FEATURE_HORIZONTAL] = lp.dimension;
+	features[FEATURE_FUSE_CORNER] = corner != NULL;
+	enum filter_quality quality = filter_quality_adapt(lp.quality,
+							   lp.adaptive);
+	if (corner)
+		quality = std::max(quality, filter_quality_adapt(cp.quality,
+								 cp.adaptive));
+	features[FEATURE_QUALITY] = quality;
+
+	const struct effect_variant *variant = effect_variants_get(
+		&variants, effect_variants_key(&variants, features));
+
+	if (!variant) {
+		obs_source_skip_video_filter(filter->context);
+		return;
+	}
+
+	uint32_t cx = obs_source_get_base_width(target);
+	uint32_t cy = obs_source_get_base_height(target);
+
+	bool capture = frame_capture_begin(&filter->capture, &filter->stats,
+					   cx, cy);
+
+	draw_output(filter, variant, &lp, corner, &cp, cx, cy);
+
+	if (capture)
+		frame_capture_end(&filter->capture);
 
 	UNUSED_PARAMETER(effect);
 }
 
 static obs_properties_t *lens_distortion_properties(void *data)
 {
+	filter_profile_scope scope("lens_distortion_properties");
+
 	obs_properties_t *props = obs_properties_create();
 	obs_property_t *p;
 
@@ -113,8 +332,13 @@ static obs_properties_t *lens_distortion_properties(void *data)
 				    OBS_COMBO_FORMAT_STRING);
 	obs_property_list_add_string(p, "Horizontal", "Horizontal");
 	obs_property_list_add_string(p, "Vertical", "Vertical");
+	filter_quality_add_property(props);
+	filter_adaptive_add_property(props);
+	keyframe_anim_add_property(props);
+	filter_stats_add_property(props);
 
-	UNUSED_PARAMETER(data);
+	struct lens_distortion_data *filter = (lens_distortion_data *)data;
+	gpu_timer_add_property(props, filter ? &filter->gpu_timer : NULL);
 	return props;
 }
 
@@ -123,9 +347,12 @@ static void lens_distortion_defaults(obs_data_t *settings)
 	obs_data_set_default_double(settings, "Strength", 0);
 	obs_data_set_default_string(settings, "Dimension", "Vertical");
 	obs_data_set_default_double(settings, "Zoom", 1.0);
+	obs_data_set_default_int(settings, "quality", QUALITY_SINGLE);
+	obs_data_set_default_bool(settings, "adaptive_quality", false);
+	obs_data_set_default_bool(settings, "keyframes_loop", false);
 }
 
-struct obs_source_info lens_distortion_filter = [&] {
+struct obs_source_info lens_distortion_filter = [] {
 	obs_source_info lens_distortion_filter = {0};
 	lens_distortion_filter.id = "lens_distortion_filter";
 	lens_distortion_filter.type = OBS_SOURCE_TYPE_FILTER;
@@ -134,6 +361,7 @@ struct obs_source_info lens_distortion_filter = [&] {
 	lens_distortion_filter.create = lens_distortion_create;
 	lens_distortion_filter.destroy = lens_distortion_destroy;
 	lens_distortion_filter.update = lens_distortion_update;
+	lens_distortion_filter.video_tick = lens_distortion_tick;
 	lens_distortion_filter.video_render = lens_distortion_render;
 	lens_distortion_filter.get_properties = lens_distortion_properties;
 	lens_distortion_filter.get_defaults = lens_distortion_defaults;
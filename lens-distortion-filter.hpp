@@ -0,0 +1,58 @@
+#pragma once
+
+#include <obs-module.h>
+#include "effect-variants.hpp"
+#include "filter-pack.hpp"
+#include "frame-capture.hpp"
+#include "gpu-timer.hpp"
+#include "keyframes.hpp"
+
+struct lens_distortion_params {
+	double strength;
+	float zoom;
+	bool dimension;
+	enum filter_quality quality;
+	bool adaptive;
+};
+
+struct lens_distortion_data {
+	obs_source_t *context;
+
+	struct filter_params_lock params_lock;
+	struct lens_distortion_params params;
+	struct keyframe_anim anim;
+
+	struct filter_bypass bypass;
+	struct frame_capture capture;
+	struct filter_stats stats;
+	struct gpu_timer gpu_timer;
+};
+
+static inline void
+lens_distortion_read_params(struct lens_distortion_data *filter,
+			    struct lens_distortion_params *params)
+{
+	filter_params_read(&filter->params_lock, params, &filter->params,
+			   sizeof(*params));
+}
+
+/* No strength and no zoom leave every sample where it was, but the shader
+ * also scales one axis by texwidth / texheight, which it divides as ints.
+ * Only targets whose integer ratio is 1, at least as wide as they are tall
+ * and less than twice as wide, come out unchanged.  Even then the RGSS and
+ * 9-tap tiers average taps half a texel off center and blur the image, so
+ * only the single tap and bicubic tiers (`quality` as drawn, after any
+ * adaptation) are exact. */
+static inline bool
+lens_distortion_is_identity(const struct lens_distortion_params *params,
+			    enum filter_quality quality, uint32_t cx,
+			    uint32_t cy)
+{
+	return params->strength == 0.0 && params->zoom == 1.0f &&
+	       (quality == QUALITY_SINGLE || quality == QUALITY_BICUBIC) &&
+	       cy > 0 && cx / cy == 1;
+}
+
+/* Returns the lens distortion instance behind `source` if it is one that an
+ * adjacent geometric filter can fold into its own resample, else NULL. */
+struct lens_distortion_data *lens_distortion_get_fusable(obs_source_t *source);
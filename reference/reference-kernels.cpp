@@ -0,0 +1,686 @@
+#include "reference-kernels.hpp"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REF_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+bool ref_image_init(struct ref_image *img, uint32_t width, uint32_t height)
+{
+	img->width = width;
+	img->height = height;
+	img->data = (float *)calloc((size_t)width * height * 4, sizeof(float));
+	return img->data != NULL || !width || !height;
+}
+
+void ref_image_free(struct ref_image *img)
+{
+	free(img->data);
+	memset(img, 0, sizeof(*img));
+}
+
+bool ref_path_supported(enum ref_path path)
+{
+#ifdef REF_HAVE_SSE2
+	return path == REF_PATH_SCALAR || path == REF_PATH_SSE2;
+#else
+	return path == REF_PATH_SCALAR;
+#endif
+}
+
+#define UNUSED_PATH(path) (void)(path)
+
+static inline bool same_size(const struct ref_image *a,
+			     const struct ref_image *b)
+{
+	return a->data && b->data && a->width == b->width &&
+	       a->height == b->height;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Sampler emulation                                                          */
+
+static inline void fetch(const struct ref_image *img, bool clamp, int x, int y,
+			 float out[4])
+{
+	if (clamp) {
+		x = x < 0 ? 0 : (x >= (int)img->width ? img->width - 1 : x);
+		y = y < 0 ? 0 : (y >= (int)img->height ? img->height - 1 : y);
+	} else if (x < 0 || y < 0 || x >= (int)img->width ||
+		   y >= (int)img->height) {
+		/* BorderColor = 00000000 */
+		out[0] = out[1] = out[2] = out[3] = 0.0f;
+		return;
+	}
+
+	memcpy(out, ref_image_pixel(img, x, y), sizeof(float) * 4);
+}
+
+/* Filter = Linear with texel centers at half-integers, as in D3D11 */
+static void sample(const struct ref_image *img, bool clamp, float u, float v,
+		   float out[4])
+{
+	float tx = u * (float)img->width - 0.5f;
+	float ty = v * (float)img->height - 0.5f;
+
+	/* Keep far out of range coordinates (the lens distortion mapping can
+	 * produce them) from overflowing the integer conversion; NaNs land
+	 * here as well. */
+	float limit = (float)(img->width > img->height ? img->width
+						       : img->height) +
+		      2.0f;
+	if (!(tx > -limit && tx < limit && ty > -limit && ty < limit)) {
+		if (!clamp || tx != tx || ty != ty) {
+			out[0] = out[1] = out[2] = out[3] = 0.0f;
+			return;
+		}
+		tx = tx < -limit ? -limit : (tx > limit ? limit : tx);
+		ty = ty < -limit ? -limit : (ty > limit ? limit : ty);
+	}
+
+	float fx = floorf(tx);
+	float fy = floorf(ty);
+	/* 8 bits of subtexel precision, the minimum D3D10+ hardware provides;
+	 * taps meant to land on texel centers then fetch exactly one texel */
+	float ax = floorf((tx - fx) * 256.0f + 0.5f) / 256.0f;
+	float ay = floorf((ty - fy) * 256.0f + 0.5f) / 256.0f;
+	int x0 = (int)fx;
+	int y0 = (int)fy;
+	float c00[4], c10[4], c01[4], c11[4];
+
+	fetch(img, clamp, x0, y0, c00);
+	fetch(img, clamp, x0 + 1, y0, c10);
+	fetch(img, clamp, x0, y0 + 1, c01);
+	fetch(img, clamp, x0 + 1, y0 + 1, c11);
+
+	for (int i = 0; i < 4; i++) {
+		float top = c00[i] + (c10[i] - c00[i]) * ax;
+		float bottom = c01[i] + (c11[i] - c01[i]) * ax;
+		out[i] = top + (bottom - top) * ay;
+	}
+}
+
+static inline void accumulate(float acc[4], const float c[4], float weight)
+{
+	for (int i = 0; i < 4; i++)
+		acc[i] += c[i] * weight;
+}
+
+static void catmull_rom_weights(float f, float w[4])
+{
+	w[0] = f * (-0.5f + f * (1.0f - 0.5f * f));
+	w[1] = 1.0f + f * f * (-2.5f + 1.5f * f);
+	w[2] = f * (0.5f + f * (2.0f - 1.5f * f));
+	w[3] = f * f * (-0.5f + 0.5f * f);
+}
+
+/* sampleImage() of each QUALITY_* variant.  Bicubic is evaluated with all
+ * sixteen texel fetches rather than the shader's nine folded bilinear taps;
+ * the two are equal up to filtering precision. */
+static void sample_quality(const struct ref_image *img,
+			   enum ref_quality quality, float u, float v,
+			   float out[4])
+{
+	float tw = 1.0f / (float)img->width;
+	float th = 1.0f / (float)img->height;
+	float c[4];
+
+	memset(out, 0, sizeof(float) * 4);
+
+	switch (quality) {
+	case REF_QUALITY_SINGLE:
+		sample(img, false, u, v, out);
+		break;
+
+	case REF_QUALITY_RGSS: {
+		static const float offsets[4][2] = {{0.125f, 0.375f},
+						    {0.375f, -0.125f},
+						    {-0.125f, -0.375f},
+						    {-0.375f, 0.125f}};
+
+		for (int i = 0; i < 4; i++) {
+			sample(img, false, u + offsets[i][0] * tw,
+			       v + offsets[i][1] * th, c);
+			accumulate(out, c, 0.25f);
+		}
+		break;
+	}
+
+	case REF_QUALITY_9TAP:
+		for (int y = -1; y <= 1; y++) {
+			for (int x = -1; x <= 1; x++) {
+				sample(img, false, u + x * (tw / 2),
+				       v + y * (th / 2), c);
+				accumulate(out, c, 1.0f / 9.0f);
+			}
+		}
+		break;
+
+	case REF_QUALITY_BICUBIC: {
+		float px = u * (float)img->width - 0.5f;
+		float py = v * (float)img->height - 0.5f;
+
+		if (!(fabsf(px) < 1e7f && fabsf(py) < 1e7f))
+			break;
+
+		float bx = floorf(px);
+		float by = floorf(py);
+		float wx[4], wy[4];
+
+		catmull_rom_weights(px - bx, wx);
+		catmull_rom_weights(py - by, wy);
+
+		for (int y = 0; y < 4; y++) {
+			for (int x = 0; x < 4; x++) {
+				fetch(img, false, (int)bx + x - 1,
+				      (int)by + y - 1, c);
+				accumulate(out, c, wx[x] * wy[y]);
+			}
+		}
+		break;
+	}
+	}
+}
+
+/* ------------------------------------------------------------------------- */
+/* corner_pin_filter.effect                                                   */
+
+struct corner_geometry {
+	float uv[4][2];
+	float bounds[4];
+};
+
+static void corner_geometry_init(struct corner_geometry *g,
+				 const struct ref_corner_pin_params *params,
+				 const struct ref_image *src)
+{
+	const float(*uv)[2] = params->uv;
+	float tw = 1.0f / (float)src->width;
+	float th = 1.0f / (float)src->height;
+
+	memcpy(g->uv, params->uv, sizeof(g->uv));
+
+	g->bounds[0] = fminf(uv[0][0], fminf(uv[1][0], fminf(uv[2][0], uv[3][0])));
+	g->bounds[1] = fminf(uv[0][1], fminf(uv[1][1], fminf(uv[2][1], uv[3][1])));
+	g->bounds[2] = fmaxf(uv[0][0], fmaxf(uv[1][0], fmaxf(uv[2][0], uv[3][0])));
+	g->bounds[3] = fmaxf(uv[0][1], fmaxf(uv[1][1], fmaxf(uv[2][1], uv[3][1])));
+
+	g->bounds[0] -= tw;
+	g->bounds[1] -= th;
+	g->bounds[2] += tw;
+	g->bounds[3] += th;
+}
+
+static inline float cross2(float ax, float ay, float bx, float by)
+{
+	return ax * by - ay * bx;
+}
+
+static void inv_bilinear(const struct corner_geometry *g, float px, float py,
+			 float res[2])
+{
+	float t0 = g->uv[0][0] == 0.0f ? -0.001f : g->uv[0][0];
+	float t1 = g->uv[0][1];
+	float ex = g->uv[1][0] - t0, ey = g->uv[1][1] - t1;
+	float fx = g->uv[2][0] - t0, fy = g->uv[2][1] - t1;
+	float gx = t0 - g->uv[1][0] + g->uv[3][0] - g->uv[2][0];
+	float gy = t1 - g->uv[1][1] + g->uv[3][1] - g->uv[2][1];
+	float hx = px - t0, hy = py - t1;
+
+	float k2 = cross2(gx, gy, fx, fy);
+	float k1 = cross2(ex, ey, fx, fy) + cross2(hx, hy, gx, gy);
+	float k0 = cross2(hx, hy, ex, ey);
+
+	float w = k1 * k1 - 4.0f * k0 * k2;
+
+	res[0] = -1.0f;
+	res[1] = -1.0f;
+
+	if (w < 0.0f)
+		return;
+
+	w = sqrtf(w);
+
+	float v1 = (-k1 - w) / (2.0f * k2);
+	float v2 = (-k1 + w) / (2.0f * k2);
+	float u1 = (hx - fx * v1) / (ex + gx * v1);
+	float u2 = (hx - fx * v2) / (ex + gx * v2);
+	bool b1 = v1 > 0.0f && v1 < 1.0f && u1 > 0.0f && u1 < 1.0f;
+	bool b2 = v2 > 0.0f && v2 < 1.0f && u2 > 0.0f && u2 < 1.0f;
+
+	if (b1 && !b2) {
+		res[0] = u1;
+		res[1] = v1;
+	}
+	if (!b1 && b2) {
+		res[0] = u2;
+		res[1] = v2;
+	}
+}
+
+static inline bool in_bounds(const struct corner_geometry *g, float x, float y)
+{
+	return !(x < g->bounds[0] || x > g->bounds[2] || y < g->bounds[1] ||
+		 y > g->bounds[3]);
+}
+
+static void corner_pin_scalar(struct ref_image *dst,
+			      const struct ref_image *src,
+			      const struct corner_geometry *g,
+			      enum ref_quality quality)
+{
+	for (uint32_t y = 0; y < dst->height; y++) {
+		float v = ((float)y + 0.5f) / (float)dst->height;
+
+		for (uint32_t x = 0; x < dst->width; x++) {
+			float u = ((float)x + 0.5f) / (float)dst->width;
+			float *out = ref_image_pixel(dst, x, y);
+			float vert[2];
+
+			if (!in_bounds(g, u, v)) {
+				memset(out, 0, sizeof(float) * 4);
+				continue;
+			}
+
+			inv_bilinear(g, u, v, vert);
+			sample_quality(src, quality, vert[0], vert[1], out);
+		}
+	}
+}
+
+#ifdef REF_HAVE_SSE2
+/* Bounds test and invBilinear for four horizontally adjacent pixels at a
+ * time; only the texture fetches stay scalar. */
+static void corner_pin_sse2(struct ref_image *dst, const struct ref_image *src,
+			    const struct corner_geometry *g,
+			    enum ref_quality quality)
+{
+	float t0 = g->uv[0][0] == 0.0f ? -0.001f : g->uv[0][0];
+	float t1 = g->uv[0][1];
+	float ex = g->uv[1][0] - t0, ey = g->uv[1][1] - t1;
+	float fx = g->uv[2][0] - t0, fy = g->uv[2][1] - t1;
+	float gx = t0 - g->uv[1][0] + g->uv[3][0] - g->uv[2][0];
+	float gy = t1 - g->uv[1][1] + g->uv[3][1] - g->uv[2][1];
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 minus_one = _mm_set1_ps(-1.0f);
+	const __m128 v_ex = _mm_set1_ps(ex), v_ey = _mm_set1_ps(ey);
+	const __m128 v_fx = _mm_set1_ps(fx);
+	const __m128 v_gx = _mm_set1_ps(gx), v_gy = _mm_set1_ps(gy);
+	const __m128 k2 = _mm_set1_ps(cross2(gx, gy, fx, fy));
+	const __m128 two_k2 = _mm_mul_ps(_mm_set1_ps(2.0f), k2);
+	const __m128 four_k2 = _mm_mul_ps(_mm_set1_ps(4.0f), k2);
+	const __m128 cross_ef = _mm_set1_ps(cross2(ex, ey, fx, fy));
+	const __m128 min_x = _mm_set1_ps(g->bounds[0]);
+	const __m128 max_x = _mm_set1_ps(g->bounds[2]);
+	const float inv_w = 1.0f / (float)dst->width;
+
+	for (uint32_t y = 0; y < dst->height; y++) {
+		float v = ((float)y + 0.5f) / (float)dst->height;
+		bool row_in = v >= g->bounds[1] && v <= g->bounds[3];
+		__m128 hy = _mm_set1_ps(v - t1);
+
+		for (uint32_t x = 0; x < dst->width; x += 4) {
+			__m128 u = _mm_mul_ps(
+				_mm_add_ps(_mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f),
+					   _mm_set1_ps((float)x)),
+				_mm_set1_ps(inv_w));
+			__m128 hx = _mm_sub_ps(u, _mm_set1_ps(t0));
+
+			__m128 k1 = _mm_add_ps(
+				cross_ef, _mm_sub_ps(_mm_mul_ps(hx, v_gy),
+						     _mm_mul_ps(hy, v_gx)));
+			__m128 k0 = _mm_sub_ps(_mm_mul_ps(hx, v_ey),
+					       _mm_mul_ps(hy, v_ex));
+			__m128 w = _mm_sub_ps(_mm_mul_ps(k1, k1),
+					      _mm_mul_ps(four_k2, k0));
+			__m128 valid = _mm_cmpge_ps(w, zero);
+			w = _mm_sqrt_ps(_mm_max_ps(w, zero));
+
+			__m128 neg_k1 = _mm_sub_ps(zero, k1);
+			__m128 v1 = _mm_div_ps(_mm_sub_ps(neg_k1, w), two_k2);
+			__m128 v2 = _mm_div_ps(_mm_add_ps(neg_k1, w), two_k2);
+			__m128 u1 = _mm_div_ps(
+				_mm_sub_ps(hx, _mm_mul_ps(v_fx, v1)),
+				_mm_add_ps(v_ex, _mm_mul_ps(v_gx, v1)));
+			__m128 u2 = _mm_div_ps(
+				_mm_sub_ps(hx, _mm_mul_ps(v_fx, v2)),
+				_mm_add_ps(v_ex, _mm_mul_ps(v_gx, v2)));
+
+			__m128 b1 = _mm_and_ps(
+				_mm_and_ps(_mm_cmpgt_ps(v1, zero),
+					   _mm_cmplt_ps(v1, one)),
+				_mm_and_ps(_mm_cmpgt_ps(u1, zero),
+					   _mm_cmplt_ps(u1, one)));
+			__m128 b2 = _mm_and_ps(
+				_mm_and_ps(_mm_cmpgt_ps(v2, zero),
+					   _mm_cmplt_ps(v2, one)),
+				_mm_and_ps(_mm_cmpgt_ps(u2, zero),
+					   _mm_cmplt_ps(u2, one)));
+			__m128 pick1 = _mm_and_ps(valid, _mm_andnot_ps(b2, b1));
+			__m128 pick2 = _mm_and_ps(valid, _mm_andnot_ps(b1, b2));
+			__m128 none = _mm_andnot_ps(_mm_or_ps(pick1, pick2),
+						    _mm_castsi128_ps(
+							    _mm_set1_epi32(-1)));
+
+			__m128 res_u = _mm_or_ps(
+				_mm_or_ps(_mm_and_ps(pick1, u1),
+					  _mm_and_ps(pick2, u2)),
+				_mm_and_ps(none, minus_one));
+			__m128 res_v = _mm_or_ps(
+				_mm_or_ps(_mm_and_ps(pick1, v1),
+					  _mm_and_ps(pick2, v2)),
+				_mm_and_ps(none, minus_one));
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(u, min_x),
+						   _mm_cmple_ps(u, max_x));
+
+			float lane_u[4], lane_v[4];
+			int lane_in = row_in ? _mm_movemask_ps(inside) : 0;
+
+			_mm_storeu_ps(lane_u, res_u);
+			_mm_storeu_ps(lane_v, res_v);
+
+			for (uint32_t i = 0; i < 4 && x + i < dst->width; i++) {
+				float *out = ref_image_pixel(dst, x + i, y);
+
+				if (lane_in & (1 << i))
+					sample_quality(src, quality, lane_u[i],
+						       lane_v[i], out);
+				else
+					memset(out, 0, sizeof(float) * 4);
+			}
+		}
+	}
+}
+#endif
+
+bool ref_corner_pin(struct ref_image *dst, const struct ref_image *src,
+		    const struct ref_corner_pin_params *params,
+		    enum ref_path path)
+{
+	struct corner_geometry g;
+
+	if (!same_size(dst, src))
+		return false;
+
+	corner_geometry_init(&g, params, src);
+
+#ifdef REF_HAVE_SSE2
+	if (path == REF_PATH_SSE2) {
+		corner_pin_sse2(dst, src, &g, params->quality);
+		return true;
+	}
+#endif
+
+	corner_pin_scalar(dst, src, &g, params->quality);
+	UNUSED_PATH(path);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* lens_distortion_filter.effect                                              */
+
+static inline float sign(float v)
+{
+	return v > 0.0f ? 1.0f : (v < 0.0f ? -1.0f : 0.0f);
+}
+
+bool ref_lens_distortion(struct ref_image *dst, const struct ref_image *src,
+			 const struct ref_lens_distortion_params *params)
+{
+	if (!same_size(dst, src))
+		return false;
+
+	/* texwidth and texheight are int uniforms, so the shader's ratio is
+	 * an integer division */
+	float ratio = (float)((int)src->width / (int)src->height);
+	float zoom = powf(params->zoom, 50.0f);
+
+	for (uint32_t y = 0; y < dst->height; y++) {
+		float v = ((float)y + 0.5f) / (float)dst->height;
+
+		for (uint32_t x = 0; x < dst->width; x++) {
+			float u = ((float)x + 0.5f) / (float)dst->width;
+			float offset_x, offset_y;
+
+			if (params->horizontal) {
+				offset_x = (u - 0.5f) / ratio;
+				offset_y = v - 0.5f;
+			} else {
+				offset_x = u - 0.5f;
+				offset_y = (v - 0.5f) / ratio;
+			}
+
+			float distance = powf(powf(offset_x, 2.0f) +
+						      powf(offset_y, 2.0f),
+					      1.0f / 2.0f);
+			float angle = asinf(offset_y / distance);
+			distance = powf(powf(distance, 1.0f / 50.0f) +
+						(params->strength / 100.0f),
+					50.0f) /
+				   zoom;
+
+			float new_x = sign(offset_x) * cosf(angle) * distance +
+				      0.5f;
+			float new_y = sinf(angle) * distance + 0.5f;
+
+			sample_quality(src, params->quality, new_x, new_y,
+				       ref_image_pixel(dst, x, y));
+		}
+	}
+
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* stroke_filter.effect                                                       */
+
+/* Every pass renders into a GS_RGBA target */
+static inline float unorm8(float v)
+{
+	v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	return floorf(v * 255.0f + 0.5f) / 255.0f;
+}
+
+static inline void stroke_combine(float *out, const float over[4], float a,
+				  const float color[4])
+{
+	float c[4] = {color[0], color[1], color[2], a};
+
+	for (int i = 0; i < 4; i++)
+		out[i] = unorm8(over[i] * over[3] + c[i] * (1.0f - over[3]));
+}
+
+static void stroke_pass_scalar(struct ref_image *dst,
+			       const struct ref_image *src,
+			       const float color[4])
+{
+	float tw = 1.0f / (float)src->width;
+	float th = 1.0f / (float)src->height;
+
+	for (uint32_t y = 0; y < dst->height; y++) {
+		float v = ((float)y + 0.5f) / (float)dst->height;
+
+		for (uint32_t x = 0; x < dst->width; x++) {
+			float u = ((float)x + 0.5f) / (float)dst->width;
+			float over[4], c[4];
+			float a = 0.0f;
+
+			sample(src, true, u, v, over);
+
+			for (int ox = -1; ox < 2; ox++) {
+				for (int oy = -1; oy < 2; oy++) {
+					if (ox == 0 && oy == 0)
+						continue;
+
+					sample(src, true, u + ox * tw,
+					       v + oy * th, c);
+					a = fmaxf(a, powf(c[3], 0.2f));
+				}
+			}
+
+			stroke_combine(ref_image_pixel(dst, x, y), over, a,
+				       color);
+		}
+	}
+}
+
+#ifdef REF_HAVE_SSE2
+/* The neighbour taps land exactly on texel centers, so each pass is a 3x3
+ * max over the alpha plane.  pow() is monotonic, which lets it be applied
+ * once to the maximum instead of to every tap. */
+static void stroke_pass_sse2(struct ref_image *dst, const struct ref_image *src,
+			     const float color[4], float *alpha, float *row)
+{
+	const uint32_t w = src->width, h = src->height;
+	const size_t pitch = (size_t)w + 2 + 3;
+
+	for (uint32_t y = 0; y < h + 2; y++) {
+		uint32_t sy = y == 0 ? 0 : (y > h ? h - 1 : y - 1);
+		float *line = alpha + y * pitch;
+
+		for (uint32_t x = 0; x < pitch; x++) {
+			uint32_t sx = x == 0 ? 0 : (x > w ? w - 1 : x - 1);
+			line[x] = ref_image_pixel(src, sx, sy)[3];
+		}
+	}
+
+	const __m128 v_color = _mm_setr_ps(color[0], color[1], color[2], 1.0f);
+	const __m128 v_one = _mm_set1_ps(1.0f);
+
+	for (uint32_t y = 0; y < h; y++) {
+		const float *top = alpha + y * pitch;
+		const float *mid = top + pitch;
+		const float *bot = mid + pitch;
+
+		for (uint32_t x = 0; x < w; x += 4) {
+			__m128 m = _mm_max_ps(_mm_loadu_ps(top + x),
+					      _mm_loadu_ps(top + x + 1));
+			m = _mm_max_ps(m, _mm_loadu_ps(top + x + 2));
+			m = _mm_max_ps(m, _mm_loadu_ps(mid + x));
+			m = _mm_max_ps(m, _mm_loadu_ps(mid + x + 2));
+			m = _mm_max_ps(m, _mm_loadu_ps(bot + x));
+			m = _mm_max_ps(m, _mm_loadu_ps(bot + x + 1));
+			m = _mm_max_ps(m, _mm_loadu_ps(bot + x + 2));
+			_mm_storeu_ps(row + x, m);
+		}
+
+		for (uint32_t x = 0; x < w; x++) {
+			const float *over = ref_image_pixel(src, x, y);
+			float *out = ref_image_pixel(dst, x, y);
+			float a = powf(row[x], 0.2f);
+
+			__m128 v_over = _mm_loadu_ps(over);
+			__m128 v_oa = _mm_set1_ps(over[3]);
+			__m128 c = _mm_mul_ps(v_color,
+					      _mm_setr_ps(1.0f, 1.0f, 1.0f, a));
+			__m128 r = _mm_add_ps(
+				_mm_mul_ps(v_over, v_oa),
+				_mm_mul_ps(c, _mm_sub_ps(v_one, v_oa)));
+
+			_mm_storeu_ps(out, r);
+			for (int i = 0; i < 4; i++)
+				out[i] = unorm8(out[i]);
+		}
+	}
+}
+#endif
+
+bool ref_stroke(struct ref_image *dst, const struct ref_image *src,
+		const struct ref_stroke_params *params, enum ref_path path)
+{
+	struct ref_image ping = {};
+
+	if (!same_size(dst, src))
+		return false;
+
+#ifdef REF_HAVE_SSE2
+	float *alpha = NULL, *row = NULL;
+	bool sse2 = false;
+
+	if (path == REF_PATH_SSE2) {
+		alpha = (float *)malloc(sizeof(float) * (src->width + 5) *
+					(src->height + 2));
+		row = (float *)malloc(sizeof(float) * (src->width + 3));
+		sse2 = alpha && row;
+	}
+#endif
+
+	/* Like the filter: every pass reads the previous pass' output */
+	memcpy(dst->data, src->data,
+	       sizeof(float) * 4 * (size_t)src->width * src->height);
+
+	bool success = params->width == 0 ||
+		       ref_image_init(&ping, src->width, src->height);
+
+	for (uint32_t i = 0; success && i < params->width; i++) {
+		memcpy(ping.data, dst->data,
+		       sizeof(float) * 4 * (size_t)src->width * src->height);
+
+#ifdef REF_HAVE_SSE2
+		if (sse2) {
+			stroke_pass_sse2(dst, &ping, params->color, alpha,
+					 row);
+			continue;
+		}
+#endif
+		stroke_pass_scalar(dst, &ping, params->color);
+	}
+
+#ifdef REF_HAVE_SSE2
+	free(alpha);
+	free(row);
+#endif
+	ref_image_free(&ping);
+	UNUSED_PATH(path);
+	return success;
+}
+
+/* ------------------------------------------------------------------------- */
+
+bool ref_image_compare(const struct ref_image *expected,
+		       const struct ref_image *actual, float tolerance,
+		       double max_fraction, struct ref_diff *diff)
+{
+	struct ref_diff result = {};
+	double total = 0.0;
+
+	if (!same_size(expected, actual)) {
+		if (diff)
+			*diff = result;
+		return false;
+	}
+
+	size_t channels = (size_t)expected->width * expected->height * 4;
+
+	for (size_t i = 0; i < channels; i++) {
+		float error = fabsf(expected->data[i] - actual->data[i]);
+
+		/* A NaN on either side never matches */
+		if (error != error)
+			error = INFINITY;
+
+		total += error;
+
+		if (error > tolerance)
+			result.over_tolerance++;
+		if (error > result.max_error) {
+			result.max_error = error;
+			result.worst_x = (uint32_t)(i / 4 % expected->width);
+			result.worst_y = (uint32_t)(i / 4 / expected->width);
+		}
+	}
+
+	result.mean_error = channels ? total / (double)channels : 0.0;
+
+	if (diff)
+		*diff = result;
+
+	return channels == 0 ||
+	       (double)result.over_tolerance <= max_fraction * (double)channels;
+}
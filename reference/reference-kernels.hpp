@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* CPU reference implementations of the pixel shaders in data/, used as a
+ * correctness oracle for optimized versions of the effects.  Nothing here
+ * depends on libobs or a GPU.
+ *
+ * Each kernel follows its shader line for line and emulates the sampler
+ * state it uses (bilinear filtering at texel centers, with border or clamp
+ * addressing).  The OUTLINE debug overlay, the corner pin's EDGE_AA
+ * variant and the fused corner pin / lens distortion variants are not
+ * modelled. */
+
+/* Four floats per pixel (RGBA), rows packed with no padding. */
+struct ref_image {
+	uint32_t width;
+	uint32_t height;
+	float *data;
+};
+
+bool ref_image_init(struct ref_image *img, uint32_t width, uint32_t height);
+void ref_image_free(struct ref_image *img);
+
+static inline float *ref_image_pixel(const struct ref_image *img, uint32_t x,
+				     uint32_t y)
+{
+	return img->data + ((size_t)y * img->width + x) * 4;
+}
+
+/* Same order as enum filter_quality in filter-pack.hpp */
+enum ref_quality {
+	REF_QUALITY_SINGLE,
+	REF_QUALITY_RGSS,
+	REF_QUALITY_9TAP,
+	REF_QUALITY_BICUBIC,
+};
+
+/* Scalar kernels transcribe the shaders literally.  The SSE2 paths
+ * restructure the math (vectorized across a row) and are expected to agree
+ * with them to within float rounding; lens distortion only has a scalar
+ * path, being dominated by transcendentals.  Requesting a path the build
+ * does not support falls back to the scalar one. */
+enum ref_path {
+	REF_PATH_SCALAR,
+	REF_PATH_SSE2,
+};
+
+bool ref_path_supported(enum ref_path path);
+
+struct ref_corner_pin_params {
+	float uv[4][2]; /* top left, top right, bottom left, bottom right */
+	enum ref_quality quality;
+};
+
+struct ref_lens_distortion_params {
+	float strength;
+	float zoom;
+	bool horizontal;
+	enum ref_quality quality;
+};
+
+struct ref_stroke_params {
+	float color[4];
+	uint32_t width;
+};
+
+/* `dst` must already be allocated with the size of `src`. */
+bool ref_corner_pin(struct ref_image *dst, const struct ref_image *src,
+		    const struct ref_corner_pin_params *params,
+		    enum ref_path path);
+bool ref_lens_distortion(struct ref_image *dst, const struct ref_image *src,
+			 const struct ref_lens_distortion_params *params);
+bool ref_stroke(struct ref_image *dst, const struct ref_image *src,
+		const struct ref_stroke_params *params, enum ref_path path);
+
+struct ref_diff {
+	float max_error;
+	double mean_error;
+	uint64_t over_tolerance;
+	uint32_t worst_x;
+	uint32_t worst_y;
+};
+
+/* Compares two images channel by channel.  The images match when no more
+ * than `max_fraction` of all channels differ by more than `tolerance`,
+ * which leaves room for the reduced filtering precision of real GPUs. */
+bool ref_image_compare(const struct ref_image *expected,
+		       const struct ref_image *actual, float tolerance,
+		       double max_fraction, struct ref_diff *diff);
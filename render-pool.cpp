@@ -0,0 +1,175 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <mutex>
+#include "render-pool.hpp"
+
+struct pooled_target {
+	gs_texrender_t *render;
+	enum gs_color_format format;
+	uint32_t cx, cy;
+	uint64_t last_used;
+	bool leased;
+
+	enum vram_type type;
+	struct vram_stats *owner;
+};
+
+static std::mutex refs_mutex;
+static long refs = 0;
+static uint64_t last_trim = 0;
+
+static DARRAY(struct pooled_target) targets;
+
+static int64_t target_bytes(const struct pooled_target *target)
+{
+	return vram_texture_bytes(target->format, target->cx, target->cy);
+}
+
+static void destroy_target(struct pooled_target *target)
+{
+	vram_stats_add(vram_stats_type(target->type), target->owner,
+		       -target_bytes(target), false);
+	gs_texrender_destroy(target->render);
+}
+
+static void set_owner(struct pooled_target *target,
+		      struct filter_stats *stats)
+{
+	if (target->owner == &stats->vram)
+		return;
+
+	int64_t bytes = target_bytes(target);
+
+	vram_stats_add(vram_stats_type(target->type), target->owner, -bytes,
+		       false);
+	vram_stats_add(vram_stats_type(stats->vram_type), &stats->vram, bytes,
+		       false);
+	target->type = stats->vram_type;
+	target->owner = &stats->vram;
+}
+
+static void trim(uint64_t now)
+{
+	const uint64_t idle = RENDER_POOL_IDLE_SECONDS * 1000000000ULL;
+
+	for (size_t i = targets.num; i > 0; i--) {
+		struct pooled_target *target = &targets.array[i - 1];
+
+		if (!target->leased && now - target->last_used > idle) {
+			destroy_target(target);
+			da_erase(targets, i - 1);
+		}
+	}
+}
+
+/* Runs every frame whether or not any filter renders, so that targets
+ * left behind by filters that went idle or hidden are freed too */
+static void pool_tick(void *param, float seconds)
+{
+	uint64_t now = os_gettime_ns();
+
+	if (now - last_trim < 1000000000ULL)
+		return;
+	last_trim = now;
+
+	obs_enter_graphics();
+	trim(now);
+	obs_leave_graphics();
+
+	UNUSED_PARAMETER(param);
+	UNUSED_PARAMETER(seconds);
+}
+
+void render_pool_acquire(void)
+{
+	std::lock_guard<std::mutex> lock(refs_mutex);
+
+	if (refs++ == 0) {
+		da_init(targets);
+		obs_add_tick_callback(pool_tick, NULL);
+	}
+}
+
+void render_pool_release(struct filter_stats *stats)
+{
+	std::lock_guard<std::mutex> lock(refs_mutex);
+
+	/* Not from inside the graphics context, which the tick would be
+	 * waiting for */
+	if (refs == 1)
+		obs_remove_tick_callback(pool_tick, NULL);
+
+	obs_enter_graphics();
+
+	/* The instance's counters are about to be freed */
+	for (size_t i = 0; i < targets.num; i++) {
+		if (targets.array[i].owner == &stats->vram)
+			targets.array[i].owner = NULL;
+	}
+
+	if (--refs) {
+		obs_leave_graphics();
+		return;
+	}
+
+	for (size_t i = 0; i < targets.num; i++)
+		destroy_target(&targets.array[i]);
+	obs_leave_graphics();
+
+	da_free(targets);
+}
+
+gs_texrender_t *render_pool_lease(enum gs_color_format format, uint32_t cx,
+				  uint32_t cy, struct filter_stats *stats)
+{
+	uint64_t now = os_gettime_ns();
+
+	for (size_t i = 0; i < targets.num; i++) {
+		struct pooled_target *target = &targets.array[i];
+
+		if (!target->leased && target->format == format &&
+		    target->cx == cx && target->cy == cy) {
+			target->leased = true;
+			target->last_used = now;
+			set_owner(target, stats);
+			return target->render;
+		}
+	}
+
+	gs_texrender_t *render = gs_texrender_create(format, GS_ZS_NONE);
+	if (!render)
+		return NULL;
+
+	struct pooled_target *target =
+		(struct pooled_target *)da_push_back_new(targets);
+	target->render = render;
+	target->format = format;
+	target->cx = cx;
+	target->cy = cy;
+	target->last_used = now;
+	target->leased = true;
+	target->type = stats->vram_type;
+	target->owner = &stats->vram;
+
+	vram_stats_add(vram_stats_type(target->type), target->owner,
+		       target_bytes(target), true);
+	filter_stats_alloc(stats);
+	return render;
+}
+
+void render_pool_return(gs_texrender_t *render)
+{
+	if (!render)
+		return;
+
+	for (size_t i = 0; i < targets.num; i++) {
+		struct pooled_target *target = &targets.array[i];
+
+		if (target->render == render) {
+			target->leased = false;
+			target->last_used = os_gettime_ns();
+			return;
+		}
+	}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <obs-module.h>
+#include "filter-pack.hpp"
+
+/* Seconds an idle render target is kept before it is destroyed.  Idle
+ * targets are checked for about once a second from a tick callback. */
+#define RENDER_POOL_IDLE_SECONDS 2
+
+/* Module-wide pool of render targets shared by every filter instance.
+ * Targets are leased for the duration of a render callback and returned
+ * before it ends, so VRAM follows the largest number of targets of one
+ * size in use at the same time rather than the number of instances.
+ *
+ * A target's VRAM is charged to the instance (and filter type) that last
+ * leased it, and a lease that has to create one counts as an allocation
+ * for that instance.
+ *
+ * Instances hold a reference from create to destroy; the pool is emptied
+ * when the last one goes away.  Leasing and returning happen on the
+ * graphics thread only. */
+void render_pool_acquire(void);
+void render_pool_release(struct filter_stats *stats);
+
+gs_texrender_t *render_pool_lease(enum gs_color_format format, uint32_t cx,
+				  uint32_t cy, struct filter_stats *stats);
+void render_pool_return(gs_texrender_t *render);
@@ -1,20 +1,83 @@
 #include <obs-module.h>
 #include <graphics/vec4.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include "effect-variants.hpp"
+#include "filter-cache.hpp"
+#include "filter-pack.hpp"
+#include "frame-capture.hpp"
+#include "gpu-timer.hpp"
+#include "keyframes.hpp"
+#include "render-pool.hpp"
+#include "stroke_filter.effect.h"
+
+enum stroke_param {
+	PARAM_COLOR,
+	PARAM_TEXWIDTH,
+	PARAM_TEXHEIGHT,
+	PARAM_IMAGE,
+	NUM_PARAMS,
+};
 
-struct stroke_data {
-	obs_source_t *context;
-	gs_effect_t *effect;
-	gs_eparam_t *color_param;
-	gs_eparam_t *width, *height;
-	gs_eparam_t *image;
+static const char *const stroke_params[NUM_PARAMS] = {
+	"color",
+	"texwidth",
+	"texheight",
+	"image",
+};
 
-	gs_texrender_t *render;
+static struct effect_variants variants =
+	EFFECT_VARIANTS("stroke_filter.effect", stroke_filter_effect, NULL, 0,
+			stroke_params, NUM_PARAMS);
 
+struct stroke_params {
 	uint32_t stroke_width;
 	vec4 color;
 	vec4 color_srgb;
+	bool adaptive;
+	bool cache;
+	bool identity;
+};
+
+struct stroke_data {
+	obs_source_t *context;
+
+	struct filter_params_lock params_lock;
+	struct stroke_params params;
+	struct keyframe_anim anim;
+
+	struct filter_bypass bypass;
+	struct filter_cache cache;
+	struct frame_capture capture;
+	struct filter_stats stats;
+	struct gpu_timer gpu_timer;
+};
+
+/* Settings that keyframes can animate, in keyframe_anim order */
+enum stroke_animated {
+	ANIMATED_WIDTH,
+	NUM_ANIMATED,
 };
 
+static const char *const stroke_animated[NUM_ANIMATED] = {
+	"width",
+};
+
+/* The blend changes every pixel whatever the stroke color, so only a
+ * stroke with no width at all leaves the source untouched */
+static void apply_animation(struct stroke_params *params,
+			    struct keyframe_anim *anim)
+{
+	double width;
+
+	if (keyframe_anim_get(anim, ANIMATED_WIDTH, &width))
+		params->stroke_width =
+			width > 0.0 ? (uint32_t)lround(width) : 0;
+
+	params->identity = params->stroke_width == 0;
+}
+
 static const char *stroke_getname(void *unused)
 {
 	UNUSED_PARAMETER(unused);
@@ -23,143 +86,167 @@ static const char *stroke_getname(void *unused)
 
 static void stroke_update(void *data, obs_data_t *settings)
 {
+	filter_profile_scope scope("stroke_update");
+
 	struct stroke_data *filter = (stroke_data *)data;
+	struct stroke_params params = {0};
 
-	filter->stroke_width = (uint32_t)obs_data_get_int(settings, "width");
+	params.stroke_width = (uint32_t)obs_data_get_int(settings, "width");
 
 	uint32_t color = (uint32_t)obs_data_get_int(settings, "color");
 
-	vec4_from_rgba(&filter->color, color);
+	vec4_from_rgba(&params.color, color);
 #ifdef sRGB_SUPPORT
-	vec4_from_rgba_srgb(&filter->color_srgb, color);
+	vec4_from_rgba_srgb(&params.color_srgb, color);
 #endif
+
+	params.adaptive = filter_adaptive_get(settings);
+	params.cache = filter_cache_get(settings);
+
+	filter_stats_update(&filter->stats, settings);
+	keyframe_anim_update(&filter->anim, settings);
+
+	filter_params_write_begin(&filter->params_lock);
+	filter->params = params;
+	apply_animation(&filter->params, &filter->anim);
+	filter_params_write_end(&filter->params_lock);
 }
 
 static void stroke_destroy(void *data)
 {
+	filter_profile_scope scope("stroke_destroy");
+
 	struct stroke_data *filter = (stroke_data *)data;
 
-	if (filter->effect) {
-		obs_enter_graphics();
-		gs_effect_destroy(filter->effect);
-		gs_texrender_destroy(filter->render);
-		obs_leave_graphics();
-	}
+	effect_variants_release(&variants);
+	filter_cache_release(&filter->stats);
+	render_pool_release(&filter->stats);
+
+	obs_enter_graphics();
+	filter_cache_free(&filter->cache, &filter->stats);
+	frame_capture_free(&filter->capture, &filter->stats);
+	gpu_timer_free(&filter->gpu_timer);
+	obs_leave_graphics();
 
+	keyframe_anim_free(&filter->anim);
+	filter_params_lock_free(&filter->params_lock);
 	bfree(data);
 }
 
 static void *stroke_create(obs_data_t *settings, obs_source_t *context)
 {
+	filter_profile_scope scope("stroke_create");
+
 	struct stroke_data *filter =
 		(stroke_data *)bzalloc(sizeof(struct stroke_data));
-	char *effect_path = obs_module_file("stroke_filter.effect");
 
 	filter->context = context;
+	filter_params_lock_init(&filter->params_lock);
+	keyframe_anim_init(&filter->anim, stroke_animated, NUM_ANIMATED);
+	filter_stats_init(&filter->stats, context, VRAM_STROKE);
+	gpu_timer_init(&filter->gpu_timer, context);
+	frame_capture_init(&filter->capture, context);
 
-	obs_enter_graphics();
-
-	filter->effect = gs_effect_create_from_file(effect_path, NULL);
-
-	if (filter->effect) {
-		filter->color_param =
-			gs_effect_get_param_by_name(filter->effect, "color");
-		filter->width =
-			gs_effect_get_param_by_name(filter->effect, "texwidth");
-		filter->height = gs_effect_get_param_by_name(filter->effect,
-							     "texheight");
-		filter->image =
-			gs_effect_get_param_by_name(filter->effect, "image");
-	}
-
-	filter->render = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-
-	obs_leave_graphics();
-
-	bfree(effect_path);
-
-	if (!filter->effect) {
-		stroke_destroy(filter);
-		return NULL;
-	}
+	effect_variants_acquire(&variants);
+	render_pool_acquire();
+	filter_cache_acquire();
 
 	stroke_update(filter, settings);
 	return filter;
 }
 
-static void stroke_render(void *data, gs_effect_t *effect)
+static struct obs_source_frame *
+stroke_filter_video(void *data, struct obs_source_frame *frame)
 {
 	struct stroke_data *filter = (stroke_data *)data;
+	return filter_cache_video(&filter->cache, frame);
+}
 
-	obs_source_t *target = obs_filter_get_target(filter->context);
-	obs_source_t *parent = obs_filter_get_parent(filter->context);
+static void stroke_tick(void *data, float seconds)
+{
+	filter_profile_scope scope("stroke_tick");
 
-	uint32_t cx = obs_source_get_base_width(target);
-	uint32_t cy = obs_source_get_base_height(target);
+	struct stroke_data *filter = (stroke_data *)data;
+	struct stroke_params params;
 
-	if (!target || !parent) {
-		obs_source_skip_video_filter(filter->context);
-		return;
+	if (keyframe_anim_tick(&filter->anim, seconds)) {
+		filter_params_write_begin(&filter->params_lock);
+		apply_animation(&filter->params, &filter->anim);
+		filter_params_write_end(&filter->params_lock);
 	}
 
-	gs_texrender_reset(filter->render);
-
-	gs_blend_state_push();
-	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
-
-	if (gs_texrender_begin(filter->render, cx, cy)) {
-		uint32_t parent_flags = obs_source_get_output_flags(target);
+	filter_params_read(&filter->params_lock, &params, &filter->params,
+			   sizeof(params));
+	filter_bypass_set(&filter->bypass, filter->context, params.identity);
 
-		bool custom_draw = (parent_flags & OBS_SOURCE_CUSTOM_DRAW) != 0;
-		bool async = (parent_flags & OBS_SOURCE_ASYNC) != 0;
-		struct vec4 clear_color;
+	if (params.adaptive)
+		filter_pressure_tick(seconds);
 
-		vec4_zero(&clear_color);
-		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
-		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
-
-		if (target == parent && !custom_draw && !async)
-			obs_source_default_render(target);
-		else
-			obs_source_video_render(target);
+	filter_stats_tick(&filter->stats, filter->context, &filter->gpu_timer,
+			  seconds);
+}
 
-		gs_texrender_end(filter->render);
+static void draw_output(struct stroke_data *filter,
+			const struct effect_variant *variant,
+			const struct stroke_params *sp, uint32_t step,
+			obs_source_t *target, uint32_t cx, uint32_t cy)
+{
+	gs_eparam_t **params = variant->params;
+
+	/* Each dilation pass reads the previous one's target and writes the
+	 * other, so the two leases ping-pong without any copies. */
+	gs_texrender_t *src =
+		render_pool_lease(GS_RGBA, cx, cy, &filter->stats);
+	gs_texrender_t *dst =
+		render_pool_lease(GS_RGBA, cx, cy, &filter->stats);
+
+	if (!dst ||
+	    !filter_render_input(src, filter->context, target, cx, cy)) {
+		render_pool_return(src);
+		render_pool_return(dst);
+		return;
 	}
 
-	gs_blend_state_pop();
-
 #ifdef sRGB_SUPPORT
 	const bool linear_srgb = gs_get_linear_srgb() ||
-				 (filter->color.w < 1.0f);
+				 (sp->color.w < 1.0f);
 
 	const bool previous = gs_framebuffer_srgb_enabled();
 	gs_enable_framebuffer_srgb(linear_srgb);
 
 	if (linear_srgb) {
-		gs_effect_set_vec4(filter->color_param, &filter->color_srgb);
+		gs_effect_set_vec4(params[PARAM_COLOR], &sp->color_srgb);
 	} else {
 #endif
-		gs_effect_set_vec4(filter->color_param, &filter->color);
+		gs_effect_set_vec4(params[PARAM_COLOR], &sp->color);
 #ifdef sRGB_SUPPORT
 	}
 #endif
 
-	gs_effect_set_int(filter->height, cy);
-	gs_effect_set_int(filter->width, cx);
+	/* No width is normally bypassed, but can be drawn before the next
+	 * tick notices; the input then goes out unchanged */
+	uint32_t dilations =
+		sp->stroke_width
+			? std::max((sp->stroke_width + step / 2) / step, 1u)
+			: 0;
+
+	gs_effect_set_int(params[PARAM_TEXHEIGHT], std::max(cy / step, 1u));
+	gs_effect_set_int(params[PARAM_TEXWIDTH], std::max(cx / step, 1u));
 
 	size_t i = 0;
 
-	gs_texture_t *tex =
-		gs_texture_create(cx, cy, GS_RGBA, 1, NULL, GS_RENDER_TARGET);
-	gs_copy_texture(tex, gs_texrender_get_texture(filter->render));
+	gpu_timer_begin(&filter->gpu_timer);
 
-	for (i = 0; tex && i < filter->stroke_width; i++) {
-		gs_texrender_reset(filter->render);
+	for (i = 0; i < dilations; i++) {
+		size_t section = gpu_timer_section_begin(&filter->gpu_timer);
+		gs_texture_t *tex = gs_texrender_get_texture(src);
+
+		gs_texrender_reset(dst);
 
 		gs_blend_state_push();
 		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
 
-		if (gs_texrender_begin(filter->render, cx, cy)) {
+		if (gs_texrender_begin(dst, cx, cy)) {
 			struct vec4 clear_color;
 
 			vec4_zero(&clear_color);
@@ -169,16 +256,17 @@ static void stroke_render(void *data, gs_effect_t *effect)
 
 #ifdef sRGB_SUPPORT
 			if (linear_srgb) {
-				gs_effect_set_texture_srgb(filter->image, tex);
+				gs_effect_set_texture_srgb(params[PARAM_IMAGE],
+							   tex);
 			} else {
 #endif
-				gs_effect_set_texture(filter->image, tex);
+				gs_effect_set_texture(params[PARAM_IMAGE], tex);
 #ifdef sRGB_SUPPORT
 			}
 #endif
 
-			gs_technique_t *tech =
-				gs_effect_get_technique(filter->effect, "Draw");
+			gs_technique_t *tech = gs_effect_get_technique(
+				variant->effect, "Draw");
 			size_t passes, x;
 
 			passes = gs_technique_begin(tech);
@@ -191,48 +279,129 @@ static void stroke_render(void *data, gs_effect_t *effect)
 
 			gs_technique_end(tech);
 
-			gs_texrender_end(filter->render);
+			gs_texrender_end(dst);
 		}
 
 		gs_blend_state_pop();
 
-		gs_copy_texture(tex, gs_texrender_get_texture(filter->render));
+		gs_texrender_t *swap = src;
+		src = dst;
+		dst = swap;
+		gpu_timer_section_end(&filter->gpu_timer, section);
 	}
 
-	if (tex) {
-		effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	filter_stats_frame(&filter->stats, (long)i + 1);
+
+	gs_texture_t *tex = gs_texrender_get_texture(src);
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
 
-		gs_eparam_t *image =
-			gs_effect_get_param_by_name(effect, "image");
+	gs_eparam_t *image = gs_effect_get_param_by_name(effect, "image");
 
 #ifdef sRGB_SUPPORT
-		if (linear_srgb)
-			gs_effect_set_texture_srgb(image, tex);
-		else
+	if (linear_srgb)
+		gs_effect_set_texture_srgb(image, tex);
+	else
 #endif
-			gs_effect_set_texture(image, tex);
+		gs_effect_set_texture(image, tex);
 
-		while (gs_effect_loop(effect, "Draw"))
-			gs_draw_sprite(tex, 0, cx, cy);
+	while (gs_effect_loop(effect, "Draw"))
+		gs_draw_sprite(tex, 0, cx, cy);
 
-		gs_texture_destroy(tex);
-	}
+	gpu_timer_end(&filter->gpu_timer);
+
+	render_pool_return(src);
+	render_pool_return(dst);
 
 #ifdef sRGB_SUPPORT
 	gs_enable_framebuffer_srgb(previous);
 #endif
+}
+
+/* Everything the output depends on besides the input */
+struct stroke_cache_key {
+	struct stroke_params sp;
+	uint32_t step;
+};
+
+static void stroke_render(void *data, gs_effect_t *effect)
+{
+	filter_profile_scope scope("stroke_render");
+
+	struct stroke_data *filter = (stroke_data *)data;
+
+	if (!frame_capture_pending(&filter->capture) &&
+	    filter_bypass_render(&filter->bypass, &filter->stats,
+				 filter->context))
+		return;
+
+	struct stroke_params sp;
+	filter_params_read(&filter->params_lock, &sp, &filter->params,
+			   sizeof(sp));
+
+	const struct effect_variant *variant =
+		effect_variants_get(&variants, 0);
+
+	obs_source_t *target = obs_filter_get_target(filter->context);
+	obs_source_t *parent = obs_filter_get_parent(filter->context);
+
+	uint32_t cx = obs_source_get_base_width(target);
+	uint32_t cy = obs_source_get_base_height(target);
+
+	if (!target || !parent || !variant) {
+		obs_source_skip_video_filter(filter->context);
+		return;
+	}
+
+	/* Under pressure each pass reaches `step` texels out, so the same
+	 * width takes fewer passes at the cost of rougher corners */
+	uint32_t step = sp.adaptive ? 1u << filter_pressure_level() : 1;
+
+	/* One pass per texel of width at most, plus the final draw */
+	filter_stats_budget(&filter->stats, (long)sp.stroke_width + 1);
+
+	struct stroke_cache_key key;
+	memset(&key, 0, sizeof(key));
+	memcpy(&key.sp, &sp, sizeof(sp));
+	key.step = step;
+
+	/* Captured frames are always drawn for real */
+	bool capture = frame_capture_begin(&filter->capture, &filter->stats,
+					   cx, cy);
+
+	if (!capture &&
+	    filter_cache_draw(&filter->cache, &filter->stats, filter->context,
+			      &key, sizeof(key), cx, cy, sp.cache))
+		return;
+
+	bool cache = !capture && sp.cache &&
+		     filter_cache_capture_begin(&filter->cache, &filter->stats,
+						cx, cy);
+
+	draw_output(filter, variant, &sp, step, target, cx, cy);
+
+	if (capture)
+		frame_capture_end(&filter->capture);
+	if (cache)
+		filter_cache_capture_end(&filter->cache);
 
 	UNUSED_PARAMETER(effect);
 }
 
 static obs_properties_t *stroke_properties(void *data)
 {
+	filter_profile_scope scope("stroke_properties");
+
 	obs_properties_t *props = obs_properties_create();
 
-	obs_properties_add_int_slider(props, "width", "Stroke Width", 1, 50, 1);
+	obs_properties_add_int_slider(props, "width", "Stroke Width", 0, 50, 1);
 	obs_properties_add_color(props, "color", "Stroke Color");
+	filter_adaptive_add_property(props);
+	filter_cache_add_property(props);
+	keyframe_anim_add_property(props);
+	filter_stats_add_property(props);
 
-	UNUSED_PARAMETER(data);
+	struct stroke_data *filter = (stroke_data *)data;
+	gpu_timer_add_property(props, filter ? &filter->gpu_timer : NULL);
 	return props;
 }
 
@@ -240,9 +409,12 @@ static void stroke_defaults(obs_data_t *settings)
 {
 	obs_data_set_default_int(settings, "width", 1);
 	obs_data_set_default_int(settings, "color", 0xFFFFFFFF);
+	obs_data_set_default_bool(settings, "adaptive_quality", false);
+	obs_data_set_default_bool(settings, "cache_static", false);
+	obs_data_set_default_bool(settings, "keyframes_loop", false);
 }
 
-struct obs_source_info stroke_filter = [&] {
+struct obs_source_info stroke_filter = [] {
 	obs_source_info stroke_filter = {0};
 	stroke_filter.id = "stroke_filter";
 	stroke_filter.type = OBS_SOURCE_TYPE_FILTER;
@@ -251,6 +423,8 @@ struct obs_source_info stroke_filter = [&] {
 	stroke_filter.create = stroke_create;
 	stroke_filter.destroy = stroke_destroy;
 	stroke_filter.update = stroke_update;
+	stroke_filter.video_tick = stroke_tick;
+	stroke_filter.filter_video = stroke_filter_video;
 	stroke_filter.video_render = stroke_render;
 	stroke_filter.get_properties = stroke_properties;
 	stroke_filter.get_defaults = stroke_defaults;
@@ -0,0 +1,518 @@
+/* Per-frame call budgets of the filters, checked against the libobs stub in
+ * obs-stub/, which counts graphics calls instead of making them.  Every
+ * case builds a filter chain on a stub input, renders a few frames to let
+ * effects, pooled targets and bypass decisions settle, then counts the
+ * calls made over MEASURED_FRAMES more and compares them per frame
+ * against the case's budget.  Nothing here needs a GPU.
+ *
+ *   filter-pack-budget-tests [case prefix...]
+ *
+ * Budgets are exact: a change that adds a draw or a parameter upload to a
+ * filter's steady state should fail here and have its budget raised on
+ * purpose. */
+
+#include <obs-module.h>
+#include <stdio.h>
+#include <string.h>
+#include "obs-stub.hpp"
+#include "corner-pin-filter.hpp"
+#include "corner-pin-overlay.hpp"
+#include "uv-map-file.hpp"
+
+#define WARMUP_FRAMES 3
+#define MEASURED_FRAMES 10
+#define FRAME_SECONDS (1.0f / 30.0f)
+
+#define INPUT_CX 64
+#define INPUT_CY 48
+
+/* ------------------------------------------------------------------------- */
+/* Stand-ins for the parts of the plugin that need Qt                        */
+
+void corner_pin_editor_open(struct corner_pin_data *filter)
+{
+	UNUSED_PARAMETER(filter);
+}
+
+void corner_pin_editor_detach(struct corner_pin_data *filter)
+{
+	UNUSED_PARAMETER(filter);
+}
+
+void corner_pin_editor_free(void) {}
+
+bool uv_map_image_load(struct uv_map_image *image, const char *path)
+{
+	UNUSED_PARAMETER(image);
+	UNUSED_PARAMETER(path);
+	return false;
+}
+
+void uv_map_image_free(struct uv_map_image *image)
+{
+	memset(image, 0, sizeof(*image));
+}
+
+/* ------------------------------------------------------------------------- */
+/* Checks                                                                     */
+
+/* Calls one steady-state frame may make.  Everything not listed here
+ * (texture, target and buffer creation, copies, readbacks, effect
+ * compiles, warnings) must not happen at all. */
+struct frame_budget {
+	long draws;
+	long param_sets;
+	long texrender_begins;
+};
+
+static bool expect(const char *name, const char *what, long got, long want)
+{
+	if (got == want)
+		return true;
+
+	printf("FAIL %s: %s %ld, expected %ld\n", name, what, got, want);
+	return false;
+}
+
+static bool check_frames(const char *name, const struct frame_budget *budget,
+			 long frames)
+{
+	const struct obs_stub_calls *c = &obs_stub_calls;
+	bool ok = true;
+
+	ok &= expect(name, "draws", c->draws, budget->draws * frames);
+	ok &= expect(name, "parameter sets", c->param_sets,
+		     budget->param_sets * frames);
+	ok &= expect(name, "texrender begins", c->texrender_begins,
+		     budget->texrender_begins * frames);
+
+	ok &= expect(name, "texture creates", c->texture_creates, 0);
+	ok &= expect(name, "texrender creates", c->texrender_creates, 0);
+	ok &= expect(name, "stage surface creates", c->stagesurface_creates,
+		     0);
+	ok &= expect(name, "texture copies", c->texture_copies, 0);
+	ok &= expect(name, "texture maps", c->texture_maps, 0);
+	ok &= expect(name, "texture stages", c->texture_stages, 0);
+	ok &= expect(name, "vertex buffer creates", c->vertexbuffer_creates,
+		     0);
+	ok &= expect(name, "vertex buffer flushes", c->vertexbuffer_flushes,
+		     0);
+	ok &= expect(name, "effect creates", c->effect_creates, 0);
+	ok &= expect(name, "calls outside graphics", c->outside_graphics, 0);
+	ok &= expect(name, "warnings", c->warnings, 0);
+	return ok;
+}
+
+static long get_stat(obs_source_t *filter, const char *stat)
+{
+	calldata_t cd;
+	calldata_init(&cd);
+
+	proc_handler_call(obs_source_get_proc_handler(filter), "get_stats",
+			  &cd);
+	long value = (long)calldata_int(&cd, stat);
+
+	calldata_free(&cd);
+	return value;
+}
+
+static void run_frames(obs_source_t *input, long frames)
+{
+	for (long i = 0; i < frames; i++) {
+		obs_stub_tick(FRAME_SECONDS);
+		obs_stub_render(input);
+	}
+}
+
+/* Adds a filter on top of the input's chain; the input then owns it */
+static obs_source_t *add_filter(obs_source_t *input, const char *id,
+				obs_data_t *settings)
+{
+	obs_source_t *filter = obs_source_create_private(id, id, settings);
+	if (!filter)
+		return NULL;
+
+	obs_source_filter_add(input, filter);
+	obs_source_update(filter, settings);
+	obs_source_release(filter);
+	return filter;
+}
+
+static void set_corners(obs_data_t *settings, const int corners[8])
+{
+	static const char *const names[8] = {
+		"topLeftX",    "topLeftY",    "topRightX",    "topRightY",
+		"bottomLeftX", "bottomLeftY", "bottomRightX", "bottomRightY",
+	};
+
+	for (int i = 0; i < 8; i++)
+		obs_data_set_int(settings, names[i], corners[i]);
+}
+
+static const int skewed_corners[8] = {4, 2, 60, 0, 0, 48, 64, 44};
+static const int identity_corners[8] = {0, 0, 64, 0, 0, 48, 64, 48};
+
+/* ------------------------------------------------------------------------- */
+/* Cases                                                                      */
+
+/* One pass with the direct path: the input draws itself through the
+ * filter's effect, so the whole filter is six uniforms and one quad. */
+static bool corner_pin(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *settings = obs_data_create();
+
+	set_corners(settings, skewed_corners);
+	add_filter(input, "corner_pin_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {1, 6 + 1, 0};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+
+	obs_source_release(input);
+	return ok;
+}
+
+/* Corners on the source's own corners still move pixels at every tier,
+ * so the filter draws them rather than bypassing itself */
+static bool corner_pin_identity(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *settings = obs_data_create();
+
+	set_corners(settings, identity_corners);
+	obs_source_t *filter =
+		add_filter(input, "corner_pin_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	long bypasses = get_stat(filter, "bypasses");
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {1, 6 + 1, 0};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+	ok &= expect(name, "bypassed frames",
+		     get_stat(filter, "bypasses") - bypasses, 0);
+
+	obs_source_release(input);
+	return ok;
+}
+
+/* A corner pin over a lens distortion resamples the lens's input once
+ * through both mappings: one render of the input, one quad. */
+static bool corner_pin_fused(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *lens = obs_data_create();
+	obs_data_t *corner = obs_data_create();
+
+	obs_data_set_double(lens, "Strength", 20.0);
+	set_corners(corner, skewed_corners);
+	add_filter(input, "lens_distortion_filter", lens);
+	obs_source_t *filter = add_filter(input, "corner_pin_filter", corner);
+	obs_data_release(lens);
+	obs_data_release(corner);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	long allocations = get_stat(filter, "allocations");
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {2, 1 + 6 + 2 + 1, 1};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+	ok &= expect(name, "allocations",
+		     get_stat(filter, "allocations") - allocations, 0);
+
+	obs_source_release(input);
+	return ok;
+}
+
+static bool lens_distortion(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_double(settings, "Strength", 20.0);
+	add_filter(input, "lens_distortion_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {1, 4 + 1, 0};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+
+	obs_source_release(input);
+	return ok;
+}
+
+/* No strength and no zoom only leave sources under 2:1 unchanged, and
+ * only at the single tap and bicubic tiers; anything else still goes
+ * through the shader */
+static bool lens_distortion_identity(const char *name, uint32_t cx,
+				     uint32_t cy, enum filter_quality quality,
+				     bool identity)
+{
+	obs_source_t *input = obs_stub_input_create(name, cx, cy);
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_int(settings, "quality", quality);
+
+	obs_source_t *filter =
+		add_filter(input, "lens_distortion_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	long bypasses = get_stat(filter, "bypasses");
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {1, identity ? 1 : 4 + 1, 0};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+	ok &= expect(name, "bypassed frames",
+		     get_stat(filter, "bypasses") - bypasses,
+		     identity ? MEASURED_FRAMES : 0);
+
+	obs_source_release(input);
+	return ok;
+}
+
+static bool lens_distortion_square(const char *name)
+{
+	return lens_distortion_identity(name, INPUT_CY, INPUT_CY,
+					QUALITY_SINGLE, true);
+}
+
+static bool lens_distortion_square_bicubic(const char *name)
+{
+	return lens_distortion_identity(name, INPUT_CY, INPUT_CY,
+					QUALITY_BICUBIC, true);
+}
+
+static bool lens_distortion_square_9tap(const char *name)
+{
+	return lens_distortion_identity(name, INPUT_CY, INPUT_CY,
+					QUALITY_9TAP, false);
+}
+
+static bool lens_distortion_wide(const char *name)
+{
+	return lens_distortion_identity(name, INPUT_CY * 2, INPUT_CY,
+					QUALITY_SINGLE, false);
+}
+
+/* The mirror of corner_pin_fused, with the lens on top */
+static bool lens_distortion_fused(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *corner = obs_data_create();
+	obs_data_t *lens = obs_data_create();
+
+	set_corners(corner, skewed_corners);
+	obs_data_set_double(lens, "Strength", 20.0);
+	add_filter(input, "corner_pin_filter", corner);
+	add_filter(input, "lens_distortion_filter", lens);
+	obs_data_release(corner);
+	obs_data_release(lens);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {2, 1 + 4 + 4 + 1, 1};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+
+	obs_source_release(input);
+	return ok;
+}
+
+/* A stroke of width w renders its input once, dilates w times between two
+ * pooled targets and draws the result: w + 1 passes, w + 2 quads, and no
+ * allocation once the pool holds both targets. */
+static bool stroke_width(const char *name, long width)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_int(settings, "width", width);
+	obs_source_t *filter = add_filter(input, "stroke_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	long allocations = get_stat(filter, "allocations");
+	long passes = get_stat(filter, "passes");
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {width + 2, 1 + 3 + width + 1, width + 1};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+	ok &= expect(name, "allocations",
+		     get_stat(filter, "allocations") - allocations, 0);
+	ok &= expect(name, "passes", get_stat(filter, "passes") - passes,
+		     (width + 1) * MEASURED_FRAMES);
+
+	obs_source_release(input);
+	return ok;
+}
+
+static bool stroke(const char *name)
+{
+	return stroke_width(name, 1);
+}
+
+static bool stroke_wide(const char *name)
+{
+	return stroke_width(name, 6);
+}
+
+static bool stroke_none(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_int(settings, "width", 0);
+	add_filter(input, "stroke_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+	run_frames(input, MEASURED_FRAMES);
+
+	struct frame_budget budget = {1, 1, 0};
+	bool ok = check_frames(name, &budget, MEASURED_FRAMES);
+
+	obs_source_release(input);
+	return ok;
+}
+
+/* An input whose size changes every frame makes the stroke allocate every
+ * frame, which the budget check has to report, once. */
+static bool stroke_resized(const char *name)
+{
+	obs_source_t *input = obs_stub_input_create(name, INPUT_CX, INPUT_CY);
+	obs_data_t *settings = obs_data_create();
+
+	obs_data_set_int(settings, "width", 1);
+	add_filter(input, "stroke_filter", settings);
+	obs_data_release(settings);
+
+	run_frames(input, WARMUP_FRAMES);
+	obs_stub_reset_calls();
+
+	for (uint32_t i = 1; i <= FILTER_BUDGET_ALLOC_FRAMES * 2; i++) {
+		obs_stub_input_resize(input, INPUT_CX + i, INPUT_CY);
+		run_frames(input, 1);
+	}
+
+	bool ok = expect(name, "warnings", obs_stub_calls.warnings, 1);
+
+	obs_source_release(input);
+	return ok;
+}
+
+/* The editor's overlay is one buffer and one draw, rewritten only when a
+ * corner or the selection moves */
+static bool overlay(const char *name)
+{
+	struct corner_pin_overlay overlay = {};
+	int x[4] = {10, 200, 12, 190};
+	int y[4] = {8, 14, 150, 140};
+	bool ok = true;
+
+	obs_enter_graphics();
+
+	obs_stub_reset_calls();
+	corner_pin_overlay_draw(&overlay, x, y, 0);
+	ok &= expect(name, "first frame buffer creates",
+		     obs_stub_calls.vertexbuffer_creates, 1);
+	ok &= expect(name, "first frame buffer flushes",
+		     obs_stub_calls.vertexbuffer_flushes, 1);
+
+	obs_stub_reset_calls();
+	for (int i = 0; i < MEASURED_FRAMES; i++) {
+		overlay.draws = 0;
+		corner_pin_overlay_draw(&overlay, x, y, 0);
+		ok &= expect(name, "overlay draws", overlay.draws,
+			     CORNER_PIN_OVERLAY_DRAW_BUDGET);
+	}
+
+	struct frame_budget budget = {CORNER_PIN_OVERLAY_DRAW_BUDGET, 1, 0};
+	ok &= check_frames(name, &budget, MEASURED_FRAMES);
+
+	obs_stub_reset_calls();
+	x[1] += 3;
+	corner_pin_overlay_draw(&overlay, x, y, 0);
+	corner_pin_overlay_draw(&overlay, x, y, 2);
+	ok &= expect(name, "buffer flushes after moves",
+		     obs_stub_calls.vertexbuffer_flushes, 2);
+	ok &= expect(name, "buffer creates after moves",
+		     obs_stub_calls.vertexbuffer_creates, 0);
+
+	corner_pin_overlay_free(&overlay);
+	obs_leave_graphics();
+	return ok;
+}
+
+struct test_case {
+	const char *name;
+	bool (*run)(const char *name);
+};
+
+static const struct test_case cases[] = {
+	{"corner_pin", corner_pin},
+	{"corner_pin_identity", corner_pin_identity},
+	{"corner_pin_fused", corner_pin_fused},
+	{"lens_distortion", lens_distortion},
+	{"lens_distortion_square", lens_distortion_square},
+	{"lens_distortion_square_bicubic", lens_distortion_square_bicubic},
+	{"lens_distortion_square_9tap", lens_distortion_square_9tap},
+	{"lens_distortion_wide", lens_distortion_wide},
+	{"lens_distortion_fused", lens_distortion_fused},
+	{"stroke", stroke},
+	{"stroke_wide", stroke_wide},
+	{"stroke_none", stroke_none},
+	{"stroke_resized", stroke_resized},
+	{"overlay", overlay},
+};
+
+static bool selected(const char *name, int count, char **prefixes)
+{
+	if (!count)
+		return true;
+
+	for (int i = 0; i < count; i++) {
+		if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	int failed = 0, run = 0;
+
+	obs_module_load();
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (!selected(cases[i].name, argc - 1, argv + 1))
+			continue;
+
+		run++;
+		if (cases[i].run(cases[i].name)) {
+			printf("PASS %s\n", cases[i].name);
+		} else {
+			failed++;
+		}
+	}
+
+	obs_module_unload();
+
+	printf("%d of %d cases failed\n", failed, run);
+	return failed || !run ? 1 : 0;
+}
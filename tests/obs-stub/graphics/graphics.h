@@ -0,0 +1,205 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+#include "../util/bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum gs_color_format {
+	GS_UNKNOWN,
+	GS_A8,
+	GS_R8,
+	GS_RGBA,
+	GS_BGRX,
+	GS_BGRA,
+	GS_R10G10B10A2,
+	GS_RGBA16,
+	GS_R16,
+	GS_RGBA16F,
+	GS_RGBA32F,
+	GS_RG16F,
+	GS_RG32F,
+	GS_R16F,
+	GS_R32F,
+};
+
+enum gs_zstencil_format {
+	GS_ZS_NONE,
+};
+
+enum gs_draw_mode {
+	GS_POINTS,
+	GS_LINES,
+	GS_LINESTRIP,
+	GS_TRIS,
+	GS_TRISTRIP,
+};
+
+enum gs_blend_type {
+	GS_BLEND_ZERO,
+	GS_BLEND_ONE,
+	GS_BLEND_SRCCOLOR,
+	GS_BLEND_INVSRCCOLOR,
+	GS_BLEND_SRCALPHA,
+	GS_BLEND_INVSRCALPHA,
+};
+
+#define GS_CLEAR_COLOR (1 << 0)
+#define GS_DYNAMIC (1 << 1)
+#define GS_RENDER_TARGET (1 << 2)
+
+struct gs_effect;
+struct gs_effect_param;
+struct gs_effect_technique;
+struct gs_texture;
+struct gs_stage_surface;
+struct gs_texture_render;
+struct gs_vertex_buffer;
+struct gs_index_buffer;
+struct gs_timer;
+struct gs_timer_range;
+
+typedef struct gs_effect gs_effect_t;
+typedef struct gs_effect_param gs_eparam_t;
+typedef struct gs_effect_technique gs_technique_t;
+typedef struct gs_texture gs_texture_t;
+typedef struct gs_stage_surface gs_stagesurf_t;
+typedef struct gs_texture_render gs_texrender_t;
+typedef struct gs_vertex_buffer gs_vertbuffer_t;
+typedef struct gs_index_buffer gs_indexbuffer_t;
+typedef struct gs_timer gs_timer_t;
+typedef struct gs_timer_range gs_timer_range_t;
+
+struct gs_tvertarray {
+	size_t width;
+	void *array;
+};
+
+struct gs_vb_data {
+	size_t num;
+	struct vec3 *points;
+	struct vec3 *normals;
+	struct vec3 *tangents;
+	uint32_t *colors;
+
+	size_t num_tex;
+	struct gs_tvertarray *tvarray;
+};
+
+uint32_t gs_get_format_bpp(enum gs_color_format format);
+
+/* Effects */
+gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
+			      char **error_string);
+void gs_effect_destroy(gs_effect_t *effect);
+gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect,
+					const char *name);
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
+					 const char *name);
+size_t gs_technique_begin(gs_technique_t *technique);
+void gs_technique_end(gs_technique_t *technique);
+bool gs_technique_begin_pass(gs_technique_t *technique, size_t pass);
+void gs_technique_end_pass(gs_technique_t *technique);
+bool gs_effect_loop(gs_effect_t *effect, const char *name);
+
+void gs_effect_set_bool(gs_eparam_t *param, bool val);
+void gs_effect_set_float(gs_eparam_t *param, float val);
+void gs_effect_set_int(gs_eparam_t *param, int val);
+void gs_effect_set_vec2(gs_eparam_t *param, const struct vec2 *val);
+void gs_effect_set_vec4(gs_eparam_t *param, const struct vec4 *val);
+void gs_effect_set_val(gs_eparam_t *param, const void *val, size_t size);
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val);
+void gs_effect_set_texture_srgb(gs_eparam_t *param, gs_texture_t *val);
+
+/* Textures and render targets */
+gs_texture_t *gs_texture_create(uint32_t width, uint32_t height,
+				enum gs_color_format color_format,
+				uint32_t levels, const uint8_t **data,
+				uint32_t flags);
+void gs_texture_destroy(gs_texture_t *tex);
+uint32_t gs_texture_get_width(const gs_texture_t *tex);
+uint32_t gs_texture_get_height(const gs_texture_t *tex);
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize);
+void gs_texture_unmap(gs_texture_t *tex);
+void gs_copy_texture(gs_texture_t *dst, gs_texture_t *src);
+void gs_copy_texture_region(gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+			    gs_texture_t *src, uint32_t src_x, uint32_t src_y,
+			    uint32_t src_w, uint32_t src_h);
+
+gs_texrender_t *gs_texrender_create(enum gs_color_format format,
+				    enum gs_zstencil_format zsformat);
+void gs_texrender_destroy(gs_texrender_t *texrender);
+bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy);
+void gs_texrender_end(gs_texrender_t *texrender);
+void gs_texrender_reset(gs_texrender_t *texrender);
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender);
+
+gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
+				       enum gs_color_format color_format);
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf);
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize);
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf);
+void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src);
+
+/* Vertex buffers */
+static inline struct gs_vb_data *gs_vbdata_create(void)
+{
+	return (struct gs_vb_data *)bzalloc(sizeof(struct gs_vb_data));
+}
+
+gs_vertbuffer_t *gs_vertexbuffer_create(struct gs_vb_data *data,
+					uint32_t flags);
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer);
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer);
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer);
+void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer);
+void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer);
+
+/* Timer queries */
+gs_timer_t *gs_timer_create(void);
+void gs_timer_destroy(gs_timer_t *timer);
+void gs_timer_begin(gs_timer_t *timer);
+void gs_timer_end(gs_timer_t *timer);
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks);
+gs_timer_range_t *gs_timer_range_create(void);
+void gs_timer_range_destroy(gs_timer_range_t *range);
+void gs_timer_range_begin(gs_timer_range_t *range);
+void gs_timer_range_end(gs_timer_range_t *range);
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
+			     uint64_t *frequency);
+
+/* Drawing and state */
+void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
+	     uint32_t num_verts);
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
+		    uint32_t height);
+void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
+	      uint8_t stencil);
+void gs_ortho(float left, float right, float top, float bottom, float znear,
+	      float zfar);
+void gs_blend_state_push(void);
+void gs_blend_state_pop(void);
+void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest);
+bool gs_get_linear_srgb(void);
+bool gs_framebuffer_srgb_enabled(void);
+void gs_enable_framebuffer_srgb(bool enable);
+void gs_viewport_push(void);
+void gs_viewport_pop(void);
+void gs_projection_push(void);
+void gs_projection_pop(void);
+void gs_set_viewport(int x, int y, int width, int height);
+void gs_matrix_push(void);
+void gs_matrix_pop(void);
+void gs_matrix_translate(const struct vec3 *pos);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+struct vec2 {
+	union {
+		struct {
+			float x, y;
+		};
+		float ptr[2];
+	};
+};
+
+static inline void vec2_zero(struct vec2 *dst)
+{
+	dst->x = 0.0f;
+	dst->y = 0.0f;
+}
+
+static inline void vec2_set(struct vec2 *dst, float x, float y)
+{
+	dst->x = x;
+	dst->y = y;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/* Padded to 16 bytes like libobs' SSE vector */
+struct vec3 {
+	union {
+		struct {
+			float x, y, z, w;
+		};
+		float ptr[4];
+	};
+};
+
+static inline void vec3_set(struct vec3 *dst, float x, float y, float z)
+{
+	dst->x = x;
+	dst->y = y;
+	dst->z = z;
+	dst->w = 0.0f;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+struct vec4 {
+	union {
+		struct {
+			float x, y, z, w;
+		};
+		float ptr[4];
+	};
+};
+
+static inline void vec4_zero(struct vec4 *dst)
+{
+	dst->x = dst->y = dst->z = dst->w = 0.0f;
+}
+
+static inline void vec4_set(struct vec4 *dst, float x, float y, float z,
+			    float w)
+{
+	dst->x = x;
+	dst->y = y;
+	dst->z = z;
+	dst->w = w;
+}
+
+static inline void vec4_from_rgba(struct vec4 *dst, uint32_t rgba)
+{
+	dst->x = (float)(rgba & 0xFF) / 255.0f;
+	dst->y = (float)((rgba >> 8) & 0xFF) / 255.0f;
+	dst->z = (float)((rgba >> 16) & 0xFF) / 255.0f;
+	dst->w = (float)((rgba >> 24) & 0xFF) / 255.0f;
+}
+
+static inline float vec4_srgb_to_linear(float u)
+{
+	return u <= 0.04045f ? u / 12.92f
+			     : powf((u + 0.055f) / 1.055f, 2.4f);
+}
+
+static inline void vec4_from_rgba_srgb(struct vec4 *dst, uint32_t rgba)
+{
+	vec4_from_rgba(dst, rgba);
+	dst->x = vec4_srgb_to_linear(dst->x);
+	dst->y = vec4_srgb_to_linear(dst->y);
+	dst->z = vec4_srgb_to_linear(dst->z);
+}
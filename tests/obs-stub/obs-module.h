@@ -0,0 +1,15 @@
+#pragma once
+
+#include "obs.h"
+
+#ifdef __cplusplus
+#define MODULE_EXTERN extern "C"
+#else
+#define MODULE_EXTERN extern
+#endif
+
+#define OBS_DECLARE_MODULE()
+#define OBS_MODULE_USE_DEFAULT_LOCALE(module_name, default_locale)
+
+MODULE_EXTERN bool obs_module_load(void);
+MODULE_EXTERN void obs_module_unload(void);
@@ -0,0 +1,2063 @@
+#include <obs-module.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include "obs-stub.hpp"
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct obs_stub_calls obs_stub_calls = {};
+
+void obs_stub_reset_calls(void)
+{
+	obs_stub_calls = {};
+}
+
+/* ------------------------------------------------------------------------- */
+/* Memory, logging and platform                                              */
+
+void *bmalloc(size_t size)
+{
+	return malloc(size ? size : 1);
+}
+
+void *brealloc(void *ptr, size_t size)
+{
+	return realloc(ptr, size ? size : 1);
+}
+
+void bfree(void *ptr)
+{
+	free(ptr);
+}
+
+char *bstrdup(const char *str)
+{
+	if (!str)
+		return NULL;
+
+	size_t size = strlen(str) + 1;
+	return (char *)memcpy(bmalloc(size), str, size);
+}
+
+static std::mutex log_mutex;
+
+void blog(int log_level, const char *format, ...)
+{
+	std::lock_guard<std::mutex> lock(log_mutex);
+	va_list args;
+
+	if (log_level <= LOG_WARNING)
+		obs_stub_calls.warnings++;
+
+	va_start(args, format);
+	printf("%s: ", log_level <= LOG_ERROR     ? "error"
+		       : log_level <= LOG_WARNING ? "warning"
+						  : "info");
+	vprintf(format, args);
+	printf("\n");
+	va_end(args);
+}
+
+void profile_start(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
+
+void profile_end(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
+
+uint64_t os_gettime_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+FILE *os_fopen(const char *path, const char *mode)
+{
+	return fopen(path, mode);
+}
+
+int os_unlink(const char *path)
+{
+	return unlink(path);
+}
+
+struct os_sem_data {
+	sem_t sem;
+};
+
+int os_sem_init(os_sem_t **sem, int value)
+{
+	*sem = new os_sem_data;
+	return sem_init(&(*sem)->sem, 0, (unsigned)value);
+}
+
+void os_sem_destroy(os_sem_t *sem)
+{
+	if (!sem)
+		return;
+
+	sem_destroy(&sem->sem);
+	delete sem;
+}
+
+int os_sem_post(os_sem_t *sem)
+{
+	return sem ? sem_post(&sem->sem) : -1;
+}
+
+int os_sem_wait(os_sem_t *sem)
+{
+	return sem ? sem_wait(&sem->sem) : -1;
+}
+
+void os_set_thread_name(const char *name)
+{
+	UNUSED_PARAMETER(name);
+}
+
+void dstr_free(struct dstr *dst)
+{
+	bfree(dst->array);
+	dst->array = NULL;
+	dst->len = 0;
+	dst->capacity = 0;
+}
+
+static void dstr_ncat(struct dstr *dst, const char *array, size_t len)
+{
+	if (dst->len + len + 1 > dst->capacity) {
+		dst->capacity = std::max(dst->capacity * 2, dst->len + len + 1);
+		dst->array = (char *)brealloc(dst->array, dst->capacity);
+	}
+
+	memcpy(dst->array + dst->len, array, len);
+	dst->len += len;
+	dst->array[dst->len] = 0;
+}
+
+void dstr_copy(struct dstr *dst, const char *array)
+{
+	dst->len = 0;
+	dstr_ncat(dst, array ? array : "", array ? strlen(array) : 0);
+}
+
+void dstr_cat(struct dstr *dst, const char *array)
+{
+	if (array)
+		dstr_ncat(dst, array, strlen(array));
+}
+
+void dstr_catf(struct dstr *dst, const char *format, ...)
+{
+	va_list args, copy;
+
+	va_start(args, format);
+	va_copy(copy, args);
+	int len = vsnprintf(NULL, 0, format, copy);
+	va_end(copy);
+
+	std::vector<char> text((size_t)std::max(len, 0) + 1);
+	vsnprintf(text.data(), text.size(), format, args);
+	va_end(args);
+
+	dstr_ncat(dst, text.data(), text.size() - 1);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Data                                                                      */
+
+struct stub_value {
+	enum type { NONE, STRING, INT, DOUBLE, BOOL, OBJ, ARRAY } type = NONE;
+	std::string string;
+	long long integer = 0;
+	double number = 0.0;
+	bool boolean = false;
+	obs_data_t *obj = nullptr;
+	obs_data_array_t *array = nullptr;
+};
+
+struct stub_item {
+	stub_value user;
+	stub_value def;
+};
+
+struct obs_data {
+	long refs = 1;
+	std::map<std::string, stub_item> items;
+	std::string json;
+};
+
+struct obs_data_array {
+	long refs = 1;
+	std::vector<obs_data_t *> items;
+};
+
+static void value_clear(stub_value &value)
+{
+	obs_data_release(value.obj);
+	obs_data_array_release(value.array);
+	value = stub_value();
+}
+
+static void value_copy(stub_value &dst, const stub_value &src)
+{
+	if (&dst == &src)
+		return;
+
+	value_clear(dst);
+	dst = src;
+	if (dst.obj)
+		obs_data_addref(dst.obj);
+	if (dst.array)
+		os_atomic_inc_long(&dst.array->refs);
+}
+
+obs_data_t *obs_data_create(void)
+{
+	return new obs_data;
+}
+
+void obs_data_addref(obs_data_t *data)
+{
+	if (data)
+		os_atomic_inc_long(&data->refs);
+}
+
+void obs_data_release(obs_data_t *data)
+{
+	if (!data || os_atomic_dec_long(&data->refs))
+		return;
+
+	for (auto &item : data->items) {
+		value_clear(item.second.user);
+		value_clear(item.second.def);
+	}
+	delete data;
+}
+
+static void json_string(std::string &json, const std::string &str)
+{
+	json += '"';
+	for (char c : str) {
+		if (c == '"' || c == '\\')
+			json += '\\';
+		json += c;
+	}
+	json += '"';
+}
+
+static void json_value(std::string &json, const stub_value &value)
+{
+	char number[64];
+
+	switch (value.type) {
+	case stub_value::STRING:
+		json_string(json, value.string);
+		break;
+	case stub_value::INT:
+		json += std::to_string(value.integer);
+		break;
+	case stub_value::DOUBLE:
+		snprintf(number, sizeof(number), "%.17g", value.number);
+		json += number;
+		break;
+	case stub_value::BOOL:
+		json += value.boolean ? "true" : "false";
+		break;
+	case stub_value::OBJ:
+		json += obs_data_get_json(value.obj);
+		break;
+	case stub_value::ARRAY:
+		json += '[';
+		for (size_t i = 0; i < value.array->items.size(); i++) {
+			json += i ? "," : "";
+			json += obs_data_get_json(value.array->items[i]);
+		}
+		json += ']';
+		break;
+	case stub_value::NONE:
+		json += "null";
+		break;
+	}
+}
+
+/* User values only, keys sorted, like libobs' output for the same data */
+const char *obs_data_get_json(obs_data_t *data)
+{
+	if (!data)
+		return NULL;
+
+	std::string json = "{";
+	bool first = true;
+
+	for (auto &item : data->items) {
+		if (item.second.user.type == stub_value::NONE)
+			continue;
+
+		json += first ? "" : ",";
+		json_string(json, item.first);
+		json += ':';
+		json_value(json, item.second.user);
+		first = false;
+	}
+
+	data->json = json + "}";
+	return data->json.c_str();
+}
+
+void obs_data_apply(obs_data_t *target, obs_data_t *apply_data)
+{
+	if (!target || !apply_data || target == apply_data)
+		return;
+
+	for (auto &item : apply_data->items) {
+		if (item.second.user.type != stub_value::NONE)
+			value_copy(target->items[item.first].user,
+				   item.second.user);
+	}
+}
+
+static stub_value *set_value(obs_data_t *data, const char *name, bool def)
+{
+	if (!data || !name)
+		return nullptr;
+
+	stub_item &item = data->items[name];
+	stub_value &value = def ? item.def : item.user;
+
+	value_clear(value);
+	return &value;
+}
+
+static const stub_value *get_value(obs_data_t *data, const char *name)
+{
+	if (!data || !name)
+		return nullptr;
+
+	auto it = data->items.find(name);
+	if (it == data->items.end())
+		return nullptr;
+	if (it->second.user.type != stub_value::NONE)
+		return &it->second.user;
+	if (it->second.def.type != stub_value::NONE)
+		return &it->second.def;
+	return nullptr;
+}
+
+#define SET_VALUE(data, name, def, field, kind, val)                   \
+	do {                                                           \
+		stub_value *value = set_value(data, name, def);        \
+		if (value) {                                           \
+			value->type = stub_value::kind;                \
+			value->field = val;                            \
+		}                                                      \
+	} while (false)
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val)
+{
+	SET_VALUE(data, name, false, string, STRING, val ? val : "");
+}
+
+void obs_data_set_int(obs_data_t *data, const char *name, long long val)
+{
+	SET_VALUE(data, name, false, integer, INT, val);
+}
+
+void obs_data_set_double(obs_data_t *data, const char *name, double val)
+{
+	SET_VALUE(data, name, false, number, DOUBLE, val);
+}
+
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val)
+{
+	SET_VALUE(data, name, false, boolean, BOOL, val);
+}
+
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj)
+{
+	obs_data_addref(obj);
+	SET_VALUE(data, name, false, obj, OBJ, obj);
+}
+
+void obs_data_set_array(obs_data_t *data, const char *name,
+			obs_data_array_t *array)
+{
+	if (array)
+		os_atomic_inc_long(&array->refs);
+	SET_VALUE(data, name, false, array, ARRAY, array);
+}
+
+void obs_data_set_default_string(obs_data_t *data, const char *name,
+				 const char *val)
+{
+	SET_VALUE(data, name, true, string, STRING, val ? val : "");
+}
+
+void obs_data_set_default_int(obs_data_t *data, const char *name,
+			      long long val)
+{
+	SET_VALUE(data, name, true, integer, INT, val);
+}
+
+void obs_data_set_default_double(obs_data_t *data, const char *name,
+				 double val)
+{
+	SET_VALUE(data, name, true, number, DOUBLE, val);
+}
+
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val)
+{
+	SET_VALUE(data, name, true, boolean, BOOL, val);
+}
+
+const char *obs_data_get_string(obs_data_t *data, const char *name)
+{
+	const stub_value *value = get_value(data, name);
+	return value && value->type == stub_value::STRING
+		       ? value->string.c_str()
+		       : "";
+}
+
+/* Numbers convert between int and double as they do in libobs */
+long long obs_data_get_int(obs_data_t *data, const char *name)
+{
+	const stub_value *value = get_value(data, name);
+	if (!value)
+		return 0;
+	if (value->type == stub_value::DOUBLE)
+		return (long long)value->number;
+	return value->type == stub_value::INT ? value->integer : 0;
+}
+
+double obs_data_get_double(obs_data_t *data, const char *name)
+{
+	const stub_value *value = get_value(data, name);
+	if (!value)
+		return 0.0;
+	if (value->type == stub_value::INT)
+		return (double)value->integer;
+	return value->type == stub_value::DOUBLE ? value->number : 0.0;
+}
+
+bool obs_data_get_bool(obs_data_t *data, const char *name)
+{
+	const stub_value *value = get_value(data, name);
+	return value && value->type == stub_value::BOOL && value->boolean;
+}
+
+obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name)
+{
+	const stub_value *value = get_value(data, name);
+	if (!value || value->type != stub_value::ARRAY)
+		return NULL;
+
+	os_atomic_inc_long(&value->array->refs);
+	return value->array;
+}
+
+bool obs_data_has_user_value(obs_data_t *data, const char *name)
+{
+	if (!data || !name)
+		return false;
+
+	auto it = data->items.find(name);
+	return it != data->items.end() &&
+	       it->second.user.type != stub_value::NONE;
+}
+
+obs_data_array_t *obs_data_array_create(void)
+{
+	return new obs_data_array;
+}
+
+void obs_data_array_release(obs_data_array_t *array)
+{
+	if (!array || os_atomic_dec_long(&array->refs))
+		return;
+
+	for (obs_data_t *item : array->items)
+		obs_data_release(item);
+	delete array;
+}
+
+size_t obs_data_array_count(obs_data_array_t *array)
+{
+	return array ? array->items.size() : 0;
+}
+
+obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx)
+{
+	if (!array || idx >= array->items.size())
+		return NULL;
+
+	obs_data_addref(array->items[idx]);
+	return array->items[idx];
+}
+
+size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj)
+{
+	if (!array || !obj)
+		return 0;
+
+	obs_data_addref(obj);
+	array->items.push_back(obj);
+	return array->items.size() - 1;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Properties, calldata and procedures                                       */
+
+struct obs_property {
+	std::string name;
+	std::string description;
+	std::vector<std::string> items;
+};
+
+struct obs_properties {
+	std::vector<std::unique_ptr<obs_property>> list;
+};
+
+obs_properties_t *obs_properties_create(void)
+{
+	return new obs_properties;
+}
+
+void obs_properties_destroy(obs_properties_t *props)
+{
+	delete props;
+}
+
+obs_property_t *obs_properties_get(obs_properties_t *props,
+				   const char *property)
+{
+	for (auto &p : props->list) {
+		if (p->name == property)
+			return p.get();
+	}
+	return NULL;
+}
+
+static obs_property_t *add_property(obs_properties_t *props,
+				    const char *name, const char *description)
+{
+	props->list.emplace_back(new obs_property);
+
+	obs_property_t *p = props->list.back().get();
+	p->name = name;
+	p->description = description ? description : "";
+	return p;
+}
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props,
+					const char *name,
+					const char *description)
+{
+	return add_property(props, name, description);
+}
+
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props,
+					      const char *name,
+					      const char *description,
+					      int min, int max, int step)
+{
+	UNUSED_PARAMETER(min);
+	UNUSED_PARAMETER(max);
+	UNUSED_PARAMETER(step);
+	return add_property(props, name, description);
+}
+
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props,
+						const char *name,
+						const char *description,
+						double min, double max,
+						double step)
+{
+	UNUSED_PARAMETER(min);
+	UNUSED_PARAMETER(max);
+	UNUSED_PARAMETER(step);
+	return add_property(props, name, description);
+}
+
+obs_property_t *obs_properties_add_path(obs_properties_t *props,
+					const char *name,
+					const char *description,
+					enum obs_path_type type,
+					const char *filter,
+					const char *default_path)
+{
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(filter);
+	UNUSED_PARAMETER(default_path);
+	return add_property(props, name, description);
+}
+
+obs_property_t *obs_properties_add_list(obs_properties_t *props,
+					const char *name,
+					const char *description,
+					enum obs_combo_type type,
+					enum obs_combo_format format)
+{
+	UNUSED_PARAMETER(type);
+	UNUSED_PARAMETER(format);
+	return add_property(props, name, description);
+}
+
+obs_property_t *obs_properties_add_color(obs_properties_t *props,
+					 const char *name,
+					 const char *description)
+{
+	return add_property(props, name, description);
+}
+
+obs_property_t *obs_properties_add_button(obs_properties_t *props,
+					  const char *name, const char *text,
+					  obs_property_clicked_t callback)
+{
+	UNUSED_PARAMETER(callback);
+	return add_property(props, name, text);
+}
+
+size_t obs_property_list_add_string(obs_property_t *p, const char *name,
+				    const char *val)
+{
+	UNUSED_PARAMETER(val);
+	p->items.push_back(name);
+	return p->items.size() - 1;
+}
+
+size_t obs_property_list_add_int(obs_property_t *p, const char *name,
+				 long long val)
+{
+	UNUSED_PARAMETER(val);
+	p->items.push_back(name);
+	return p->items.size() - 1;
+}
+
+void obs_property_set_description(obs_property_t *p, const char *description)
+{
+	p->description = description ? description : "";
+}
+
+void obs_property_set_long_description(obs_property_t *p,
+				       const char *long_description)
+{
+	UNUSED_PARAMETER(p);
+	UNUSED_PARAMETER(long_description);
+}
+
+/* Values are kept in a map hung off the calldata's stack pointer */
+typedef std::map<std::string, stub_value> stub_calldata;
+
+static stub_calldata *calldata_values(calldata_t *data)
+{
+	if (!data->stack)
+		data->stack = (uint8_t *)new stub_calldata;
+	return (stub_calldata *)data->stack;
+}
+
+static const stub_value *calldata_get(const calldata_t *data,
+				      const char *name)
+{
+	const stub_calldata *values = (const stub_calldata *)data->stack;
+	if (!values)
+		return nullptr;
+
+	auto it = values->find(name);
+	return it != values->end() ? &it->second : nullptr;
+}
+
+void calldata_free(calldata_t *data)
+{
+	delete (stub_calldata *)data->stack;
+	data->stack = NULL;
+}
+
+long long calldata_int(const calldata_t *data, const char *name)
+{
+	const stub_value *value = calldata_get(data, name);
+	return value ? value->integer : 0;
+}
+
+double calldata_float(const calldata_t *data, const char *name)
+{
+	const stub_value *value = calldata_get(data, name);
+	return value ? value->number : 0.0;
+}
+
+bool calldata_bool(const calldata_t *data, const char *name)
+{
+	const stub_value *value = calldata_get(data, name);
+	return value && value->boolean;
+}
+
+const char *calldata_string(const calldata_t *data, const char *name)
+{
+	const stub_value *value = calldata_get(data, name);
+	return value ? value->string.c_str() : NULL;
+}
+
+void calldata_set_int(calldata_t *data, const char *name, long long val)
+{
+	stub_value &value = (*calldata_values(data))[name];
+	value.type = stub_value::INT;
+	value.integer = val;
+}
+
+void calldata_set_float(calldata_t *data, const char *name, double val)
+{
+	stub_value &value = (*calldata_values(data))[name];
+	value.type = stub_value::DOUBLE;
+	value.number = val;
+}
+
+void calldata_set_bool(calldata_t *data, const char *name, bool val)
+{
+	stub_value &value = (*calldata_values(data))[name];
+	value.type = stub_value::BOOL;
+	value.boolean = val;
+}
+
+void calldata_set_string(calldata_t *data, const char *name, const char *str)
+{
+	stub_value &value = (*calldata_values(data))[name];
+	value.type = stub_value::STRING;
+	value.string = str ? str : "";
+}
+
+struct proc_handler {
+	struct proc {
+		proc_handler_proc_t func;
+		void *data;
+	};
+
+	std::map<std::string, proc> procs;
+};
+
+/* "void get_stats(out int frames, ...)" is registered as "get_stats" */
+void proc_handler_add(proc_handler_t *handler, const char *decl_string,
+		      proc_handler_proc_t proc, void *data)
+{
+	static const std::regex decl("^\\s*\\w+\\s+(\\w+)\\s*\\(");
+	std::cmatch match;
+
+	if (!std::regex_search(decl_string, match, decl)) {
+		blog(LOG_ERROR, "proc_handler_add: invalid declaration '%s'",
+		     decl_string);
+		return;
+	}
+
+	handler->procs[match[1].str()] = {proc, data};
+}
+
+bool proc_handler_call(proc_handler_t *handler, const char *name,
+		       calldata_t *params)
+{
+	auto it = handler->procs.find(name);
+	if (it == handler->procs.end())
+		return false;
+
+	it->second.func(it->second.data, params);
+	return true;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Graphics                                                                  */
+
+static std::recursive_mutex graphics_mutex;
+static thread_local long graphics_depth = 0;
+
+void obs_enter_graphics(void)
+{
+	graphics_mutex.lock();
+	graphics_depth++;
+}
+
+void obs_leave_graphics(void)
+{
+	graphics_depth--;
+	graphics_mutex.unlock();
+}
+
+static inline void graphics_call(void)
+{
+	if (!graphics_depth)
+		obs_stub_calls.outside_graphics++;
+}
+
+uint32_t gs_get_format_bpp(enum gs_color_format format)
+{
+	switch (format) {
+	case GS_A8:
+	case GS_R8:
+		return 8;
+	case GS_R16:
+	case GS_R16F:
+		return 16;
+	case GS_RGBA:
+	case GS_BGRX:
+	case GS_BGRA:
+	case GS_R10G10B10A2:
+	case GS_RG16F:
+	case GS_R32F:
+		return 32;
+	case GS_RGBA16:
+	case GS_RGBA16F:
+	case GS_RG32F:
+		return 64;
+	case GS_RGBA32F:
+		return 128;
+	case GS_UNKNOWN:
+		break;
+	}
+	return 0;
+}
+
+struct gs_effect_param {
+	std::string name;
+};
+
+struct gs_effect_technique {
+	gs_effect_t *effect;
+	std::string name;
+	size_t passes;
+};
+
+struct gs_effect {
+	std::map<std::string, std::unique_ptr<gs_effect_param>> params;
+	std::map<std::string, std::unique_ptr<gs_effect_technique>> techniques;
+
+	bool looping;
+	gs_technique_t *loop_tech;
+	size_t loop_pass;
+};
+
+/* Effect whose technique is between begin and end, as gs_get_effect */
+static gs_effect_t *current_effect = nullptr;
+
+static gs_effect_t *parse_effect(const char *source)
+{
+	static const std::regex uniform("\\buniform\\s+\\w+\\s+(\\w+)");
+	static const std::regex technique("\\btechnique\\s+(\\w+)");
+
+	gs_effect_t *effect = new gs_effect_t();
+	std::string text = source;
+
+	for (std::sregex_iterator it(text.begin(), text.end(), uniform), end;
+	     it != end; ++it) {
+		std::string name = (*it)[1].str();
+		effect->params[name].reset(new gs_effect_param{name});
+	}
+
+	for (std::sregex_iterator it(text.begin(), text.end(), technique), end;
+	     it != end; ++it) {
+		std::string name = (*it)[1].str();
+		effect->techniques[name].reset(
+			new gs_effect_technique{effect, name, 1});
+	}
+
+	return effect;
+}
+
+gs_effect_t *gs_effect_create(const char *effect_string, const char *filename,
+			      char **error_string)
+{
+	graphics_call();
+	obs_stub_calls.effect_creates++;
+
+	UNUSED_PARAMETER(filename);
+	if (error_string)
+		*error_string = NULL;
+
+	return effect_string ? parse_effect(effect_string) : NULL;
+}
+
+void gs_effect_destroy(gs_effect_t *effect)
+{
+	graphics_call();
+	delete effect;
+}
+
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect)
+{
+	static gs_effect_t *default_effect =
+		parse_effect("uniform float4x4 ViewProj;\n"
+			     "uniform texture2d image;\n"
+			     "technique Draw {}\n"
+			     "technique DrawSrgbDecompress {}\n");
+	static gs_effect_t *solid_effect =
+		parse_effect("uniform float4x4 ViewProj;\n"
+			     "uniform float4 color;\n"
+			     "technique Solid {}\n"
+			     "technique SolidColored {}\n");
+
+	return effect == OBS_EFFECT_SOLID ? solid_effect : default_effect;
+}
+
+gs_technique_t *gs_effect_get_technique(const gs_effect_t *effect,
+					const char *name)
+{
+	if (!effect || !name)
+		return NULL;
+
+	auto it = effect->techniques.find(name);
+	return it != effect->techniques.end() ? it->second.get() : NULL;
+}
+
+gs_eparam_t *gs_effect_get_param_by_name(const gs_effect_t *effect,
+					 const char *name)
+{
+	if (!effect || !name)
+		return NULL;
+
+	auto it = effect->params.find(name);
+	return it != effect->params.end() ? it->second.get() : NULL;
+}
+
+size_t gs_technique_begin(gs_technique_t *technique)
+{
+	graphics_call();
+	if (!technique)
+		return 0;
+
+	current_effect = technique->effect;
+	return technique->passes;
+}
+
+void gs_technique_end(gs_technique_t *technique)
+{
+	graphics_call();
+	if (technique)
+		current_effect = nullptr;
+}
+
+bool gs_technique_begin_pass(gs_technique_t *technique, size_t pass)
+{
+	graphics_call();
+	return technique && pass < technique->passes;
+}
+
+void gs_technique_end_pass(gs_technique_t *technique)
+{
+	graphics_call();
+	UNUSED_PARAMETER(technique);
+}
+
+/* Same control flow and warnings as libobs' gs_effect_loop */
+bool gs_effect_loop(gs_effect_t *effect, const char *name)
+{
+	if (!effect)
+		return false;
+
+	if (!effect->looping) {
+		if (current_effect) {
+			blog(LOG_WARNING, "gs_effect_loop: An effect is "
+					  "already active");
+			return false;
+		}
+
+		gs_technique_t *tech = gs_effect_get_technique(effect, name);
+		if (!tech) {
+			blog(LOG_WARNING,
+			     "gs_effect_loop: Technique '%s' not found.", name);
+			return false;
+		}
+
+		gs_technique_begin(tech);
+		effect->looping = true;
+		effect->loop_tech = tech;
+	} else {
+		gs_technique_end_pass(effect->loop_tech);
+	}
+
+	if (!gs_technique_begin_pass(effect->loop_tech, effect->loop_pass++)) {
+		gs_technique_end(effect->loop_tech);
+		effect->looping = false;
+		effect->loop_tech = NULL;
+		effect->loop_pass = 0;
+		return false;
+	}
+
+	return true;
+}
+
+static void set_param(gs_eparam_t *param)
+{
+	graphics_call();
+	obs_stub_calls.param_sets++;
+
+	if (!param)
+		blog(LOG_ERROR, "effect_setval_inline: invalid param");
+}
+
+void gs_effect_set_bool(gs_eparam_t *param, bool val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+void gs_effect_set_float(gs_eparam_t *param, float val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+void gs_effect_set_int(gs_eparam_t *param, int val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+void gs_effect_set_vec2(gs_eparam_t *param, const struct vec2 *val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+void gs_effect_set_vec4(gs_eparam_t *param, const struct vec4 *val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+void gs_effect_set_val(gs_eparam_t *param, const void *val, size_t size)
+{
+	UNUSED_PARAMETER(val);
+	UNUSED_PARAMETER(size);
+	set_param(param);
+}
+
+void gs_effect_set_texture(gs_eparam_t *param, gs_texture_t *val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+void gs_effect_set_texture_srgb(gs_eparam_t *param, gs_texture_t *val)
+{
+	UNUSED_PARAMETER(val);
+	set_param(param);
+}
+
+struct gs_texture {
+	uint32_t cx, cy;
+	enum gs_color_format format;
+	uint32_t flags;
+	std::vector<uint8_t> mapped;
+};
+
+gs_texture_t *gs_texture_create(uint32_t width, uint32_t height,
+				enum gs_color_format color_format,
+				uint32_t levels, const uint8_t **data,
+				uint32_t flags)
+{
+	graphics_call();
+	obs_stub_calls.texture_creates++;
+
+	UNUSED_PARAMETER(levels);
+	UNUSED_PARAMETER(data);
+
+	if (!width || !height)
+		return NULL;
+	return new gs_texture{width, height, color_format, flags, {}};
+}
+
+void gs_texture_destroy(gs_texture_t *tex)
+{
+	graphics_call();
+	delete tex;
+}
+
+uint32_t gs_texture_get_width(const gs_texture_t *tex)
+{
+	return tex ? tex->cx : 0;
+}
+
+uint32_t gs_texture_get_height(const gs_texture_t *tex)
+{
+	return tex ? tex->cy : 0;
+}
+
+/* Only dynamic textures can be mapped, as in libobs.  What is written is
+ * thrown away: nothing reads texels back. */
+bool gs_texture_map(gs_texture_t *tex, uint8_t **ptr, uint32_t *linesize)
+{
+	graphics_call();
+	obs_stub_calls.texture_maps++;
+
+	if (!tex || !(tex->flags & GS_DYNAMIC))
+		return false;
+
+	*linesize = tex->cx * 16;
+	tex->mapped.resize((size_t)*linesize * tex->cy);
+	*ptr = tex->mapped.data();
+	return true;
+}
+
+void gs_texture_unmap(gs_texture_t *tex)
+{
+	graphics_call();
+	UNUSED_PARAMETER(tex);
+}
+
+void gs_copy_texture(gs_texture_t *dst, gs_texture_t *src)
+{
+	graphics_call();
+	obs_stub_calls.texture_copies++;
+
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(src);
+}
+
+void gs_copy_texture_region(gs_texture_t *dst, uint32_t dst_x, uint32_t dst_y,
+			    gs_texture_t *src, uint32_t src_x, uint32_t src_y,
+			    uint32_t src_w, uint32_t src_h)
+{
+	graphics_call();
+	obs_stub_calls.texture_copies++;
+
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(dst_x);
+	UNUSED_PARAMETER(dst_y);
+	UNUSED_PARAMETER(src);
+	UNUSED_PARAMETER(src_x);
+	UNUSED_PARAMETER(src_y);
+	UNUSED_PARAMETER(src_w);
+	UNUSED_PARAMETER(src_h);
+}
+
+/* Rendered from begin to the next reset, as in libobs: a second begin
+ * without a reset in between fails */
+struct gs_texture_render {
+	enum gs_color_format format;
+	gs_texture_t *target;
+	uint32_t cx, cy;
+	bool rendered;
+};
+
+gs_texrender_t *gs_texrender_create(enum gs_color_format format,
+				    enum gs_zstencil_format zsformat)
+{
+	graphics_call();
+	obs_stub_calls.texrender_creates++;
+
+	UNUSED_PARAMETER(zsformat);
+	return new gs_texture_render{format, NULL, 0, 0, false};
+}
+
+void gs_texrender_destroy(gs_texrender_t *texrender)
+{
+	graphics_call();
+	if (!texrender)
+		return;
+
+	gs_texture_destroy(texrender->target);
+	delete texrender;
+}
+
+bool gs_texrender_begin(gs_texrender_t *texrender, uint32_t cx, uint32_t cy)
+{
+	graphics_call();
+
+	if (!texrender || texrender->rendered || !cx || !cy)
+		return false;
+
+	obs_stub_calls.texrender_begins++;
+
+	if (texrender->cx != cx || texrender->cy != cy) {
+		gs_texture_destroy(texrender->target);
+		texrender->target = gs_texture_create(cx, cy, texrender->format,
+						      1, NULL,
+						      GS_RENDER_TARGET);
+		texrender->cx = cx;
+		texrender->cy = cy;
+	}
+
+	return texrender->target != NULL;
+}
+
+void gs_texrender_end(gs_texrender_t *texrender)
+{
+	graphics_call();
+	if (texrender)
+		texrender->rendered = true;
+}
+
+void gs_texrender_reset(gs_texrender_t *texrender)
+{
+	graphics_call();
+	if (texrender)
+		texrender->rendered = false;
+}
+
+gs_texture_t *gs_texrender_get_texture(const gs_texrender_t *texrender)
+{
+	return texrender ? texrender->target : NULL;
+}
+
+struct gs_stage_surface {
+	uint32_t cx, cy;
+	enum gs_color_format format;
+	std::vector<uint8_t> data;
+};
+
+gs_stagesurf_t *gs_stagesurface_create(uint32_t width, uint32_t height,
+				       enum gs_color_format color_format)
+{
+	graphics_call();
+	obs_stub_calls.stagesurface_creates++;
+
+	gs_stagesurf_t *surf = new gs_stage_surface{width, height,
+						     color_format, {}};
+	surf->data.resize((size_t)width * height *
+			  gs_get_format_bpp(color_format) / 8);
+	return surf;
+}
+
+void gs_stagesurface_destroy(gs_stagesurf_t *stagesurf)
+{
+	graphics_call();
+	delete stagesurf;
+}
+
+bool gs_stagesurface_map(gs_stagesurf_t *stagesurf, uint8_t **data,
+			 uint32_t *linesize)
+{
+	graphics_call();
+	if (!stagesurf || stagesurf->data.empty())
+		return false;
+
+	*data = stagesurf->data.data();
+	*linesize = stagesurf->cx * gs_get_format_bpp(stagesurf->format) / 8;
+	return true;
+}
+
+void gs_stagesurface_unmap(gs_stagesurf_t *stagesurf)
+{
+	graphics_call();
+	UNUSED_PARAMETER(stagesurf);
+}
+
+void gs_stage_texture(gs_stagesurf_t *dst, gs_texture_t *src)
+{
+	graphics_call();
+	obs_stub_calls.texture_stages++;
+
+	UNUSED_PARAMETER(dst);
+	UNUSED_PARAMETER(src);
+}
+
+struct gs_vertex_buffer {
+	struct gs_vb_data *data;
+	uint32_t flags;
+};
+
+static void vbdata_destroy(struct gs_vb_data *data)
+{
+	if (!data)
+		return;
+
+	bfree(data->points);
+	bfree(data->normals);
+	bfree(data->tangents);
+	bfree(data->colors);
+	for (size_t i = 0; i < data->num_tex; i++)
+		bfree(data->tvarray[i].array);
+	bfree(data->tvarray);
+	bfree(data);
+}
+
+gs_vertbuffer_t *gs_vertexbuffer_create(struct gs_vb_data *data,
+					uint32_t flags)
+{
+	graphics_call();
+	obs_stub_calls.vertexbuffer_creates++;
+
+	return new gs_vertex_buffer{data, flags};
+}
+
+void gs_vertexbuffer_destroy(gs_vertbuffer_t *vertbuffer)
+{
+	graphics_call();
+	if (!vertbuffer)
+		return;
+
+	vbdata_destroy(vertbuffer->data);
+	delete vertbuffer;
+}
+
+void gs_vertexbuffer_flush(gs_vertbuffer_t *vertbuffer)
+{
+	graphics_call();
+	obs_stub_calls.vertexbuffer_flushes++;
+
+	if (vertbuffer && !(vertbuffer->flags & GS_DYNAMIC))
+		blog(LOG_ERROR, "gs_vertexbuffer_flush: vertex buffer is "
+				"not dynamic");
+}
+
+struct gs_vb_data *gs_vertexbuffer_get_data(const gs_vertbuffer_t *vertbuffer)
+{
+	return vertbuffer ? vertbuffer->data : NULL;
+}
+
+void gs_load_vertexbuffer(gs_vertbuffer_t *vertbuffer)
+{
+	graphics_call();
+	UNUSED_PARAMETER(vertbuffer);
+}
+
+void gs_load_indexbuffer(gs_indexbuffer_t *indexbuffer)
+{
+	graphics_call();
+	UNUSED_PARAMETER(indexbuffer);
+}
+
+struct gs_timer {
+	bool ended;
+};
+
+struct gs_timer_range {
+	bool ended;
+};
+
+gs_timer_t *gs_timer_create(void)
+{
+	graphics_call();
+	return new gs_timer{false};
+}
+
+void gs_timer_destroy(gs_timer_t *timer)
+{
+	graphics_call();
+	delete timer;
+}
+
+void gs_timer_begin(gs_timer_t *timer)
+{
+	graphics_call();
+	timer->ended = false;
+}
+
+void gs_timer_end(gs_timer_t *timer)
+{
+	graphics_call();
+	timer->ended = true;
+}
+
+bool gs_timer_get_data(gs_timer_t *timer, uint64_t *ticks)
+{
+	graphics_call();
+	*ticks = 0;
+	return timer && timer->ended;
+}
+
+gs_timer_range_t *gs_timer_range_create(void)
+{
+	graphics_call();
+	return new gs_timer_range{false};
+}
+
+void gs_timer_range_destroy(gs_timer_range_t *range)
+{
+	graphics_call();
+	delete range;
+}
+
+void gs_timer_range_begin(gs_timer_range_t *range)
+{
+	graphics_call();
+	range->ended = false;
+}
+
+void gs_timer_range_end(gs_timer_range_t *range)
+{
+	graphics_call();
+	range->ended = true;
+}
+
+bool gs_timer_range_get_data(gs_timer_range_t *range, bool *disjoint,
+			     uint64_t *frequency)
+{
+	graphics_call();
+	*disjoint = false;
+	*frequency = 1000000000;
+	return range && range->ended;
+}
+
+void gs_draw(enum gs_draw_mode draw_mode, uint32_t start_vert,
+	     uint32_t num_verts)
+{
+	graphics_call();
+	obs_stub_calls.draws++;
+
+	UNUSED_PARAMETER(draw_mode);
+	UNUSED_PARAMETER(start_vert);
+	UNUSED_PARAMETER(num_verts);
+}
+
+void gs_draw_sprite(gs_texture_t *tex, uint32_t flip, uint32_t width,
+		    uint32_t height)
+{
+	graphics_call();
+	obs_stub_calls.draws++;
+
+	UNUSED_PARAMETER(flip);
+	if (!tex && (!width || !height))
+		blog(LOG_ERROR, "A sprite cannot be drawn without a width/"
+				"height");
+}
+
+void gs_clear(uint32_t clear_flags, const struct vec4 *color, float depth,
+	      uint8_t stencil)
+{
+	graphics_call();
+	UNUSED_PARAMETER(clear_flags);
+	UNUSED_PARAMETER(color);
+	UNUSED_PARAMETER(depth);
+	UNUSED_PARAMETER(stencil);
+}
+
+void gs_ortho(float left, float right, float top, float bottom, float znear,
+	      float zfar)
+{
+	graphics_call();
+	UNUSED_PARAMETER(left);
+	UNUSED_PARAMETER(right);
+	UNUSED_PARAMETER(top);
+	UNUSED_PARAMETER(bottom);
+	UNUSED_PARAMETER(znear);
+	UNUSED_PARAMETER(zfar);
+}
+
+void gs_blend_state_push(void)
+{
+	graphics_call();
+}
+
+void gs_blend_state_pop(void)
+{
+	graphics_call();
+}
+
+void gs_blend_function(enum gs_blend_type src, enum gs_blend_type dest)
+{
+	graphics_call();
+	UNUSED_PARAMETER(src);
+	UNUSED_PARAMETER(dest);
+}
+
+static bool framebuffer_srgb = false;
+
+bool gs_get_linear_srgb(void)
+{
+	graphics_call();
+	return false;
+}
+
+bool gs_framebuffer_srgb_enabled(void)
+{
+	graphics_call();
+	return framebuffer_srgb;
+}
+
+void gs_enable_framebuffer_srgb(bool enable)
+{
+	graphics_call();
+	framebuffer_srgb = enable;
+}
+
+void gs_viewport_push(void)
+{
+	graphics_call();
+}
+
+void gs_viewport_pop(void)
+{
+	graphics_call();
+}
+
+void gs_projection_push(void)
+{
+	graphics_call();
+}
+
+void gs_projection_pop(void)
+{
+	graphics_call();
+}
+
+void gs_set_viewport(int x, int y, int width, int height)
+{
+	graphics_call();
+	UNUSED_PARAMETER(x);
+	UNUSED_PARAMETER(y);
+	UNUSED_PARAMETER(width);
+	UNUSED_PARAMETER(height);
+}
+
+void gs_matrix_push(void)
+{
+	graphics_call();
+}
+
+void gs_matrix_pop(void)
+{
+	graphics_call();
+}
+
+void gs_matrix_translate(const struct vec3 *pos)
+{
+	graphics_call();
+	UNUSED_PARAMETER(pos);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Sources                                                                   */
+
+struct obs_source {
+	const struct obs_source_info *info;
+	std::string name;
+	obs_data_t *settings;
+	proc_handler_t procs;
+	void *data;
+	long refs;
+	bool enabled;
+
+	/* Filters are kept top first, as libobs keeps them */
+	std::vector<obs_source_t *> filters;
+	obs_source_t *filter_parent;
+	obs_source_t *filter_target;
+	gs_texrender_t *filter_texrender;
+	bool rendering_filter;
+};
+
+static std::vector<std::unique_ptr<struct obs_source_info>> source_types;
+static std::vector<obs_source_t *> sources;
+
+void obs_register_source_s(const struct obs_source_info *info, size_t size)
+{
+	struct obs_source_info *copy = new obs_source_info();
+	memcpy(copy, info, std::min(size, sizeof(*copy)));
+	source_types.emplace_back(copy);
+}
+
+static const struct obs_source_info *find_source_type(const char *id)
+{
+	for (auto &info : source_types) {
+		if (strcmp(info->id, id) == 0)
+			return info.get();
+	}
+	return nullptr;
+}
+
+obs_source_t *obs_source_create_private(const char *id, const char *name,
+					obs_data_t *settings)
+{
+	const struct obs_source_info *info = find_source_type(id);
+	if (!info) {
+		blog(LOG_ERROR, "Source ID '%s' not found", id);
+		return NULL;
+	}
+
+	obs_source_t *source = new obs_source();
+	source->info = info;
+	source->name = name ? name : "";
+	source->settings = obs_data_create();
+	source->refs = 1;
+	source->enabled = true;
+
+	if (info->get_defaults)
+		info->get_defaults(source->settings);
+	obs_data_apply(source->settings, settings);
+
+	source->data = info->create(source->settings, source);
+	if (!source->data) {
+		blog(LOG_ERROR, "Failed to create source '%s'!", name);
+		obs_data_release(source->settings);
+		delete source;
+		return NULL;
+	}
+
+	sources.push_back(source);
+	return source;
+}
+
+static void update_filter_targets(obs_source_t *source)
+{
+	for (size_t i = 0; i < source->filters.size(); i++)
+		source->filters[i]->filter_target =
+			i + 1 < source->filters.size() ? source->filters[i + 1]
+						       : source;
+}
+
+void obs_source_filter_add(obs_source_t *source, obs_source_t *filter)
+{
+	if (!source || !filter || filter->filter_parent)
+		return;
+
+	os_atomic_inc_long(&filter->refs);
+	filter->filter_parent = source;
+	source->filters.insert(source->filters.begin(), filter);
+	update_filter_targets(source);
+}
+
+void obs_source_filter_remove(obs_source_t *source, obs_source_t *filter)
+{
+	auto it = std::find(source->filters.begin(), source->filters.end(),
+			    filter);
+	if (it == source->filters.end())
+		return;
+
+	source->filters.erase(it);
+	update_filter_targets(source);
+
+	filter->filter_parent = NULL;
+	filter->filter_target = NULL;
+	obs_source_release(filter);
+}
+
+void obs_source_release(obs_source_t *source)
+{
+	if (!source || os_atomic_dec_long(&source->refs))
+		return;
+
+	while (!source->filters.empty())
+		obs_source_filter_remove(source, source->filters.front());
+
+	sources.erase(std::find(sources.begin(), sources.end(), source));
+	source->info->destroy(source->data);
+
+	obs_enter_graphics();
+	gs_texrender_destroy(source->filter_texrender);
+	obs_leave_graphics();
+
+	obs_data_release(source->settings);
+	delete source;
+}
+
+void obs_source_update(obs_source_t *source, obs_data_t *settings)
+{
+	obs_data_apply(source->settings, settings);
+	if (source->info->update)
+		source->info->update(source->data, source->settings);
+}
+
+obs_data_t *obs_source_get_settings(const obs_source_t *source)
+{
+	obs_data_addref(source->settings);
+	return source->settings;
+}
+
+const char *obs_source_get_name(const obs_source_t *source)
+{
+	return source ? source->name.c_str() : NULL;
+}
+
+const char *obs_source_get_id(const obs_source_t *source)
+{
+	return source ? source->info->id : NULL;
+}
+
+uint32_t obs_source_get_output_flags(const obs_source_t *source)
+{
+	return source ? source->info->output_flags : 0;
+}
+
+/* Filters here have no size of their own and take their target's */
+uint32_t obs_source_get_base_width(obs_source_t *source)
+{
+	if (!source)
+		return 0;
+	if (source->info->get_width)
+		return source->info->get_width(source->data);
+	return obs_source_get_base_width(source->filter_target);
+}
+
+uint32_t obs_source_get_base_height(obs_source_t *source)
+{
+	if (!source)
+		return 0;
+	if (source->info->get_height)
+		return source->info->get_height(source->data);
+	return obs_source_get_base_height(source->filter_target);
+}
+
+uint32_t obs_source_get_width(obs_source_t *source)
+{
+	if (source && !source->filters.empty())
+		return obs_source_get_base_width(source->filters.front());
+	return obs_source_get_base_width(source);
+}
+
+uint32_t obs_source_get_height(obs_source_t *source)
+{
+	if (source && !source->filters.empty())
+		return obs_source_get_base_height(source->filters.front());
+	return obs_source_get_base_height(source);
+}
+
+bool obs_source_enabled(const obs_source_t *source)
+{
+	return source && source->enabled;
+}
+
+void obs_source_set_enabled(obs_source_t *source, bool enabled)
+{
+	source->enabled = enabled;
+}
+
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source)
+{
+	return source ? (proc_handler_t *)&source->procs : NULL;
+}
+
+void *obs_obj_get_data(void *obj)
+{
+	return obj ? ((obs_source_t *)obj)->data : NULL;
+}
+
+obs_source_t *obs_filter_get_parent(const obs_source_t *filter)
+{
+	return filter ? filter->filter_parent : NULL;
+}
+
+obs_source_t *obs_filter_get_target(const obs_source_t *filter)
+{
+	return filter ? filter->filter_target : NULL;
+}
+
+void obs_source_default_render(obs_source_t *source)
+{
+	gs_effect_t *effect = obs_get_base_effect(OBS_EFFECT_DEFAULT);
+	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
+	size_t passes = gs_technique_begin(tech);
+
+	for (size_t i = 0; i < passes; i++) {
+		gs_technique_begin_pass(tech, i);
+		if (source->info->video_render)
+			source->info->video_render(source->data, effect);
+		gs_technique_end_pass(tech);
+	}
+
+	gs_technique_end(tech);
+}
+
+void obs_source_video_render(obs_source_t *source)
+{
+	if (!source)
+		return;
+
+	if (!source->filters.empty() && !source->rendering_filter) {
+		source->rendering_filter = true;
+		obs_source_video_render(source->filters.front());
+		source->rendering_filter = false;
+	} else if (source->info->type == OBS_SOURCE_TYPE_FILTER &&
+		   !source->enabled) {
+		obs_source_skip_video_filter(source);
+	} else if (source->info->video_render) {
+		source->info->video_render(source->data, current_effect);
+	}
+}
+
+static bool can_bypass(obs_source_t *target, obs_source_t *parent,
+		       uint32_t parent_flags,
+		       enum obs_allow_direct_render allow_direct)
+{
+	return target == parent && allow_direct == OBS_ALLOW_DIRECT_RENDERING &&
+	       (parent_flags & OBS_SOURCE_CUSTOM_DRAW) == 0 &&
+	       (parent_flags & OBS_SOURCE_ASYNC) == 0;
+}
+
+void obs_source_skip_video_filter(obs_source_t *filter)
+{
+	obs_source_t *target = obs_filter_get_target(filter);
+	obs_source_t *parent = obs_filter_get_parent(filter);
+
+	if (!target || !parent)
+		return;
+
+	uint32_t parent_flags = obs_source_get_output_flags(parent);
+
+	if (target == parent && can_bypass(target, parent, parent_flags,
+					   OBS_ALLOW_DIRECT_RENDERING))
+		obs_source_default_render(target);
+	else
+		obs_source_video_render(target);
+}
+
+/* The filter's own texrender is reset once per frame by obs_stub_tick */
+bool obs_source_process_filter_begin(obs_source_t *filter,
+				     enum gs_color_format format,
+				     enum obs_allow_direct_render allow_direct)
+{
+	obs_source_t *target = obs_filter_get_target(filter);
+	obs_source_t *parent = obs_filter_get_parent(filter);
+
+	if (!target || !parent)
+		return false;
+
+	uint32_t parent_flags = obs_source_get_output_flags(parent);
+	uint32_t cx = obs_source_get_base_width(target);
+	uint32_t cy = obs_source_get_base_height(target);
+
+	if (!cx || !cy) {
+		obs_source_skip_video_filter(filter);
+		return false;
+	}
+
+	if (can_bypass(target, parent, parent_flags, allow_direct))
+		return true;
+
+	if (!filter->filter_texrender)
+		filter->filter_texrender =
+			gs_texrender_create(format, GS_ZS_NONE);
+
+	gs_blend_state_push();
+	gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
+
+	if (gs_texrender_begin(filter->filter_texrender, cx, cy)) {
+		struct vec4 clear_color;
+
+		vec4_zero(&clear_color);
+		gs_clear(GS_CLEAR_COLOR, &clear_color, 0.0f, 0);
+		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+
+		if (target == parent &&
+		    can_bypass(target, parent, parent_flags,
+			       OBS_ALLOW_DIRECT_RENDERING))
+			obs_source_default_render(target);
+		else
+			obs_source_video_render(target);
+
+		gs_texrender_end(filter->filter_texrender);
+	}
+
+	gs_blend_state_pop();
+	return true;
+}
+
+void obs_source_process_filter_end(obs_source_t *filter, gs_effect_t *effect,
+				   uint32_t width, uint32_t height)
+{
+	obs_source_t *target = obs_filter_get_target(filter);
+	obs_source_t *parent = obs_filter_get_parent(filter);
+
+	if (!target || !parent)
+		return;
+
+	gs_technique_t *tech = gs_effect_get_technique(effect, "Draw");
+	gs_texture_t *texture = NULL;
+	size_t passes;
+
+	if (!can_bypass(target, parent, obs_source_get_output_flags(parent),
+			OBS_ALLOW_DIRECT_RENDERING)) {
+		texture = gs_texrender_get_texture(filter->filter_texrender);
+		if (!texture)
+			return;
+
+		gs_effect_set_texture(
+			gs_effect_get_param_by_name(effect, "image"), texture);
+	}
+
+	passes = gs_technique_begin(tech);
+	for (size_t i = 0; i < passes; i++) {
+		gs_technique_begin_pass(tech, i);
+		if (texture)
+			gs_draw_sprite(texture, 0, width, height);
+		else
+			obs_source_video_render(target);
+		gs_technique_end_pass(tech);
+	}
+	gs_technique_end(tech);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Core                                                                      */
+
+#define STUB_FPS 30
+
+static uint64_t video_frame_time = 0;
+
+struct tick_callback {
+	void (*tick)(void *param, float seconds);
+	void *param;
+};
+
+static std::vector<tick_callback> tick_callbacks;
+
+bool obs_get_video_info(struct obs_video_info *ovi)
+{
+	memset(ovi, 0, sizeof(*ovi));
+	ovi->graphics_module = "stub";
+	ovi->fps_num = STUB_FPS;
+	ovi->fps_den = 1;
+	ovi->base_width = ovi->output_width = 1920;
+	ovi->base_height = ovi->output_height = 1080;
+	return true;
+}
+
+uint64_t obs_get_video_frame_time(void)
+{
+	return video_frame_time;
+}
+
+/* An idle GPU: adaptive quality never comes under pressure */
+uint64_t obs_get_average_frame_time_ns(void)
+{
+	return 0;
+}
+
+void obs_add_tick_callback(void (*tick)(void *param, float seconds),
+			   void *param)
+{
+	tick_callbacks.push_back({tick, param});
+}
+
+void obs_remove_tick_callback(void (*tick)(void *param, float seconds),
+			      void *param)
+{
+	for (auto it = tick_callbacks.begin(); it != tick_callbacks.end();
+	     ++it) {
+		if (it->tick == tick && it->param == param) {
+			tick_callbacks.erase(it);
+			return;
+		}
+	}
+}
+
+void obs_stub_tick(float seconds)
+{
+	video_frame_time += (uint64_t)(seconds * 1000000000.0);
+
+	std::vector<tick_callback> callbacks = tick_callbacks;
+	for (auto &callback : callbacks)
+		callback.tick(callback.param, seconds);
+
+	std::vector<obs_source_t *> ticked = sources;
+	for (obs_source_t *source : ticked) {
+		if (source->filter_texrender) {
+			obs_enter_graphics();
+			gs_texrender_reset(source->filter_texrender);
+			obs_leave_graphics();
+		}
+		if (source->info->video_tick)
+			source->info->video_tick(source->data, seconds);
+	}
+}
+
+void obs_stub_render(obs_source_t *source)
+{
+	obs_enter_graphics();
+	obs_source_video_render(source);
+	obs_leave_graphics();
+}
+
+/* ------------------------------------------------------------------------- */
+/* Input                                                                     */
+
+struct stub_input {
+	uint32_t cx, cy;
+	gs_texture_t *texture;
+};
+
+static void stub_input_resize(struct stub_input *input, uint32_t cx,
+			      uint32_t cy)
+{
+	obs_enter_graphics();
+	gs_texture_destroy(input->texture);
+	input->texture = gs_texture_create(cx, cy, GS_RGBA, 1, NULL, 0);
+	obs_leave_graphics();
+
+	input->cx = cx;
+	input->cy = cy;
+}
+
+static void *stub_input_create(obs_data_t *settings, obs_source_t *source)
+{
+	struct stub_input *input = new stub_input();
+
+	stub_input_resize(input, (uint32_t)obs_data_get_int(settings, "width"),
+			  (uint32_t)obs_data_get_int(settings, "height"));
+
+	UNUSED_PARAMETER(source);
+	return input;
+}
+
+static void stub_input_destroy(void *data)
+{
+	struct stub_input *input = (struct stub_input *)data;
+
+	obs_enter_graphics();
+	gs_texture_destroy(input->texture);
+	obs_leave_graphics();
+	delete input;
+}
+
+static uint32_t stub_input_width(void *data)
+{
+	return ((struct stub_input *)data)->cx;
+}
+
+static uint32_t stub_input_height(void *data)
+{
+	return ((struct stub_input *)data)->cy;
+}
+
+/* As obs_source_draw does for image sources */
+static void stub_input_render(void *data, gs_effect_t *effect)
+{
+	struct stub_input *input = (struct stub_input *)data;
+
+	gs_effect_set_texture(gs_effect_get_param_by_name(effect, "image"),
+			      input->texture);
+	gs_draw_sprite(input->texture, 0, input->cx, input->cy);
+}
+
+obs_source_t *obs_stub_input_create(const char *name, uint32_t cx,
+				    uint32_t cy)
+{
+	if (!find_source_type(OBS_STUB_INPUT_ID)) {
+		struct obs_source_info info = {};
+
+		info.id = OBS_STUB_INPUT_ID;
+		info.type = OBS_SOURCE_TYPE_INPUT;
+		info.output_flags = OBS_SOURCE_VIDEO;
+		info.create = stub_input_create;
+		info.destroy = stub_input_destroy;
+		info.get_width = stub_input_width;
+		info.get_height = stub_input_height;
+		info.video_render = stub_input_render;
+		obs_register_source(&info);
+	}
+
+	obs_data_t *settings = obs_data_create();
+	obs_data_set_int(settings, "width", cx);
+	obs_data_set_int(settings, "height", cy);
+
+	obs_source_t *input =
+		obs_source_create_private(OBS_STUB_INPUT_ID, name, settings);
+	obs_data_release(settings);
+	return input;
+}
+
+void obs_stub_input_resize(obs_source_t *input, uint32_t cx, uint32_t cy)
+{
+	stub_input_resize((struct stub_input *)input->data, cx, cy);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <obs.h>
+
+/* Call-counting stand-in for the libobs graphics and source API the
+ * filters use, so their per-frame costs can be checked on a machine with
+ * no GPU.  Nothing is drawn: textures and render targets are just sizes,
+ * stage surfaces read back as zeros and timer queries as zero time.
+ * Everything else behaves the way libobs does as far as the filters can
+ * tell, including the filter chain, direct rendering and the
+ * texrender reset rules, and effects only know the uniforms and techniques
+ * declared in their source.
+ *
+ * Counters only ever go up; tests reset them around the frames they
+ * measure. */
+struct obs_stub_calls {
+	long texture_creates; /* gs_texture_create, render targets included */
+	long texrender_creates;
+	long texrender_begins;
+	long stagesurface_creates;
+	long texture_copies; /* gs_copy_texture and gs_copy_texture_region */
+	long texture_maps; /* gs_texture_map */
+	long texture_stages; /* gs_stage_texture */
+	long vertexbuffer_creates;
+	long vertexbuffer_flushes;
+	long effect_creates;
+	long draws; /* gs_draw and gs_draw_sprite */
+	long param_sets; /* every gs_effect_set_* */
+
+	/* Graphics calls made without obs_enter_graphics */
+	long outside_graphics;
+	/* Messages logged at LOG_WARNING or above */
+	long warnings;
+};
+
+extern struct obs_stub_calls obs_stub_calls;
+
+void obs_stub_reset_calls(void);
+
+/* An input of a fixed size that draws its texture with one sprite, the
+ * way an image source does.  Its texture is created with it. */
+#define OBS_STUB_INPUT_ID "obs_stub_input"
+
+obs_source_t *obs_stub_input_create(const char *name, uint32_t cx,
+				    uint32_t cy);
+void obs_stub_input_resize(obs_source_t *input, uint32_t cx, uint32_t cy);
+
+/* One video frame: advances the video clock, runs the tick callbacks,
+ * then ticks every source as libobs' video thread does */
+void obs_stub_tick(float seconds);
+
+/* Renders `source` and its filters from within the graphics context */
+void obs_stub_render(obs_source_t *source);
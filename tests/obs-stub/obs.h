@@ -0,0 +1,271 @@
+#pragma once
+
+/* Stand-in for the parts of libobs the filters use, declared the way
+ * libobs declares them.  See obs-stub.hpp for what the stub does. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "graphics/graphics.h"
+#include "util/bmem.h"
+#include "util/calldata.h"
+#include "util/profiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UNUSED_PARAMETER(param) (void)param
+
+#define LOG_ERROR 100
+#define LOG_WARNING 200
+#define LOG_INFO 300
+#define LOG_DEBUG 400
+
+void blog(int log_level, const char *format, ...);
+
+struct obs_source;
+struct obs_data;
+struct obs_data_array;
+struct obs_properties;
+struct obs_property;
+struct proc_handler;
+
+typedef struct obs_source obs_source_t;
+typedef struct obs_data obs_data_t;
+typedef struct obs_data_array obs_data_array_t;
+typedef struct obs_properties obs_properties_t;
+typedef struct obs_property obs_property_t;
+typedef struct proc_handler proc_handler_t;
+
+/* Data */
+obs_data_t *obs_data_create(void);
+void obs_data_addref(obs_data_t *data);
+void obs_data_release(obs_data_t *data);
+const char *obs_data_get_json(obs_data_t *data);
+void obs_data_apply(obs_data_t *target, obs_data_t *apply_data);
+
+void obs_data_set_string(obs_data_t *data, const char *name, const char *val);
+void obs_data_set_int(obs_data_t *data, const char *name, long long val);
+void obs_data_set_double(obs_data_t *data, const char *name, double val);
+void obs_data_set_bool(obs_data_t *data, const char *name, bool val);
+void obs_data_set_obj(obs_data_t *data, const char *name, obs_data_t *obj);
+void obs_data_set_array(obs_data_t *data, const char *name,
+			obs_data_array_t *array);
+
+void obs_data_set_default_string(obs_data_t *data, const char *name,
+				 const char *val);
+void obs_data_set_default_int(obs_data_t *data, const char *name,
+			      long long val);
+void obs_data_set_default_double(obs_data_t *data, const char *name,
+				 double val);
+void obs_data_set_default_bool(obs_data_t *data, const char *name, bool val);
+
+const char *obs_data_get_string(obs_data_t *data, const char *name);
+long long obs_data_get_int(obs_data_t *data, const char *name);
+double obs_data_get_double(obs_data_t *data, const char *name);
+bool obs_data_get_bool(obs_data_t *data, const char *name);
+obs_data_array_t *obs_data_get_array(obs_data_t *data, const char *name);
+bool obs_data_has_user_value(obs_data_t *data, const char *name);
+
+obs_data_array_t *obs_data_array_create(void);
+void obs_data_array_release(obs_data_array_t *array);
+size_t obs_data_array_count(obs_data_array_t *array);
+obs_data_t *obs_data_array_item(obs_data_array_t *array, size_t idx);
+size_t obs_data_array_push_back(obs_data_array_t *array, obs_data_t *obj);
+
+/* Properties */
+enum obs_combo_type {
+	OBS_COMBO_TYPE_INVALID,
+	OBS_COMBO_TYPE_EDITABLE,
+	OBS_COMBO_TYPE_LIST,
+};
+
+enum obs_combo_format {
+	OBS_COMBO_FORMAT_INVALID,
+	OBS_COMBO_FORMAT_INT,
+	OBS_COMBO_FORMAT_FLOAT,
+	OBS_COMBO_FORMAT_STRING,
+};
+
+enum obs_path_type {
+	OBS_PATH_FILE,
+	OBS_PATH_FILE_SAVE,
+	OBS_PATH_DIRECTORY,
+};
+
+typedef bool (*obs_property_clicked_t)(obs_properties_t *props,
+				       obs_property_t *property, void *data);
+
+obs_properties_t *obs_properties_create(void);
+void obs_properties_destroy(obs_properties_t *props);
+obs_property_t *obs_properties_get(obs_properties_t *props,
+				   const char *property);
+
+obs_property_t *obs_properties_add_bool(obs_properties_t *props,
+					const char *name,
+					const char *description);
+obs_property_t *obs_properties_add_int_slider(obs_properties_t *props,
+					      const char *name,
+					      const char *description,
+					      int min, int max, int step);
+obs_property_t *obs_properties_add_float_slider(obs_properties_t *props,
+						const char *name,
+						const char *description,
+						double min, double max,
+						double step);
+obs_property_t *obs_properties_add_path(obs_properties_t *props,
+					const char *name,
+					const char *description,
+					enum obs_path_type type,
+					const char *filter,
+					const char *default_path);
+obs_property_t *obs_properties_add_list(obs_properties_t *props,
+					const char *name,
+					const char *description,
+					enum obs_combo_type type,
+					enum obs_combo_format format);
+obs_property_t *obs_properties_add_color(obs_properties_t *props,
+					 const char *name,
+					 const char *description);
+obs_property_t *obs_properties_add_button(obs_properties_t *props,
+					  const char *name, const char *text,
+					  obs_property_clicked_t callback);
+
+size_t obs_property_list_add_string(obs_property_t *p, const char *name,
+				    const char *val);
+size_t obs_property_list_add_int(obs_property_t *p, const char *name,
+				 long long val);
+void obs_property_set_description(obs_property_t *p,
+				  const char *description);
+void obs_property_set_long_description(obs_property_t *p,
+				       const char *long_description);
+
+/* Procedures */
+typedef void (*proc_handler_proc_t)(void *data, calldata_t *cd);
+
+void proc_handler_add(proc_handler_t *handler, const char *decl_string,
+		      proc_handler_proc_t proc, void *data);
+bool proc_handler_call(proc_handler_t *handler, const char *name,
+		       calldata_t *params);
+
+/* Sources */
+enum obs_source_type {
+	OBS_SOURCE_TYPE_INPUT,
+	OBS_SOURCE_TYPE_FILTER,
+	OBS_SOURCE_TYPE_TRANSITION,
+	OBS_SOURCE_TYPE_SCENE,
+};
+
+enum obs_allow_direct_render {
+	OBS_NO_DIRECT_RENDERING,
+	OBS_ALLOW_DIRECT_RENDERING,
+};
+
+enum obs_base_effect {
+	OBS_EFFECT_DEFAULT,
+	OBS_EFFECT_DEFAULT_RECT,
+	OBS_EFFECT_OPAQUE,
+	OBS_EFFECT_SOLID,
+};
+
+#define OBS_SOURCE_VIDEO (1 << 0)
+#define OBS_SOURCE_AUDIO (1 << 1)
+#define OBS_SOURCE_ASYNC (1 << 2)
+#define OBS_SOURCE_ASYNC_VIDEO (OBS_SOURCE_ASYNC | OBS_SOURCE_VIDEO)
+#define OBS_SOURCE_CUSTOM_DRAW (1 << 3)
+
+#define MAX_AV_PLANES 8
+
+struct obs_source_frame {
+	uint8_t *data[MAX_AV_PLANES];
+	uint32_t linesize[MAX_AV_PLANES];
+	uint32_t width;
+	uint32_t height;
+	uint64_t timestamp;
+};
+
+struct obs_source_info {
+	const char *id;
+	enum obs_source_type type;
+	uint32_t output_flags;
+
+	const char *(*get_name)(void *type_data);
+	void *(*create)(obs_data_t *settings, obs_source_t *source);
+	void (*destroy)(void *data);
+	uint32_t (*get_width)(void *data);
+	uint32_t (*get_height)(void *data);
+	void (*get_defaults)(obs_data_t *settings);
+	obs_properties_t *(*get_properties)(void *data);
+	void (*update)(void *data, obs_data_t *settings);
+	void (*video_tick)(void *data, float seconds);
+	void (*video_render)(void *data, gs_effect_t *effect);
+	struct obs_source_frame *(*filter_video)(
+		void *data, struct obs_source_frame *frame);
+};
+
+void obs_register_source_s(const struct obs_source_info *info,
+			   size_t size);
+
+#define obs_register_source(info) \
+	obs_register_source_s(info, sizeof(struct obs_source_info))
+
+obs_source_t *obs_source_create_private(const char *id, const char *name,
+					obs_data_t *settings);
+void obs_source_release(obs_source_t *source);
+void obs_source_update(obs_source_t *source, obs_data_t *settings);
+obs_data_t *obs_source_get_settings(const obs_source_t *source);
+const char *obs_source_get_name(const obs_source_t *source);
+const char *obs_source_get_id(const obs_source_t *source);
+uint32_t obs_source_get_output_flags(const obs_source_t *source);
+uint32_t obs_source_get_width(obs_source_t *source);
+uint32_t obs_source_get_height(obs_source_t *source);
+uint32_t obs_source_get_base_width(obs_source_t *source);
+uint32_t obs_source_get_base_height(obs_source_t *source);
+bool obs_source_enabled(const obs_source_t *source);
+void obs_source_set_enabled(obs_source_t *source, bool enabled);
+proc_handler_t *obs_source_get_proc_handler(const obs_source_t *source);
+void *obs_obj_get_data(void *obj);
+
+void obs_source_filter_add(obs_source_t *source, obs_source_t *filter);
+void obs_source_filter_remove(obs_source_t *source, obs_source_t *filter);
+obs_source_t *obs_filter_get_parent(const obs_source_t *filter);
+obs_source_t *obs_filter_get_target(const obs_source_t *filter);
+
+void obs_source_video_render(obs_source_t *source);
+void obs_source_default_render(obs_source_t *source);
+void obs_source_skip_video_filter(obs_source_t *filter);
+bool obs_source_process_filter_begin(obs_source_t *filter,
+				     enum gs_color_format format,
+				     enum obs_allow_direct_render allow_direct);
+void obs_source_process_filter_end(obs_source_t *filter, gs_effect_t *effect,
+				   uint32_t width, uint32_t height);
+
+/* Core */
+struct obs_video_info {
+	const char *graphics_module;
+	uint32_t fps_num;
+	uint32_t fps_den;
+	uint32_t base_width;
+	uint32_t base_height;
+	uint32_t output_width;
+	uint32_t output_height;
+};
+
+bool obs_get_video_info(struct obs_video_info *ovi);
+uint64_t obs_get_video_frame_time(void);
+uint64_t obs_get_average_frame_time_ns(void);
+
+void obs_enter_graphics(void);
+void obs_leave_graphics(void);
+gs_effect_t *obs_get_base_effect(enum obs_base_effect effect);
+
+void obs_add_tick_callback(void (*tick)(void *param, float seconds),
+			   void *param);
+void obs_remove_tick_callback(void (*tick)(void *param, float seconds),
+			      void *param);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *bmalloc(size_t size);
+void *brealloc(void *ptr, size_t size);
+void bfree(void *ptr);
+char *bstrdup(const char *str);
+
+static inline void *bzalloc(size_t size)
+{
+	void *mem = bmalloc(size);
+	if (mem)
+		memset(mem, 0, size);
+	return mem;
+}
+
+#ifdef __cplusplus
+}
+#endif
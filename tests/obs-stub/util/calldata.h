@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same fields as libobs' calldata; the stub keeps its values elsewhere */
+struct calldata {
+	uint8_t *stack;
+	size_t size;
+	size_t capacity;
+	bool fixed;
+};
+
+typedef struct calldata calldata_t;
+
+static inline void calldata_init(calldata_t *data)
+{
+	data->stack = NULL;
+	data->size = 0;
+	data->capacity = 0;
+	data->fixed = false;
+}
+
+void calldata_free(calldata_t *data);
+
+long long calldata_int(const calldata_t *data, const char *name);
+double calldata_float(const calldata_t *data, const char *name);
+bool calldata_bool(const calldata_t *data, const char *name);
+const char *calldata_string(const calldata_t *data, const char *name);
+
+void calldata_set_int(calldata_t *data, const char *name, long long val);
+void calldata_set_float(calldata_t *data, const char *name, double val);
+void calldata_set_bool(calldata_t *data, const char *name, bool val);
+void calldata_set_string(calldata_t *data, const char *name,
+			 const char *str);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string.h>
+#include "bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Same layout and growth as libobs' darray, for the subset the plugin
+ * uses */
+struct darray {
+	void *array;
+	size_t num;
+	size_t capacity;
+};
+
+#define DARRAY(type)                     \
+	union {                          \
+		struct darray da;        \
+		struct {                 \
+			type *array;     \
+			size_t num;      \
+			size_t capacity; \
+		};                       \
+	}
+
+static inline void darray_free(struct darray *dst)
+{
+	bfree(dst->array);
+	dst->array = NULL;
+	dst->num = 0;
+	dst->capacity = 0;
+}
+
+static inline void darray_ensure_capacity(const size_t element_size,
+					  struct darray *dst,
+					  const size_t new_size)
+{
+	if (new_size <= dst->capacity)
+		return;
+
+	size_t capacity = dst->capacity ? dst->capacity * 2 : new_size;
+	if (capacity < new_size)
+		capacity = new_size;
+
+	dst->array = brealloc(dst->array, element_size * capacity);
+	dst->capacity = capacity;
+}
+
+static inline void *darray_push_back_new(const size_t element_size,
+					 struct darray *dst)
+{
+	darray_ensure_capacity(element_size, dst, dst->num + 1);
+
+	void *item = (char *)dst->array + element_size * dst->num++;
+	memset(item, 0, element_size);
+	return item;
+}
+
+static inline size_t darray_push_back(const size_t element_size,
+				      struct darray *dst, const void *item)
+{
+	darray_ensure_capacity(element_size, dst, dst->num + 1);
+	memcpy((char *)dst->array + element_size * dst->num, item,
+	       element_size);
+	return dst->num++;
+}
+
+static inline void darray_erase(const size_t element_size, struct darray *dst,
+				const size_t idx)
+{
+	if (idx >= dst->num)
+		return;
+
+	char *item = (char *)dst->array + element_size * idx;
+	memmove(item, item + element_size,
+		element_size * (dst->num - idx - 1));
+	dst->num--;
+}
+
+#define da_init(v) memset(&(v), 0, sizeof(v))
+#define da_free(v) darray_free(&(v).da)
+#define da_push_back(v, item) \
+	darray_push_back(sizeof(*(v).array), &(v).da, item)
+#define da_push_back_new(v) darray_push_back_new(sizeof(*(v).array), &(v).da)
+#define da_erase(v, idx) darray_erase(sizeof(*(v).array), &(v).da, idx)
+
+#ifdef __cplusplus
+}
+#endif
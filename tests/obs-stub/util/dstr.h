@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dstr {
+	char *array;
+	size_t len;
+	size_t capacity;
+};
+
+void dstr_free(struct dstr *dst);
+void dstr_copy(struct dstr *dst, const char *array);
+void dstr_cat(struct dstr *dst, const char *array);
+void dstr_catf(struct dstr *dst, const char *format, ...);
+
+#ifdef __cplusplus
+}
+#endif
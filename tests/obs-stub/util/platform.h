@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include "bmem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t os_gettime_ns(void);
+FILE *os_fopen(const char *path, const char *mode);
+int os_unlink(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void profile_start(const char *name);
+void profile_end(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
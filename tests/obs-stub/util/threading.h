@@ -0,0 +1,57 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline long os_atomic_inc_long(volatile long *val)
+{
+	return __atomic_add_fetch(val, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline long os_atomic_dec_long(volatile long *val)
+{
+	return __atomic_sub_fetch(val, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline long os_atomic_set_long(volatile long *ptr, long val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline long os_atomic_load_long(const volatile long *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline bool os_atomic_set_bool(volatile bool *ptr, bool val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+static inline bool os_atomic_load_bool(const volatile bool *ptr)
+{
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline bool os_atomic_exchange_bool(volatile bool *ptr, bool val)
+{
+	return __atomic_exchange_n(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+struct os_sem_data;
+typedef struct os_sem_data os_sem_t;
+
+int os_sem_init(os_sem_t **sem, int value);
+void os_sem_destroy(os_sem_t *sem);
+int os_sem_post(os_sem_t *sem);
+int os_sem_wait(os_sem_t *sem);
+
+void os_set_thread_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
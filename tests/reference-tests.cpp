@@ -0,0 +1,479 @@
+/* Golden-image tests for the CPU reference kernels.  Every case runs one
+ * kernel over a synthetic input and compares the result, through each
+ * path the build supports, against an image stored in the golden
+ * directory.  Nothing here needs libobs or a GPU.
+ *
+ *   filter-pack-reference-tests <golden dir> [--update] [case prefix...]
+ *
+ * --update rewrites the golden images from the scalar path.  Only do that
+ * after checking that a change in the output is intended. */
+
+#include "reference-kernels.hpp"
+#include "lens-distortion-filter.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Golden images are stored with 8 bits per channel, which alone is worth
+ * half a step of error; the rest is left for float rounding and libm
+ * differences between platforms. */
+#define GOLDEN_TOLERANCE (1.5f / 255.0f)
+#define GOLDEN_MAX_FRACTION 0.001
+
+/* ------------------------------------------------------------------------- */
+/* Images                                                                     */
+
+static inline float quantize(float v)
+{
+	v = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	return floorf(v * 255.0f + 0.5f) / 255.0f;
+}
+
+/* Smooth color ramps under a soft-edged disc of alpha, with a one texel
+ * checkerboard in one corner and a transparent margin, so that filtering,
+ * the alpha edge and the border all show up in the output.  Values are
+ * quantized the way an 8 bit texture would hold them. */
+static bool make_input(struct ref_image *img, uint32_t width, uint32_t height)
+{
+	if (!ref_image_init(img, width, height))
+		return false;
+
+	float cx = (float)width * 0.5f;
+	float cy = (float)height * 0.5f;
+	float radius = (float)(width < height ? width : height) * 0.4f;
+
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			float *p = ref_image_pixel(img, x, y);
+			float fx = (float)x + 0.5f, fy = (float)y + 0.5f;
+			float d = sqrtf((fx - cx) * (fx - cx) +
+					(fy - cy) * (fy - cy));
+			float a = (radius - d) / 3.0f + 0.5f;
+
+			p[0] = fx / (float)width;
+			p[1] = fy / (float)height;
+			p[2] = 0.5f + 0.5f * sinf(fx * 0.4f) * cosf(fy * 0.3f);
+			p[3] = a;
+
+			if (x < width / 4 && y < height / 4) {
+				float c = (x + y) & 1 ? 1.0f : 0.0f;
+				p[0] = p[1] = p[2] = c;
+				p[3] = 1.0f;
+			}
+			if (x < 2 || y < 2 || x + 2 >= width || y + 2 >= height)
+				p[3] = 0.0f;
+
+			for (int i = 0; i < 4; i++)
+				p[i] = quantize(p[i]);
+		}
+	}
+
+	return true;
+}
+
+/* Binary PAM (P7), RGB_ALPHA with 8 bits per channel */
+static bool write_pam(const char *path, const struct ref_image *img)
+{
+	FILE *file = fopen(path, "wb");
+	if (!file)
+		return false;
+
+	fprintf(file,
+		"P7\nWIDTH %u\nHEIGHT %u\nDEPTH 4\nMAXVAL 255\n"
+		"TUPLTYPE RGB_ALPHA\nENDHDR\n",
+		img->width, img->height);
+
+	size_t channels = (size_t)img->width * img->height * 4;
+	bool ok = true;
+
+	for (size_t i = 0; ok && i < channels; i++) {
+		int v = (int)(quantize(img->data[i]) * 255.0f + 0.5f);
+		ok = fputc(v, file) != EOF;
+	}
+
+	return fclose(file) == 0 && ok;
+}
+
+static bool read_pam(const char *path, struct ref_image *img)
+{
+	FILE *file = fopen(path, "rb");
+	unsigned width = 0, height = 0, depth = 0, maxval = 0;
+	char line[64];
+	bool ok = false;
+
+	if (!file)
+		return false;
+
+	if (!fgets(line, sizeof(line), file) || strcmp(line, "P7\n") != 0)
+		goto done;
+
+	while (fgets(line, sizeof(line), file)) {
+		if (strcmp(line, "ENDHDR\n") == 0) {
+			ok = true;
+			break;
+		}
+
+		sscanf(line, "WIDTH %u", &width);
+		sscanf(line, "HEIGHT %u", &height);
+		sscanf(line, "DEPTH %u", &depth);
+		sscanf(line, "MAXVAL %u", &maxval);
+	}
+
+	ok = ok && depth == 4 && maxval == 255 &&
+	     ref_image_init(img, width, height);
+
+	for (size_t i = 0; ok && i < (size_t)width * height * 4; i++) {
+		int v = fgetc(file);
+		ok = v != EOF;
+		img->data[i] = (float)v / 255.0f;
+	}
+
+done:
+	fclose(file);
+	return ok;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Cases                                                                      */
+
+enum test_kernel {
+	KERNEL_CORNER_PIN,
+	KERNEL_LENS_DISTORTION,
+	KERNEL_STROKE,
+};
+
+struct test_case {
+	const char *name;
+	enum test_kernel kernel;
+	uint32_t width, height;
+	struct ref_corner_pin_params corner_pin;
+	struct ref_lens_distortion_params lens_distortion;
+	struct ref_stroke_params stroke;
+};
+
+/* Corners in the order of ref_corner_pin_params::uv.  Like the shader,
+ * invBilinear has no solution for an exact parallelogram other than one
+ * pinned to the left edge, so the inset quad is slightly off square. */
+#define QUAD_SKEW \
+	{ {0.1f, 0.05f}, {0.95f, 0.2f}, {0.0f, 0.9f}, {0.8f, 1.0f} }
+#define QUAD_INSET \
+	{ {0.25f, 0.25f}, {0.75f, 0.3f}, {0.2f, 0.75f}, {0.75f, 0.75f} }
+
+#define CORNER_PIN(name, quad, quality)                                  \
+	{                                                                \
+		name, KERNEL_CORNER_PIN, 64, 48, {quad, quality}, {}, {} \
+	}
+#define LENS(name, width, height, strength, zoom, horizontal, quality)   \
+	{                                                                \
+		name, KERNEL_LENS_DISTORTION, width, height, {},         \
+			{strength, zoom, horizontal, quality}, {}        \
+	}
+#define STROKE(name, r, g, b, a, stroke_width)                          \
+	{                                                               \
+		name, KERNEL_STROKE, 64, 48, {}, {},                    \
+			{{r, g, b, a}, stroke_width}                    \
+	}
+
+static const struct test_case cases[] = {
+	CORNER_PIN("corner_pin_skew_single", QUAD_SKEW, REF_QUALITY_SINGLE),
+	CORNER_PIN("corner_pin_skew_rgss", QUAD_SKEW, REF_QUALITY_RGSS),
+	CORNER_PIN("corner_pin_skew_9tap", QUAD_SKEW, REF_QUALITY_9TAP),
+	CORNER_PIN("corner_pin_skew_bicubic", QUAD_SKEW,
+		   REF_QUALITY_BICUBIC),
+	CORNER_PIN("corner_pin_inset_single", QUAD_INSET, REF_QUALITY_SINGLE),
+	CORNER_PIN("corner_pin_inset_bicubic", QUAD_INSET,
+		   REF_QUALITY_BICUBIC),
+
+	LENS("lens_distortion_barrel_single", 64, 48, 1.0f, 1.0f, false,
+	     REF_QUALITY_SINGLE),
+	LENS("lens_distortion_barrel_rgss", 64, 48, 1.0f, 1.0f, false,
+	     REF_QUALITY_RGSS),
+	LENS("lens_distortion_barrel_9tap", 64, 48, 1.0f, 1.0f, false,
+	     REF_QUALITY_9TAP),
+	LENS("lens_distortion_barrel_bicubic", 64, 48, 1.0f, 1.0f, false,
+	     REF_QUALITY_BICUBIC),
+	LENS("lens_distortion_pincushion_horizontal", 64, 48, -0.3f, 0.995f,
+	     true, REF_QUALITY_SINGLE),
+	LENS("lens_distortion_wide_neutral", 128, 48, 0.0f, 1.0f, false,
+	     REF_QUALITY_SINGLE),
+
+	STROKE("stroke_opaque_1", 1.0f, 0.5f, 0.0f, 1.0f, 1),
+	STROKE("stroke_opaque_4", 1.0f, 0.5f, 0.0f, 1.0f, 4),
+	STROKE("stroke_translucent_3", 0.0f, 0.25f, 1.0f, 0.5f, 3),
+};
+
+static bool run_kernel(const struct test_case *test, struct ref_image *dst,
+		       const struct ref_image *src, enum ref_path path)
+{
+	switch (test->kernel) {
+	case KERNEL_CORNER_PIN:
+		return ref_corner_pin(dst, src, &test->corner_pin, path);
+	case KERNEL_LENS_DISTORTION:
+		return ref_lens_distortion(dst, src, &test->lens_distortion);
+	case KERNEL_STROKE:
+		return ref_stroke(dst, src, &test->stroke, path);
+	}
+
+	return false;
+}
+
+/* The filters render into 8 bit targets, which clamp what overshoots, as
+ * bicubic sampling does next to hard edges */
+static void clamp_output(struct ref_image *img)
+{
+	size_t channels = (size_t)img->width * img->height * 4;
+
+	for (size_t i = 0; i < channels; i++) {
+		float v = img->data[i];
+		img->data[i] = v < 0.0f ? 0.0f : (v > 1.0f ? 1.0f : v);
+	}
+}
+
+static const char *path_name(enum ref_path path)
+{
+	return path == REF_PATH_SSE2 ? "sse2" : "scalar";
+}
+
+static bool run_case(const struct test_case *test, const char *golden_dir,
+		     bool update)
+{
+	struct ref_image src = {};
+	struct ref_image golden = {};
+	char file[512];
+	bool ok = true;
+
+	snprintf(file, sizeof(file), "%s/%s.pam", golden_dir, test->name);
+
+	if (!make_input(&src, test->width, test->height)) {
+		printf("FAIL %s: out of memory\n", test->name);
+		return false;
+	}
+
+	if (!update && !read_pam(file, &golden)) {
+		printf("FAIL %s: could not read '%s'\n", test->name, file);
+		ref_image_free(&src);
+		return false;
+	}
+
+	for (int p = REF_PATH_SCALAR; p <= REF_PATH_SSE2; p++) {
+		enum ref_path path = (enum ref_path)p;
+		struct ref_image dst = {};
+		struct ref_diff diff;
+
+		if (!ref_path_supported(path))
+			continue;
+
+		if (!ref_image_init(&dst, test->width, test->height) ||
+		    !run_kernel(test, &dst, &src, path)) {
+			printf("FAIL %s (%s): kernel failed\n", test->name,
+			       path_name(path));
+			ok = false;
+			ref_image_free(&dst);
+			continue;
+		}
+
+		clamp_output(&dst);
+
+		if (update) {
+			if (path == REF_PATH_SCALAR && !write_pam(file, &dst)) {
+				printf("FAIL %s: could not write '%s'\n",
+				       test->name, file);
+				ok = false;
+			}
+		} else if (!ref_image_compare(&golden, &dst, GOLDEN_TOLERANCE,
+					      GOLDEN_MAX_FRACTION, &diff)) {
+			printf("FAIL %s (%s): %llu channels off by more than "
+			       "%g, max %g at %u,%u\n",
+			       test->name, path_name(path),
+			       (unsigned long long)diff.over_tolerance,
+			       GOLDEN_TOLERANCE, diff.max_error, diff.worst_x,
+			       diff.worst_y);
+			ok = false;
+		}
+
+		ref_image_free(&dst);
+	}
+
+	if (ok)
+		printf("%s %s\n", update ? "WROTE" : "PASS", test->name);
+
+	ref_image_free(&golden);
+	ref_image_free(&src);
+	return ok;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Identity settings                                                          */
+
+/* A filter may only bypass itself where its settings leave every pixel
+ * as it was, at the tier that is drawn.  These run each kernel with its
+ * neutral settings (corners on the source's corners, no strength and no
+ * zoom) at every tier and on either side of the lens's 2:1 boundary, and
+ * check that the filter's bypass agrees with what the kernel draws.
+ *
+ * The corner pin has no bypass: invBilinear nudges u off the left edge
+ * and the RGSS and 9-tap tiers average taps half a texel off center, so
+ * its neutral corners are not exact at any tier. */
+struct identity_size {
+	const char *name;
+	uint32_t width, height;
+};
+
+static const struct identity_size identity_sizes[] = {
+	{"square", 48, 48},
+	{"4_3", 64, 48},
+	{"under_2_1", 95, 48},
+	{"2_1", 96, 48},
+	{"wide", 128, 48},
+};
+
+static const char *const tier_names[] = {"single", "rgss", "9tap",
+					 "bicubic"};
+
+#define NUM_IDENTITY_SIZES \
+	(sizeof(identity_sizes) / sizeof(identity_sizes[0]))
+#define NUM_TIERS (sizeof(tier_names) / sizeof(tier_names[0]))
+
+/* Every size at every tier, for the corner pin and then the lens */
+#define NUM_IDENTITY_CASES (2 * NUM_IDENTITY_SIZES * NUM_TIERS)
+
+static bool bypasses(enum test_kernel kernel, enum ref_quality tier,
+		     uint32_t width, uint32_t height)
+{
+	struct lens_distortion_params params = {};
+
+	switch (kernel) {
+	case KERNEL_LENS_DISTORTION:
+		params.zoom = 1.0f;
+		return lens_distortion_is_identity(
+			&params, (enum filter_quality)tier, width, height);
+	case KERNEL_CORNER_PIN:
+	case KERNEL_STROKE:
+		break;
+	}
+
+	return false;
+}
+
+static bool run_identity_case(const char *name, enum test_kernel kernel,
+			      const struct identity_size *size,
+			      enum ref_quality tier)
+{
+	struct ref_corner_pin_params corner_pin = {
+		{{0.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}},
+		tier};
+	struct ref_lens_distortion_params lens = {0.0f, 1.0f, false, tier};
+	struct ref_image src = {};
+	struct ref_image dst = {};
+	struct ref_diff diff;
+	bool ok = true;
+
+	bool bypass = bypasses(kernel, tier, size->width, size->height);
+
+	if (!make_input(&src, size->width, size->height) ||
+	    !ref_image_init(&dst, size->width, size->height) ||
+	    !(kernel == KERNEL_CORNER_PIN
+		      ? ref_corner_pin(&dst, &src, &corner_pin,
+				       REF_PATH_SCALAR)
+		      : ref_lens_distortion(&dst, &src, &lens))) {
+		printf("FAIL %s: kernel failed\n", name);
+		ref_image_free(&dst);
+		ref_image_free(&src);
+		return false;
+	}
+
+	clamp_output(&dst);
+	ref_image_compare(&src, &dst, GOLDEN_TOLERANCE, 0.0, &diff);
+
+	bool unchanged = diff.over_tolerance == 0;
+
+	if (bypass != unchanged) {
+		printf("FAIL %s: %ux%u is %sbypassed, but the kernel changes "
+		       "%llu channels (max error %g at %u,%u)\n",
+		       name, size->width, size->height, bypass ? "" : "not ",
+		       (unsigned long long)diff.over_tolerance,
+		       diff.max_error, diff.worst_x, diff.worst_y);
+		ok = false;
+	}
+
+	/* Checked against the ratio and tier too, so a kernel and a filter
+	 * that are wrong the same way still fail */
+	bool expected = kernel == KERNEL_LENS_DISTORTION &&
+			size->width / size->height == 1 &&
+			(tier == REF_QUALITY_SINGLE ||
+			 tier == REF_QUALITY_BICUBIC);
+	if (bypass != expected) {
+		printf("FAIL %s: %ux%u is %sbypassed\n", name, size->width,
+		       size->height, bypass ? "" : "not ");
+		ok = false;
+	}
+
+	if (ok)
+		printf("PASS %s\n", name);
+
+	ref_image_free(&dst);
+	ref_image_free(&src);
+	return ok;
+}
+
+static bool selected(const char *name, int count, char **prefixes)
+{
+	if (!count)
+		return true;
+
+	for (int i = 0; i < count; i++) {
+		if (strncmp(name, prefixes[i], strlen(prefixes[i])) == 0)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		fprintf(stderr,
+			"usage: %s <golden dir> [--update] [case prefix...]\n",
+			argv[0]);
+		return 2;
+	}
+
+	const char *golden_dir = argv[1];
+	bool update = argc > 2 && strcmp(argv[2], "--update") == 0;
+	int first = update ? 3 : 2;
+	int failed = 0, run = 0;
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		if (!selected(cases[i].name, argc - first, argv + first))
+			continue;
+
+		run++;
+		if (!run_case(&cases[i], golden_dir, update))
+			failed++;
+	}
+
+	for (size_t i = 0; !update && i < NUM_IDENTITY_CASES; i++) {
+		const struct identity_size *size =
+			&identity_sizes[i / NUM_TIERS % NUM_IDENTITY_SIZES];
+		enum test_kernel kernel =
+			i < NUM_IDENTITY_CASES / 2 ? KERNEL_CORNER_PIN
+						   : KERNEL_LENS_DISTORTION;
+		enum ref_quality tier = (enum ref_quality)(i % NUM_TIERS);
+		char name[128];
+
+		snprintf(name, sizeof(name), "%s_identity_%s_%s",
+			 kernel == KERNEL_CORNER_PIN ? "corner_pin"
+						     : "lens_distortion",
+			 size->name, tier_names[tier]);
+
+		if (!selected(name, argc - first, argv + first))
+			continue;
+
+		run++;
+		if (!run_identity_case(name, kernel, size, tier))
+			failed++;
+	}
+
+	printf("%d of %d cases failed\n", failed, run);
+	return failed || !run ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#include <obs-module.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <string.h>
+#include <QImage>
+#include "uv-map-file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static bool map_file(struct uv_map_image *image, const char *path)
+{
+#ifdef _WIN32
+	wchar_t *wpath = NULL;
+	os_utf8_to_wcs_ptr(path, 0, &wpath);
+
+	HANDLE file = CreateFileW(wpath, GENERIC_READ, FILE_SHARE_READ, NULL,
+				  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	bfree(wpath);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	HANDLE mapping = NULL;
+
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0,
+					     NULL);
+	CloseHandle(file);
+	if (!mapping)
+		return false;
+
+	/* The view keeps the file mapped after both handles are closed */
+	image->mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	image->mapping_size = (size_t)size.QuadPart;
+	CloseHandle(mapping);
+	return image->mapping != NULL;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	void *mapping = MAP_FAILED;
+
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+		mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE,
+			       fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED)
+		return false;
+
+	image->mapping = mapping;
+	image->mapping_size = (size_t)st.st_size;
+	return true;
+#endif
+}
+
+static void unmap_file(struct uv_map_image *image)
+{
+	if (!image->mapping)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(image->mapping);
+#else
+	munmap(image->mapping, image->mapping_size);
+#endif
+	image->mapping = NULL;
+}
+
+static bool load_raw(struct uv_map_image *image, const char *path)
+{
+	if (!map_file(image, path))
+		return false;
+
+	const uint8_t *bytes = (const uint8_t *)image->mapping;
+	uint32_t header[4];
+
+	if (image->mapping_size < UV_MAP_HEADER_SIZE)
+		return false;
+
+	memcpy(header, bytes, sizeof(header));
+	if (memcmp(bytes, UV_MAP_MAGIC, 4) != 0 ||
+	    header[1] != UV_MAP_VERSION || !header[2] || !header[3])
+		return false;
+
+	uint64_t texels = (uint64_t)header[2] * header[3];
+	uint64_t size = UV_MAP_HEADER_SIZE + texels * 2 * sizeof(float);
+	if (image->mapping_size < size)
+		return false;
+
+	/* Fault every page in here so that the upload on the graphics thread
+	 * never waits on the disk */
+	volatile uint8_t sink = 0;
+	for (size_t offset = 0; offset < image->mapping_size; offset += 4096)
+		sink += bytes[offset];
+
+	image->cx = header[2];
+	image->cy = header[3];
+	image->texels = (const float *)(bytes + UV_MAP_HEADER_SIZE);
+	return true;
+}
+
+static bool import_image(struct uv_map_image *image, const char *path)
+{
+	QImage source(QString::fromUtf8(path));
+	if (source.isNull())
+		return false;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+	typedef quint16 channel;
+	const float scale = 1.0f / 65535.0f;
+	QImage rgba = source.convertToFormat(QImage::Format_RGBA64);
+#else
+	typedef uint8_t channel;
+	const float scale = 1.0f / 255.0f;
+	QImage rgba = source.convertToFormat(QImage::Format_RGBA8888);
+#endif
+
+	uint32_t cx = (uint32_t)rgba.width();
+	uint32_t cy = (uint32_t)rgba.height();
+	float *texels = (float *)bmalloc((size_t)cx * cy * 2 * sizeof(float));
+
+	for (uint32_t y = 0; y < cy; y++) {
+		const channel *line = (const channel *)rgba.constScanLine(y);
+		float *out = texels + (size_t)y * cx * 2;
+
+		/* STMaps put v = 0 at the bottom */
+		for (uint32_t x = 0; x < cx; x++) {
+			out[x * 2] = line[x * 4] * scale;
+			out[x * 2 + 1] = 1.0f - line[x * 4 + 1] * scale;
+		}
+	}
+
+	image->cx = cx;
+	image->cy = cy;
+	image->decoded = texels;
+	image->texels = texels;
+	return true;
+}
+
+bool uv_map_image_load(struct uv_map_image *image, const char *path)
+{
+	const char *ext = strrchr(path, '.');
+	bool success;
+
+	if (ext && astrcmpi(ext, ".uvmap") == 0)
+		success = load_raw(image, path);
+	else
+		success = import_image(image, path);
+
+	if (!success)
+		uv_map_image_free(image);
+	return success;
+}
+
+void uv_map_image_free(struct uv_map_image *image)
+{
+	unmap_file(image);
+	bfree(image->decoded);
+	memset(image, 0, sizeof(*image));
+}
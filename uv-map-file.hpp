@@ -0,0 +1,34 @@
+#pragma once
+
+#include <obs-module.h>
+
+/* Raw UV map (".uvmap"), read in place through a memory mapping:
+ *
+ *   char     magic[4]   "UVMP"
+ *   uint32_t version    1
+ *   uint32_t width
+ *   uint32_t height
+ *   float    uv[height][width][2]
+ *
+ * Everything is little-endian.  UVs are normalized to the filter's input
+ * with the origin at the top left, one pair per texel center. */
+#define UV_MAP_MAGIC "UVMP"
+#define UV_MAP_VERSION 1
+#define UV_MAP_HEADER_SIZE 16
+
+/* A loaded map, ready to be uploaded as a GS_RG32F texture.  `texels`
+ * points either into `mapping` or into `decoded`. */
+struct uv_map_image {
+	uint32_t cx, cy;
+	const float *texels;
+
+	float *decoded;
+	void *mapping;
+	size_t mapping_size;
+};
+
+/* Loads a raw map, or imports an STMap image (red = u, green = v with the
+ * origin at the bottom left, at up to 16 bits per channel).  Does file IO
+ * and decoding, so it belongs on a worker thread. */
+bool uv_map_image_load(struct uv_map_image *image, const char *path);
+void uv_map_image_free(struct uv_map_image *image);
@@ -0,0 +1,559 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include <mutex>
+#include <string.h>
+#include "effect-variants.hpp"
+#include "filter-pack.hpp"
+#include "frame-capture.hpp"
+#include "gpu-timer.hpp"
+#include "uv-map-file.hpp"
+#include "uv_map_filter.effect.h"
+
+enum uv_map_param {
+	PARAM_IMAGE,
+	PARAM_UV_MAP,
+	PARAM_TEXWIDTH,
+	PARAM_TEXHEIGHT,
+	NUM_PARAMS,
+};
+
+static const char *const uv_map_params[NUM_PARAMS] = {
+	"image",
+	"uv_map",
+	"texwidth",
+	"texheight",
+};
+
+enum uv_map_feature {
+	FEATURE_QUALITY,
+	NUM_FEATURES,
+};
+
+static const struct effect_feature uv_map_features[NUM_FEATURES] = {
+	{"QUALITY", filter_quality_values, NUM_QUALITY},
+};
+
+static struct effect_variants variants =
+	EFFECT_VARIANTS("uv_map_filter.effect", uv_map_filter_effect,
+			uv_map_features, NUM_FEATURES, uv_map_params,
+			NUM_PARAMS);
+
+/* Most of a map uploaded per frame, so that a large one is spread over
+ * several frames rather than stalling one */
+#define UV_MAP_BAND_BYTES (4 * 1024 * 1024)
+
+struct uv_map_params {
+	enum filter_quality quality;
+	bool adaptive;
+};
+
+struct uv_map_data {
+	obs_source_t *context;
+
+	struct filter_params_lock params_lock;
+	struct uv_map_params params;
+
+	/* Maps are read and decoded on the shared loader thread and handed
+	 * to the graphics thread through `loaded`.  An empty path is loaded
+	 * as an empty image and clears the map.  `requested`, `queued` and
+	 * `loaded` are guarded by load_mutex. */
+	char *path;
+	char *requested;
+	bool queued;
+	struct uv_map_image *loaded;
+
+	/* A loaded map is uploaded into `pending` a band of rows per frame,
+	 * through the dynamic `band`, while `map` keeps being drawn */
+	struct uv_map_image *uploading;
+	uint32_t uploaded_rows;
+	gs_texture_t *pending;
+	gs_texture_t *band;
+
+	gs_texture_t *map;
+	int64_t map_bytes;
+
+	struct frame_capture capture;
+	struct filter_stats stats;
+	struct gpu_timer gpu_timer;
+};
+
+static const char *uv_map_getname(void *unused)
+{
+	UNUSED_PARAMETER(unused);
+	return "UV Map";
+}
+
+static void free_image(struct uv_map_image *image)
+{
+	if (!image)
+		return;
+
+	uv_map_image_free(image);
+	bfree(image);
+}
+
+/* One loader thread serves every instance, in the order they asked.
+ * `loading` is the instance whose map is being loaded; destroy clears it
+ * so that the result is dropped. */
+static std::mutex refs_mutex;
+static long refs = 0;
+static pthread_t loader;
+static bool loader_created;
+static os_sem_t *load_sem;
+static volatile bool loader_stop;
+
+static pthread_mutex_t load_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DARRAY(struct uv_map_data *) load_queue;
+static struct uv_map_data *loading;
+
+static void *uv_map_loader(void *unused)
+{
+	os_set_thread_name("filter-pack: uv map loader");
+
+	while (os_sem_wait(load_sem) == 0) {
+		if (os_atomic_load_bool(&loader_stop))
+			break;
+
+		struct uv_map_data *filter = NULL;
+		char *path = NULL;
+		char *name = NULL;
+
+		pthread_mutex_lock(&load_mutex);
+		if (load_queue.num) {
+			filter = load_queue.array[0];
+			da_erase(load_queue, 0);
+
+			filter->queued = false;
+			path = filter->requested;
+			filter->requested = NULL;
+			name = bstrdup(obs_source_get_name(filter->context));
+			loading = filter;
+		}
+		pthread_mutex_unlock(&load_mutex);
+
+		/* Several requests may have been folded into one */
+		if (!filter)
+			continue;
+
+		struct uv_map_image *image = (uv_map_image *)bzalloc(
+			sizeof(struct uv_map_image));
+
+		if (*path && !uv_map_image_load(image, path)) {
+			blog(LOG_WARNING,
+			     "[filter-pack] '%s': could not load UV map '%s'",
+			     name, path);
+			free_image(image);
+			image = NULL;
+		}
+
+		pthread_mutex_lock(&load_mutex);
+		if (loading == filter && image) {
+			free_image(filter->loaded);
+			filter->loaded = image;
+			image = NULL;
+		}
+		loading = NULL;
+		pthread_mutex_unlock(&load_mutex);
+
+		free_image(image);
+		bfree(path);
+		bfree(name);
+	}
+
+	UNUSED_PARAMETER(unused);
+	return NULL;
+}
+
+static void loader_acquire(void)
+{
+	std::lock_guard<std::mutex> lock(refs_mutex);
+
+	if (refs++ == 0) {
+		os_atomic_set_bool(&loader_stop, false);
+		os_sem_init(&load_sem, 0);
+		loader_created = pthread_create(&loader, NULL, uv_map_loader,
+						NULL) == 0;
+	}
+}
+
+/* The last instance waits for a map still being loaded, whose result
+ * nobody wants any more */
+static void loader_release(void)
+{
+	std::lock_guard<std::mutex> lock(refs_mutex);
+
+	if (--refs == 0) {
+		if (loader_created) {
+			os_atomic_set_bool(&loader_stop, true);
+			os_sem_post(load_sem);
+			pthread_join(loader, NULL);
+		}
+
+		os_sem_destroy(load_sem);
+		load_sem = NULL;
+		da_free(load_queue);
+	}
+}
+
+static void request_load(struct uv_map_data *filter, const char *path)
+{
+	pthread_mutex_lock(&load_mutex);
+	bfree(filter->requested);
+	filter->requested = bstrdup(path);
+	if (!filter->queued) {
+		da_push_back(load_queue, &filter);
+		filter->queued = true;
+	}
+	pthread_mutex_unlock(&load_mutex);
+
+	os_sem_post(load_sem);
+}
+
+/* Takes the instance off the loader, dropping a map it is loading */
+static void cancel_load(struct uv_map_data *filter)
+{
+	pthread_mutex_lock(&load_mutex);
+	for (size_t i = 0; i < load_queue.num; i++) {
+		if (load_queue.array[i] == filter) {
+			da_erase(load_queue, i);
+			break;
+		}
+	}
+	if (loading == filter)
+		loading = NULL;
+	pthread_mutex_unlock(&load_mutex);
+}
+
+static void uv_map_update(void *data, obs_data_t *settings)
+{
+	filter_profile_scope scope("uv_map_update");
+
+	struct uv_map_data *filter = (uv_map_data *)data;
+	struct uv_map_params params;
+
+	params.quality = filter_quality_get(settings);
+	params.adaptive = filter_adaptive_get(settings);
+
+	filter_params_write_begin(&filter->params_lock);
+	filter->params = params;
+	filter_params_write_end(&filter->params_lock);
+
+	filter_stats_update(&filter->stats, settings);
+
+	const char *path = obs_data_get_string(settings, "path");
+	if (!filter->path || strcmp(filter->path, path) != 0) {
+		bfree(filter->path);
+		filter->path = bstrdup(path);
+		request_load(filter, path);
+	}
+}
+
+static void uv_map_destroy(void *data)
+{
+	filter_profile_scope scope("uv_map_destroy");
+
+	struct uv_map_data *filter = (uv_map_data *)data;
+
+	cancel_load(filter);
+	loader_release();
+
+	effect_variants_release(&variants);
+
+	obs_enter_graphics();
+	frame_capture_free(&filter->capture, &filter->stats);
+	gs_texture_destroy(filter->map);
+	gs_texture_destroy(filter->pending);
+	gs_texture_destroy(filter->band);
+	gpu_timer_free(&filter->gpu_timer);
+	obs_leave_graphics();
+
+	vram_stats_add(vram_stats_type(VRAM_UV_MAP), NULL, -filter->map_bytes,
+		       false);
+
+	free_image(filter->loaded);
+	free_image(filter->uploading);
+	bfree(filter->requested);
+	bfree(filter->path);
+	filter_params_lock_free(&filter->params_lock);
+	bfree(data);
+}
+
+static void *uv_map_create(obs_data_t *settings, obs_source_t *context)
+{
+	filter_profile_scope scope("uv_map_create");
+
+	struct uv_map_data *filter =
+		(uv_map_data *)bzalloc(sizeof(struct uv_map_data));
+
+	filter->context = context;
+	filter_params_lock_init(&filter->params_lock);
+	filter_stats_init(&filter->stats, context, VRAM_UV_MAP);
+	filter_stats_budget(&filter->stats, 1);
+	gpu_timer_init(&filter->gpu_timer, context);
+	frame_capture_init(&filter->capture, context);
+
+	loader_acquire();
+	effect_variants_acquire(&variants);
+
+	uv_map_update(filter, settings);
+	return filter;
+}
+
+static void uv_map_tick(void *data, float seconds)
+{
+	filter_profile_scope scope("uv_map_tick");
+
+	struct uv_map_data *filter = (uv_map_data *)data;
+	struct uv_map_params params;
+
+	filter_params_read(&filter->params_lock, &params, &filter->params,
+			   sizeof(params));
+
+	if (params.adaptive)
+		filter_pressure_tick(seconds);
+
+	filter_stats_tick(&filter->stats, filter->context, &filter->gpu_timer,
+			  seconds);
+}
+
+static int64_t texture_bytes(gs_texture_t *tex)
+{
+	return tex ? vram_texture_bytes(GS_RG32F, gs_texture_get_width(tex),
+					gs_texture_get_height(tex))
+		   : 0;
+}
+
+static void account_map(struct uv_map_data *filter, bool allocation)
+{
+	int64_t bytes = texture_bytes(filter->map) +
+			texture_bytes(filter->pending) +
+			texture_bytes(filter->band);
+
+	vram_stats_add(vram_stats_type(VRAM_UV_MAP), &filter->stats.vram,
+		       bytes - filter->map_bytes, allocation);
+	filter->map_bytes = bytes;
+}
+
+static void replace_map(struct uv_map_data *filter, gs_texture_t *map)
+{
+	gs_texture_destroy(filter->map);
+	filter->map = map;
+}
+
+/* Starts uploading the loader's latest result, if there is one, dropping
+ * an upload it supersedes.  An empty image clears the map at once. */
+static void start_upload(struct uv_map_data *filter)
+{
+	pthread_mutex_lock(&load_mutex);
+	struct uv_map_image *image = filter->loaded;
+	filter->loaded = NULL;
+	pthread_mutex_unlock(&load_mutex);
+
+	if (!image)
+		return;
+
+	free_image(filter->uploading);
+	filter->uploading = NULL;
+
+	uint32_t cx = image->texels ? image->cx : 0;
+	uint32_t cy = image->texels ? image->cy : 0;
+	uint32_t rows = cx ? UV_MAP_BAND_BYTES / (cx * 8) : 0;
+	rows = rows < 1 ? 1 : (rows > cy ? cy : rows);
+
+	if (filter->pending && (gs_texture_get_width(filter->pending) != cx ||
+				gs_texture_get_height(filter->pending) != cy)) {
+		gs_texture_destroy(filter->pending);
+		filter->pending = NULL;
+	}
+	if (filter->band && (gs_texture_get_width(filter->band) != cx ||
+			     gs_texture_get_height(filter->band) != rows)) {
+		gs_texture_destroy(filter->band);
+		filter->band = NULL;
+	}
+
+	if (!cx) {
+		replace_map(filter, NULL);
+		account_map(filter, false);
+		free_image(image);
+		return;
+	}
+
+	bool allocation = false;
+
+	if (!filter->pending) {
+		filter->pending =
+			gs_texture_create(cx, cy, GS_RG32F, 1, NULL, 0);
+		allocation = true;
+	}
+	if (!filter->band) {
+		filter->band = gs_texture_create(cx, rows, GS_RG32F, 1, NULL,
+						 GS_DYNAMIC);
+		allocation = true;
+	}
+	if (allocation)
+		filter_stats_alloc(&filter->stats);
+	account_map(filter, allocation);
+
+	if (!filter->pending || !filter->band) {
+		free_image(image);
+		return;
+	}
+
+	filter->uploading = image;
+	filter->uploaded_rows = 0;
+}
+
+/* Copies the next band of rows into `pending`, which replaces the map
+ * once it is complete */
+static void upload_band(struct uv_map_data *filter)
+{
+	struct uv_map_image *image = filter->uploading;
+	uint32_t rows = gs_texture_get_height(filter->band);
+	uint32_t y = filter->uploaded_rows;
+
+	if (rows > image->cy - y)
+		rows = image->cy - y;
+
+	uint8_t *ptr;
+	uint32_t linesize;
+
+	if (!gs_texture_map(filter->band, &ptr, &linesize))
+		return;
+
+	const size_t stride = (size_t)image->cx * 2;
+	const float *texels = image->texels + y * stride;
+
+	for (uint32_t i = 0; i < rows; i++)
+		memcpy(ptr + (size_t)i * linesize, texels + i * stride,
+		       stride * sizeof(float));
+
+	gs_texture_unmap(filter->band);
+	gs_copy_texture_region(filter->pending, 0, y, filter->band, 0, 0,
+			       image->cx, rows);
+
+	filter->uploaded_rows += rows;
+	if (filter->uploaded_rows < image->cy)
+		return;
+
+	replace_map(filter, filter->pending);
+	filter->pending = NULL;
+
+	/* Only needed again for the next map */
+	gs_texture_destroy(filter->band);
+	filter->band = NULL;
+	account_map(filter, false);
+
+	free_image(image);
+	filter->uploading = NULL;
+}
+
+static void upload_map(struct uv_map_data *filter)
+{
+	start_upload(filter);
+
+	if (filter->uploading)
+		upload_band(filter);
+}
+
+static void draw_output(struct uv_map_data *filter,
+			const struct effect_variant *variant, uint32_t cx,
+			uint32_t cy)
+{
+	if (!obs_source_process_filter_begin(filter->context, GS_RGBA,
+					     OBS_ALLOW_DIRECT_RENDERING))
+		return;
+
+	gs_eparam_t **eparams = variant->params;
+
+	gs_effect_set_texture(eparams[PARAM_UV_MAP], filter->map);
+	gs_effect_set_int(eparams[PARAM_TEXWIDTH], cx);
+	gs_effect_set_int(eparams[PARAM_TEXHEIGHT], cy);
+
+	gpu_timer_begin(&filter->gpu_timer);
+	obs_source_process_filter_end(filter->context, variant->effect, 0, 0);
+	gpu_timer_end(&filter->gpu_timer);
+	filter_stats_frame(&filter->stats, 1);
+}
+
+static void uv_map_render(void *data, gs_effect_t *effect)
+{
+	filter_profile_scope scope("uv_map_render");
+
+	struct uv_map_data *filter = (uv_map_data *)data;
+	struct uv_map_params params;
+
+	filter_params_read(&filter->params_lock, &params, &filter->params,
+			   sizeof(params));
+
+	upload_map(filter);
+
+	uint32_t features[NUM_FEATURES];
+	features[FEATURE_QUALITY] =
+		filter_quality_adapt(params.quality, params.adaptive);
+
+	const struct effect_variant *variant = effect_variants_get(
+		&variants, effect_variants_key(&variants, features));
+
+	obs_source_t *target = obs_filter_get_target(filter->context);
+
+	if (!filter->map || !variant || !target) {
+		obs_source_skip_video_filter(filter->context);
+		return;
+	}
+
+	uint32_t cx = obs_source_get_base_width(target);
+	uint32_t cy = obs_source_get_base_height(target);
+
+	bool capture = frame_capture_begin(&filter->capture, &filter->stats,
+					   cx, cy);
+
+	draw_output(filter, variant, cx, cy);
+
+	if (capture)
+		frame_capture_end(&filter->capture);
+
+	UNUSED_PARAMETER(effect);
+}
+
+static obs_properties_t *uv_map_properties(void *data)
+{
+	filter_profile_scope scope("uv_map_properties");
+
+	obs_properties_t *props = obs_properties_create();
+
+	obs_properties_add_path(props, "path", "UV Map", OBS_PATH_FILE,
+				"UV maps (*.uvmap *.png *.tif *.tiff *.exr);;"
+				"All files (*.*)",
+				NULL);
+	filter_quality_add_property(props);
+	filter_adaptive_add_property(props);
+	filter_stats_add_property(props);
+
+	struct uv_map_data *filter = (uv_map_data *)data;
+	gpu_timer_add_property(props, filter ? &filter->gpu_timer : NULL);
+	return props;
+}
+
+static void uv_map_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_string(settings, "path", "");
+	obs_data_set_default_int(settings, "quality", QUALITY_SINGLE);
+	obs_data_set_default_bool(settings, "adaptive_quality", false);
+}
+
+struct obs_source_info uv_map_filter = [] {
+	obs_source_info uv_map_filter = {0};
+	uv_map_filter.id = "uv_map_filter";
+	uv_map_filter.type = OBS_SOURCE_TYPE_FILTER;
+	uv_map_filter.output_flags = OBS_SOURCE_VIDEO;
+	uv_map_filter.get_name = uv_map_getname;
+	uv_map_filter.create = uv_map_create;
+	uv_map_filter.destroy = uv_map_destroy;
+	uv_map_filter.update = uv_map_update;
+	uv_map_filter.video_tick = uv_map_tick;
+	uv_map_filter.video_render = uv_map_render;
+	uv_map_filter.get_properties = uv_map_properties;
+	uv_map_filter.get_defaults = uv_map_defaults;
+	return uv_map_filter;
+}();
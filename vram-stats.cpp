@@ -0,0 +1,92 @@
+#include <obs-module.h>
+#include <util/platform.h>
+#include <mutex>
+#include "vram-stats.hpp"
+
+static std::mutex stats_mutex;
+
+static struct vram_stats types[NUM_VRAM_TYPES];
+
+static const char *const type_names[NUM_VRAM_TYPES] = {
+	"corner pin",
+	"lens distortion",
+	"stroke",
+	"uv map",
+	"editor",
+};
+
+struct vram_stats *vram_stats_type(enum vram_type type)
+{
+	return &types[type];
+}
+
+int64_t vram_texture_bytes(enum gs_color_format format, uint32_t cx,
+			   uint32_t cy)
+{
+	return (int64_t)cx * (int64_t)cy * gs_get_format_bpp(format) / 8;
+}
+
+static void add(struct vram_stats *stats, int64_t bytes, bool allocation)
+{
+	stats->bytes += bytes;
+	if (stats->bytes > stats->peak)
+		stats->peak = stats->bytes;
+	if (allocation)
+		stats->allocations++;
+}
+
+void vram_stats_add(struct vram_stats *type, struct vram_stats *instance,
+		    int64_t bytes, bool allocation)
+{
+	std::lock_guard<std::mutex> lock(stats_mutex);
+
+	if (type)
+		add(type, bytes, allocation);
+	if (instance)
+		add(instance, bytes, allocation);
+}
+
+static void sample(struct vram_stats *stats, uint64_t now)
+{
+	double seconds = (double)(now - stats->sampled_ns) / 1000000000.0;
+
+	if (!stats->sampled_ns) {
+		stats->sampled = stats->allocations;
+		stats->sampled_ns = now;
+	} else if (seconds >= VRAM_STATS_RATE_INTERVAL) {
+		stats->rate = (float)((double)(stats->allocations -
+					       stats->sampled) /
+				      seconds);
+		stats->sampled = stats->allocations;
+		stats->sampled_ns = now;
+	}
+}
+
+void vram_stats_read(struct vram_stats *stats, struct vram_stats *out)
+{
+	std::lock_guard<std::mutex> lock(stats_mutex);
+
+	sample(stats, os_gettime_ns());
+	*out = *stats;
+}
+
+void vram_stats_log_types(void)
+{
+	std::lock_guard<std::mutex> lock(stats_mutex);
+
+	for (size_t i = 0; i < NUM_VRAM_TYPES; i++) {
+		if (!types[i].allocations)
+			continue;
+
+		blog(LOG_INFO,
+		     "[filter-pack] VRAM (%s): %.2f MB held, %.2f MB peak, "
+		     "%ld allocations",
+		     type_names[i], types[i].bytes / 1048576.0,
+		     types[i].peak / 1048576.0, types[i].allocations);
+	}
+}
+
+const char *vram_stats_type_name(enum vram_type type)
+{
+	return type_names[type];
+}
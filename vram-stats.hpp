@@ -0,0 +1,44 @@
+#pragma once
+
+#include <obs-module.h>
+
+/* GPU memory held by one owner: a filter type, a filter instance or the
+ * corner pin editor.  Sizes are estimated from the dimensions and format
+ * the pack asks for, since libobs does not report what a driver actually
+ * allocates.  Every update goes through a module-wide lock, so the values
+ * can be read from any thread with vram_stats_read. */
+struct vram_stats {
+	int64_t bytes;
+	int64_t peak;
+	long allocations;
+
+	long sampled;
+	uint64_t sampled_ns;
+	float rate;
+};
+
+enum vram_type {
+	VRAM_CORNER_PIN,
+	VRAM_LENS_DISTORTION,
+	VRAM_STROKE,
+	VRAM_UV_MAP,
+	VRAM_EDITOR,
+	NUM_VRAM_TYPES,
+};
+
+/* Seconds over which allocations per second is measured */
+#define VRAM_STATS_RATE_INTERVAL 1.0
+
+struct vram_stats *vram_stats_type(enum vram_type type);
+const char *vram_stats_type_name(enum vram_type type);
+
+int64_t vram_texture_bytes(enum gs_color_format format, uint32_t cx,
+			   uint32_t cy);
+
+/* Adds `bytes` (negative to release) to each non-NULL owner, counting it
+ * as a new allocation when `allocation` is set. */
+void vram_stats_add(struct vram_stats *type, struct vram_stats *instance,
+		    int64_t bytes, bool allocation);
+void vram_stats_read(struct vram_stats *stats, struct vram_stats *out);
+
+void vram_stats_log_types(void);